@@ -0,0 +1,164 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2023, KR Soft s.r.o.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the Kassow Robots nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#ifndef KR2_CBUN_ACTION_REQUEST
+#define KR2_CBUN_ACTION_REQUEST
+
+#include "weiss_gripkit/gripkit_logic.h"
+#include "weiss_gripkit/stroke_model.h"
+
+#include <cstdint>
+#include <unistd.h>
+
+namespace kswx_weiss_gripkit {
+
+    /// @brief Shared memory objects used to request gripper actions and wait for them, attached in every process.
+    struct ActionChannel
+    {
+        SynchronizedData<GripkitAction>* action_;
+        SynchronizedIncrement* request_id_;
+        SynchronizedData<PublishedStatus>* status_;
+
+        /// @brief adaptive deadlines, NULL for no deadline
+        SynchronizedData<StrokeDeadlines>* stroke_;
+    };
+
+    /// @brief Outcome of waiting for a gripper action.
+    enum class ActionOutcome
+    {
+        /// @brief the gripper reached the target status
+        DONE,
+
+        /// @brief a newer request from any process replaced this one
+        INTERRUPTED,
+
+        /// @brief shared memory not initialized
+        NOT_INITIALIZED,
+
+        /// @brief the stroke takes much longer than the learned stroke times (jammed gripper)
+        STROKE_TIMEOUT,
+
+        /// @brief the status monitor is not running
+        STALE,
+
+        /// @brief the error status repeated too many times
+        BAD_STATUS
+    };
+
+    /// @brief Details of a finished wait, for logging.
+    struct ActionWaitInfo
+    {
+        /// @brief number of error statuses seen
+        int error_count_;
+
+        /// @brief adaptive deadline applied, 0 if none
+        uint32_t deadline_ms_;
+
+        /// @brief age of the monitor heartbeat if STALE
+        uint64_t status_age_ns_;
+
+        /// @brief last published status evaluated, the final status if DONE
+        GripkitCrEasyStatus status_;
+    };
+
+    /// @brief Request an action: take a new request number (interrupts blocking waits of older requests) and set the action
+    /// to be picked up by the status monitor.
+    /// @return request number, 0 if the shared memory is not initialized
+    inline uint64_t submitAction(const ActionChannel& channel, GripkitAction action)
+    {
+        if (!channel.request_id_ || !channel.action_)
+            return 0;
+
+        uint64_t request_number = channel.request_id_->increment();
+        channel.action_->set(action);
+        return request_number;
+    }
+
+    /// @brief Wait until the published status shows the action finished, a newer request interrupts it or it fails.
+    /// Each published status sample is evaluated once.
+    /// @param channel shared memory objects
+    /// @param action submitted action
+    /// @param request_number number returned by submitAction
+    /// @param poll_us sleep between status reads in microseconds
+    /// @param info output, details for logging
+    inline ActionOutcome waitForAction(const ActionChannel& channel, GripkitAction action, uint64_t request_number, useconds_t poll_us,
+        ActionWaitInfo& info)
+    {
+        info = ActionWaitInfo{ 0, 0, 0, GripkitCrEasyStatus::STATUS_ERROR };
+        if (!channel.request_id_ || !channel.status_)
+            return ActionOutcome::NOT_INITIALIZED;
+
+        // adaptive deadline learned from previous strokes, 0 until enough strokes were seen
+        if (channel.stroke_)
+        {
+            StrokeDeadlines deadlines = channel.stroke_->get();
+            info.deadline_ms_ = (action == GripkitAction::GRIP) ? deadlines.grip_ms_ : deadlines.release_ms_;
+        }
+
+        uint64_t start_ns = monotonicNowNs();
+        ActionWait wait(action);
+        uint64_t last_sequence = 0;
+        while (true)
+        {
+            // stop waiting if a new request came from another process
+            if (request_number != channel.request_id_->get())
+                return ActionOutcome::INTERRUPTED;
+
+            if (info.deadline_ms_ > 0 && monotonicNowNs() - start_ns > info.deadline_ms_ * 1000000ULL)
+                return ActionOutcome::STROKE_TIMEOUT;
+
+            StatusQuery query = queryStatus(channel.status_, monotonicNowNs());
+            if (query.error_ == StatusQuery::Error::STALE)
+            {
+                info.status_age_ns_ = query.age_ns_;
+                return ActionOutcome::STALE;
+            }
+            else if (query.error_ != StatusQuery::Error::NOT_INITIALIZED && query.sequence_ != last_sequence)
+            {
+                last_sequence = query.sequence_;
+                info.status_ = query.status_;
+                ActionWait::Result result = wait.update(query.status_);
+                info.error_count_ = wait.errorCount();
+                if (result == ActionWait::Result::DONE)
+                    return ActionOutcome::DONE;
+                if (result == ActionWait::Result::FAILED)
+                    return ActionOutcome::BAD_STATUS;
+            }
+            usleep(poll_us);
+        }
+    }
+
+} // namespace kswx_weiss_gripkit
+
+#endif // KR2_CBUN_ACTION_REQUEST
@@ -0,0 +1,239 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2023, KR Soft s.r.o.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the Kassow Robots nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#ifndef KR2_CBUN_CONTROL_CHANNEL
+#define KR2_CBUN_CONTROL_CHANNEL
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#define CONTROL_PROTOCOL_MAGIC 0x43474b47
+#define CONTROL_PROTOCOL_VERSION 1
+#define CONTROL_MAX_CLIENTS 32
+#define CONTROL_SOCKET_MODE 0660
+#define CONTROL_EVENT_QUEUE_SIZE 64
+
+namespace kswx_weiss_gripkit {
+
+    /// @brief Command of a control channel request.
+    enum class ControlCommand : uint8_t
+    {
+        STATUS = 1,
+        GRIP = 2,
+        RELEASE = 3,
+        SUBSCRIBE = 4,
+        UNSUBSCRIBE = 5
+    };
+
+    /// @brief Result of a control channel request.
+    enum class ControlResult : uint8_t
+    {
+        OK = 0,
+        BAD_REQUEST = 1,
+        NOT_ACTIVATED = 2,
+        STALE = 3,
+        FAILED = 4
+    };
+
+    /// @brief Type of a message sent by the server.
+    enum class ControlMessageType : uint8_t
+    {
+        RESPONSE = 1,
+        EVENT = 2
+    };
+
+    /// @brief Request sent by a client, one SOCK_SEQPACKET datagram.
+    struct ControlRequest
+    {
+        uint32_t magic;
+        uint16_t version;
+
+        /// @brief ControlCommand
+        uint8_t command;
+
+        uint8_t reserved;
+
+        /// @brief chosen by the client, copied into the response
+        uint32_t tag;
+
+        uint32_t reserved2;
+    };
+
+    static_assert(sizeof(ControlRequest) == 16, "ControlRequest layout changed, bump CONTROL_PROTOCOL_VERSION");
+
+    /// @brief Response to a request or status change event sent by the server, one SOCK_SEQPACKET datagram.
+    struct ControlMessage
+    {
+        uint32_t magic;
+
+        /// @brief ControlMessageType
+        uint8_t type;
+
+        /// @brief ControlCommand of the request, 0 for events
+        uint8_t command;
+
+        /// @brief ControlResult
+        uint8_t result;
+
+        /// @brief GripkitCrEasyStatus
+        uint8_t status;
+
+        /// @brief tag of the request, 0 for events
+        uint32_t tag;
+
+        uint32_t reserved;
+
+        /// @brief sequence number of the published status
+        uint64_t sequence;
+
+        /// @brief CLOCK_MONOTONIC time of the GPIO sample in nanoseconds, events only
+        uint64_t sample_time_ns;
+    };
+
+    static_assert(sizeof(ControlMessage) == 32, "ControlMessage layout changed, bump CONTROL_PROTOCOL_VERSION");
+
+    /// @brief Low-latency binary control channel on a Unix domain socket (SOCK_SEQPACKET). One epoll thread accepts clients,
+    /// answers requests through the handler and pushes status change events to subscribed clients. Requests never block,
+    /// completion of grip/release is observed through events or STATUS requests.
+    /// The socket file is created with CONTROL_SOCKET_MODE and only peers running as root, as the server user or in the
+    /// server group (SO_PEERCRED) are accepted.
+    class ControlServer
+    {
+    public:
+        /// @brief Handler of STATUS/GRIP/RELEASE requests, fills result, status and sequence of the response.
+        /// Called from the server thread, must not block.
+        typedef std::function<void(const ControlRequest&, ControlMessage&)> handler_t;
+
+        ControlServer();
+
+        virtual ~ControlServer();
+
+        ControlServer(const ControlServer&) = delete;
+        ControlServer& operator=(const ControlServer&) = delete;
+
+        /// @brief Bind the socket and start the server thread. A stale socket file at path is replaced, the new one gets
+        /// CONTROL_SOCKET_MODE before the server starts listening.
+        /// @param path path of the socket file
+        /// @param handler request handler
+        /// @return true on success, false otherwise
+        bool start(const std::string& path, handler_t handler);
+
+        /// @brief Stop the server thread, disconnect all clients and remove the socket file.
+        void stop();
+
+        /// @brief Return true if the server thread is running.
+        inline bool isRunning() const { return running_; }
+
+        /// @brief Send a status change event to all subscribed clients. Only queues the event and wakes the server thread,
+        /// safe to call from the status monitoring thread. Every event is delivered in order, the socket buffer of each
+        /// client is its queue. When the server thread falls CONTROL_EVENT_QUEUE_SIZE events behind, the oldest are dropped.
+        void publish(uint8_t status, uint64_t sequence, uint64_t sample_time_ns);
+
+        /// @brief number of events dropped because a subscriber did not read its socket or the server thread fell behind
+        inline uint64_t droppedEvents() const { return dropped_events_.load(std::memory_order_relaxed); }
+
+        /// @brief number of connections refused because of the peer credentials
+        inline uint64_t rejectedClients() const { return rejected_clients_.load(std::memory_order_relaxed); }
+
+    private:
+        void run();
+        void accept();
+        void receive(int fd);
+        void disconnect(int fd);
+        void sendEvent();
+
+        handler_t handler_;
+        std::string path_;
+        int listen_fd_;
+        int epoll_fd_;
+        int wake_fd_;
+        std::thread thread_;
+        std::atomic<bool> running_;
+        std::atomic<bool> stopping_;
+        std::atomic<uint64_t> dropped_events_;
+        std::atomic<uint64_t> rejected_clients_;
+
+        /// @brief connected clients and their subscription, only accessed from the server thread
+        struct Client
+        {
+            int fd_;
+            bool subscribed_;
+        };
+        std::vector<Client> clients_;
+
+        /// @brief events not yet sent, written by publish()
+        std::mutex event_mutex_;
+        std::deque<ControlMessage> events_;
+    };
+
+    /// @brief Blocking client of the control channel, used by tools and external processes.
+    class ControlClient
+    {
+    public:
+        ControlClient();
+
+        virtual ~ControlClient();
+
+        ControlClient(const ControlClient&) = delete;
+        ControlClient& operator=(const ControlClient&) = delete;
+
+        /// @brief Connect to the server socket.
+        /// @return true on success
+        bool connect(const std::string& path);
+
+        void close();
+
+        /// @brief Send a request and wait for its response, events received meanwhile are skipped.
+        /// @return true on success, false on a socket error
+        bool call(ControlCommand command, ControlMessage& response);
+
+        /// @brief Wait for the next status change event, the client must be subscribed.
+        /// @param timeout_ms timeout in milliseconds, -1 to wait forever
+        /// @return true if an event was received
+        bool waitEvent(ControlMessage& event, int timeout_ms);
+
+    private:
+        int fd_;
+        uint32_t tag_;
+    };
+
+} // namespace kswx_weiss_gripkit
+
+#endif // KR2_CBUN_CONTROL_CHANNEL
@@ -0,0 +1,285 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2023, KR Soft s.r.o.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the Kassow Robots nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#ifndef KR2_CBUN_CYCLE_SYNC
+#define KR2_CBUN_CYCLE_SYNC
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <mutex>
+#include <time.h>
+
+#define CYCLE_SYNC_PROBE_US 125
+#define CYCLE_SYNC_BURST_CYCLES 3
+#define CYCLE_SYNC_REACQUIRE_TICKS 25
+#define CYCLE_SYNC_RETRY_TICKS 250
+#define CYCLE_SYNC_MAX_FAILURES 4
+#define CYCLE_SYNC_GUARD_US 20
+#define CYCLE_SYNC_CYCLE_TOLERANCE 0.25
+
+namespace kswx_weiss_gripkit {
+
+    /// @brief Clock source of CycleSync reading CLOCK_MONOTONIC.
+    struct MonotonicClockSource
+    {
+        inline uint64_t nowNs()
+        {
+            struct timespec ts;
+            clock_gettime(CLOCK_MONOTONIC, &ts);
+            return static_cast<uint64_t>(ts.tv_sec) * 1000000000ULL + static_cast<uint64_t>(ts.tv_nsec);
+        }
+
+        /// @brief Sleep until an absolute CLOCK_MONOTONIC time, returns immediately if it already passed.
+        inline void sleepUntilNs(uint64_t time_ns)
+        {
+            struct timespec ts;
+            ts.tv_sec = static_cast<time_t>(time_ns / 1000000000ULL);
+            ts.tv_nsec = static_cast<long>(time_ns % 1000000000ULL);
+            while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR) {}
+        }
+    };
+
+    /// @brief State of the controller cycle lock.
+    struct CycleSyncStats
+    {
+        /// @brief true if sampling is aligned to the controller cycle, false if free running
+        bool locked_;
+
+        /// @brief cycle measured by the first burst in nanoseconds, 0 if not measured yet
+        uint64_t measured_cycle_ns_;
+
+        /// @brief number of successful and failed phase acquisitions
+        uint64_t acquisitions_;
+        uint64_t failures_;
+
+        /// @brief number of extra I/O reads done for phase acquisition
+        uint64_t probes_;
+
+        /// @brief true if acquisition failed CYCLE_SYNC_MAX_FAILURES times in a row and the monitor runs free until re-enabled
+        bool stopped_;
+    };
+
+    /// @brief Wait of a periodic monitor that samples shortly after the controller updated its I/O data, instead of at an arbitrary
+    /// phase of the controller cycle. The phase is measured by probe bursts: the I/O data is read every CYCLE_SYNC_PROBE_US until
+    /// it changes. The burst is repeated every CYCLE_SYNC_REACQUIRE_TICKS ticks to follow the drift between the controller clock
+    /// and CLOCK_MONOTONIC. Sampling is predicted from the nominal controller cycle, each wake-up moves to the nearest predicted
+    /// update so that the mean period stays. The first burst measures the cycle; if it does not match the nominal cycle or the
+    /// I/O data does not change, the monitor runs free and retries after CYCLE_SYNC_RETRY_TICKS ticks. A burst lasts at most
+    /// CYCLE_SYNC_BURST_CYCLES cycles and never more than half a monitor period. After CYCLE_SYNC_MAX_FAILURES failed bursts in
+    /// a row, e.g. because the inputs are steady, it stops retrying until enabled again. Disabled by default.
+    /// @tparam clock_t clock source providing uint64_t nowNs() and void sleepUntilNs(uint64_t), copyable
+    /// @tparam probe_t callable returning a uint64_t fingerprint of the current I/O data, copyable; called from the monitor thread
+    template <typename clock_t, typename probe_t>
+    class CycleSync
+    {
+    public:
+        /// @param clock clock source
+        /// @param probe reads the I/O data and returns its fingerprint
+        /// @param period_ms nominal monitor period in milliseconds
+        /// @param cycle_us nominal I/O cycle of the controller in microseconds
+        inline CycleSync(clock_t clock, probe_t probe, int period_ms, int cycle_us) :
+        clock_(clock), probe_(probe), period_ns_(period_ms * 1000000ULL), cycle_ns_(cycle_us * 1000ULL),
+        burst_ns_(std::min<uint64_t>(CYCLE_SYNC_BURST_CYCLES * cycle_ns_, period_ns_ / 2)), enabled_(false), rearm_(false),
+        locked_(false), verified_(false), stopped_(false), update_ns_(0), grid_ns_(0), ticks_(0), failures_in_row_(0), stats_() {}
+
+        CycleSync(const CycleSync&) = delete;
+        CycleSync& operator=(const CycleSync&) = delete;
+
+        /// @brief Enable or disable synchronization, disabled waits a fixed period. Enabling retries after repeated failures.
+        /// Thread-safe.
+        inline void setEnabled(bool enabled)
+        {
+            if (enabled)
+                rearm_ = true;
+            enabled_ = enabled;
+        }
+
+        inline bool enabled() const { return enabled_; }
+
+        /// @brief Drop the lock, the next wait acquires it again. Must not be called while the monitor thread runs.
+        inline void reset()
+        {
+            locked_ = false;
+            stopped_ = false;
+            grid_ns_ = 0;
+            ticks_ = 0;
+            failures_in_row_ = 0;
+            std::lock_guard<std::mutex> lock(stats_mutex_);
+            stats_.locked_ = false;
+            stats_.stopped_ = false;
+        }
+
+        /// @brief Get the state of the lock. Thread-safe.
+        inline CycleSyncStats stats() const
+        {
+            std::lock_guard<std::mutex> lock(stats_mutex_);
+            return stats_;
+        }
+
+        /// @brief Sleep until the next sample time. Called from the monitor thread after each cycle.
+        inline void wait()
+        {
+            if (rearm_.exchange(false))
+                reset();
+
+            if (!enabled_ || stopped_)
+            {
+                locked_ = false;
+                grid_ns_ = 0;
+                clock_.sleepUntilNs(clock_.nowNs() + period_ns_);
+                return;
+            }
+
+            if (ticks_ <= 0)
+            {
+                locked_ = acquire();
+                ticks_ = locked_ ? CYCLE_SYNC_REACQUIRE_TICKS : CYCLE_SYNC_RETRY_TICKS;
+                failures_in_row_ = locked_ ? 0 : failures_in_row_ + 1;
+                if (failures_in_row_ >= CYCLE_SYNC_MAX_FAILURES)
+                {
+                    stopped_ = true;
+                    std::lock_guard<std::mutex> lock(stats_mutex_);
+                    stats_.stopped_ = true;
+                }
+            }
+            --ticks_;
+
+            // free running sample grid, wake-ups move to the predicted update nearest to the grid point
+            uint64_t now_ns = clock_.nowNs();
+            grid_ns_ = (grid_ns_ > 0) ? grid_ns_ + period_ns_ : now_ns + period_ns_;
+            if (grid_ns_ < now_ns)
+                grid_ns_ = now_ns;
+
+            uint64_t target_ns = grid_ns_;
+            if (locked_)
+            {
+                // plus guard for the update to complete
+                uint64_t base_ns = update_ns_ + CYCLE_SYNC_GUARD_US * 1000ULL;
+                uint64_t cycles = (target_ns > base_ns) ? (target_ns - base_ns + cycle_ns_ / 2) / cycle_ns_ : 0;
+                target_ns = std::max(base_ns + cycles * cycle_ns_, now_ns);
+            }
+
+            clock_.sleepUntilNs(target_ns);
+        }
+
+    private:
+        /// @brief Probe the I/O data until it changes (twice for the first burst, to check the nominal cycle).
+        /// @return true if the phase was measured
+        inline bool acquire()
+        {
+            uint64_t spacing_ns = CYCLE_SYNC_PROBE_US * 1000ULL;
+            uint64_t start_ns = clock_.nowNs();
+            uint64_t previous_ns = start_ns;
+            uint64_t previous_fingerprint = probe_();
+            uint64_t probes = 1;
+            uint64_t first_update_ns = 0;
+            uint64_t measured_cycle_ns = 0;
+            bool acquired = false;
+
+            while (previous_ns - start_ns < burst_ns_)
+            {
+                clock_.sleepUntilNs(previous_ns + spacing_ns);
+                uint64_t fingerprint = probe_();
+                uint64_t now_ns = clock_.nowNs();
+                ++probes;
+
+                if (fingerprint != previous_fingerprint)
+                {
+                    // the update happened before this probe, its time is known to the probe spacing
+                    if (verified_)
+                    {
+                        update_ns_ = now_ns;
+                        acquired = true;
+                        break;
+                    }
+                    else if (first_update_ns == 0)
+                    {
+                        first_update_ns = now_ns;
+                    }
+                    else
+                    {
+                        measured_cycle_ns = now_ns - first_update_ns;
+                        double deviation = static_cast<double>(measured_cycle_ns) / cycle_ns_ - 1.0;
+                        verified_ = (deviation < CYCLE_SYNC_CYCLE_TOLERANCE && deviation > -CYCLE_SYNC_CYCLE_TOLERANCE);
+                        update_ns_ = now_ns;
+                        acquired = verified_;
+                        break;
+                    }
+                }
+
+                previous_ns = now_ns;
+                previous_fingerprint = fingerprint;
+            }
+
+            std::lock_guard<std::mutex> lock(stats_mutex_);
+            stats_.locked_ = acquired;
+            if (measured_cycle_ns > 0)
+                stats_.measured_cycle_ns_ = measured_cycle_ns;
+            stats_.probes_ += probes;
+            if (acquired)
+                ++stats_.acquisitions_;
+            else
+                ++stats_.failures_;
+
+            return acquired;
+        }
+
+        clock_t clock_;
+        probe_t probe_;
+        uint64_t period_ns_;
+        uint64_t cycle_ns_;
+        uint64_t burst_ns_;
+        std::atomic<bool> enabled_;
+
+        /// @brief set by setEnabled(true), the monitor thread resets the lock state on its next wait
+        std::atomic<bool> rearm_;
+
+        /// @brief lock state, only accessed from the monitor thread
+        bool locked_;
+        bool verified_;
+        bool stopped_;
+        uint64_t update_ns_;
+        uint64_t grid_ns_;
+        int ticks_;
+        int failures_in_row_;
+
+        mutable std::mutex stats_mutex_;
+        CycleSyncStats stats_;
+    };
+
+} // namespace kswx_weiss_gripkit
+
+#endif // KR2_CBUN_CYCLE_SYNC
@@ -0,0 +1,169 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2023, KR Soft s.r.o.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the Kassow Robots nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#ifndef KR2_CBUN_FLIGHT_RECORDER
+#define KR2_CBUN_FLIGHT_RECORDER
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <time.h>
+
+#define FLIGHT_RECORDER_MAGIC 0x52464b47
+#define FLIGHT_RECORDER_VERSION 1
+
+namespace kswx_weiss_gripkit {
+
+    /// @brief One monitor tick as stored in the flight recorder file.
+    struct FlightRecord
+    {
+        /// @brief CLOCK_REALTIME timestamp of the GPIO sample in nanoseconds
+        uint64_t timestamp_ns;
+
+        /// @brief request id from shared memory at the time of the tick
+        uint64_t request_id;
+
+        /// @brief raw voltage of the gripped input, NaN if the input was not found
+        float gripped_voltage;
+
+        /// @brief raw voltage of the no error input, NaN if the input was not found
+        float no_error_voltage;
+
+        /// @brief decoded GripkitCrEasyStatus
+        uint8_t status;
+
+        /// @brief GripkitAction picked up from shared memory in this tick
+        uint8_t action;
+
+        uint16_t reserved;
+
+        /// @brief lower 32 bits of (record index + 1), written last; a mismatch marks an unwritten or torn record
+        uint32_t sequence;
+    };
+
+    static_assert(sizeof(FlightRecord) == 32, "FlightRecord layout changed, bump FLIGHT_RECORDER_VERSION");
+
+    /// @brief Header at the beginning of the flight recorder file, followed by capacity FlightRecords.
+    struct FlightRecorderHeader
+    {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t record_size;
+        uint32_t capacity;
+
+        /// @brief total number of records written, the next record goes to slot write_index % capacity
+        std::atomic<uint64_t> write_index;
+
+        uint8_t reserved[40];
+    };
+
+    static_assert(sizeof(FlightRecorderHeader) == 64, "FlightRecorderHeader layout changed, bump FLIGHT_RECORDER_VERSION");
+
+    /// @brief Always-on recorder of monitor ticks into a fixed-size memory-mapped ring file. The file survives crashes and restarts
+    /// of the process and can be converted to CSV with the weiss_gripkit_flight_dump tool. Single writer, record() does no syscalls.
+    class FlightRecorder
+    {
+    public:
+        inline FlightRecorder() : header_(nullptr), records_(nullptr), capacity_(0), size_(0) {}
+
+        inline virtual ~FlightRecorder() { close(); }
+
+        FlightRecorder(const FlightRecorder&) = delete;
+        FlightRecorder& operator=(const FlightRecorder&) = delete;
+
+        /// @brief Open (or create) the ring file and map it to memory. Records already in the file are kept if its layout matches,
+        /// otherwise the file is reinitialized.
+        /// @param path path to the ring file
+        /// @param capacity number of records in the ring
+        /// @return true on success, false otherwise (recorder stays closed, record() does nothing)
+        bool open(const std::string& path, uint32_t capacity);
+
+        /// @brief Unmap the ring file. Must not be called while another thread is inside record().
+        void close();
+
+        /// @brief Return true if the ring file is mapped.
+        inline bool isOpen() const { return header_ != nullptr; }
+
+        /// @brief Append a record to the ring, overwriting the oldest one if full. Only memory writes, no syscalls.
+        /// Not thread-safe, called from the status monitoring thread only.
+        inline void record(FlightRecord record)
+        {
+            if (!header_)
+                return;
+
+            uint64_t index = header_->write_index.load(std::memory_order_relaxed);
+            FlightRecord* slot = &records_[index % capacity_];
+
+            // invalidate the slot first, so a reader never takes a half-written record for a valid one
+            reinterpret_cast<std::atomic<uint32_t>*>(&slot->sequence)->store(0, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+
+            record.sequence = static_cast<uint32_t>(index + 1);
+            slot->timestamp_ns = record.timestamp_ns;
+            slot->request_id = record.request_id;
+            slot->gripped_voltage = record.gripped_voltage;
+            slot->no_error_voltage = record.no_error_voltage;
+            slot->status = record.status;
+            slot->action = record.action;
+            slot->reserved = 0;
+
+            reinterpret_cast<std::atomic<uint32_t>*>(&slot->sequence)->store(record.sequence, std::memory_order_release);
+            header_->write_index.store(index + 1, std::memory_order_release);
+        }
+
+        /// @brief Current CLOCK_REALTIME in nanoseconds (vDSO, no syscall).
+        static inline uint64_t now()
+        {
+            struct timespec ts;
+            clock_gettime(CLOCK_REALTIME, &ts);
+            return static_cast<uint64_t>(ts.tv_sec) * 1000000000ULL + static_cast<uint64_t>(ts.tv_nsec);
+        }
+
+        /// @brief Read all valid records from a ring file in chronological order. Can be used while the recorder is running.
+        /// @param path path to the ring file
+        /// @param records output, valid records ordered from the oldest to the newest
+        /// @return true on success, false if the file could not be read or is not a flight recorder file
+        static bool read(const std::string& path, std::vector<FlightRecord>& records);
+
+    private:
+        FlightRecorderHeader* header_;
+        FlightRecord* records_;
+        uint32_t capacity_;
+        size_t size_;
+    };
+
+} // namespace kswx_weiss_gripkit
+
+#endif // KR2_CBUN_FLIGHT_RECORDER
@@ -35,102 +35,74 @@
 #ifndef KR2_CBUN_GRIPKIT_CR_EASY
 #define KR2_CBUN_GRIPKIT_CR_EASY
 
+#include "weiss_gripkit/gripkit_types.h"
+#include "weiss_gripkit/gripkit_logic.h"
 #include "weiss_gripkit/value_monitor.h"
 #include "weiss_gripkit/shared_memory.h"
+#include "weiss_gripkit/flight_recorder.h"
+#include "weiss_gripkit/load_variable.h"
+#include "weiss_gripkit/payload_registry.h"
+#include "weiss_gripkit/stroke_model.h"
+#include "weiss_gripkit/action_request.h"
+#include "weiss_gripkit/signal_health.h"
+#include "weiss_gripkit/control_channel.h"
+#include "weiss_gripkit/status_view.h"
+#include "weiss_gripkit/profiler.h"
+#include "weiss_gripkit/cycle_sync.h"
+#include "weiss_gripkit/status_events.h"
+#include "weiss_gripkit/gripper_macro.h"
+#include "weiss_gripkit/metrics.h"
+#include "weiss_gripkit/rpc_service.h"
+#include "weiss_gripkit/gripper_lease.h"
+#include "weiss_gripkit/monitor_tick.h"
 
 #include <kr2_program_api/api_v1/bundles/custom_device.h>
+#include <kr2_program_api/api_v1/cbun/xmlrpc/xmlrpc_server.h>
 #include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
 
-#define INPUT_HIGH_VOLTAGE 12
 #define SHM_GLOBAL_ID "kswx_weiss_gripkit.gkeasy"
-#define NO_LOAD kr2_program_api::Load(0.0, kr2_program_api::Position(0.0, 0.0, 0.0), kr2_program_api::Imx(0.001, 0.001, 0.001, 0.0, 0.0, 0.0))
-#define MIN_CONTINUOUS_ERROR_COUNT 4
 #define US_SLEEP_GRIP_RELEASE 10000
+#define FLIGHT_RECORDER_FILE "/var/tmp/" SHM_GLOBAL_ID ".rec"
+#define FLIGHT_RECORDER_CAPACITY 65536
+#define PAYLOAD_COALESCE_TICKS 3
+#define STROKE_MODEL_FILE "/var/tmp/" SHM_GLOBAL_ID ".stroke"
+#define CONTROL_SOCKET_FILE "/var/tmp/" SHM_GLOBAL_ID ".sock"
+#define METRICS_TEXTFILE "/var/tmp/" SHM_GLOBAL_ID ".prom"
+#define METRICS_SOCKET_FILE "/var/tmp/" SHM_GLOBAL_ID ".metrics.sock"
+#define MONITOR_PERIOD_MS 10
+#define CONTROLLER_IO_CYCLE_US 1000
+#define POWER_OFF_DELAY_MS 3000
+#define POWER_CYCLE_OFF_MS 200
+
+// bits of getState()
+#define STATE_STATUS_MASK 0x07
+#define STATE_ACTIVATED 0x08
+#define STATE_MOUNTED 0x10
+#define STATE_STALE 0x20
+#define STATE_FAULT 0x40
+
+// waitForStatus wakes up at least this often to notice a stopped status monitor
+#define WAIT_STATUS_CHECK_MS 50
+#define WAIT_STATUS_MASK_ALL 0x1F
+#define WAIT_STATUS_MAX_TIMEOUT_MS 3600000
+
+// waitForStatus results other than a status
+#define WAIT_STATUS_TIMEOUT -1
+#define WAIT_STATUS_UNAVAILABLE -2
 
 namespace kswx_weiss_gripkit {
     
-    /// @brief Structure containing load data, can be used in shared memory.
-    struct LoadData
-    {
-        /// @brief Constructor for empty load (small values in inertial matrix).
-        inline LoadData() : LoadData(NO_LOAD) {}
-
-        /// @brief Construct LoadData from data in a specified Load.
-        explicit inline LoadData(kr2_program_api::Load load)
-        {
-            mass = load.mass().d();
-
-            x = load.cog().x().d();
-            y = load.cog().y().d();
-            z = load.cog().z().d();
-
-            xx = load.imx().xx().d();
-            yy = load.imx().yy().d();
-            zz = load.imx().zz().d();
-            xy = load.imx().xy().d();
-            xz = load.imx().xz().d();
-            yz = load.imx().yz().d();
-        }
-
-        /// @brief Create Load object based on saved LoadData.
-        kr2_program_api::Load toLoad()
-        {
-            return kr2_program_api::Load(mass, kr2_program_api::Position(x, y, z), kr2_program_api::Imx(xx, yy, zz, xy, xz, yz));
-        }
-
-        double mass;
-        double x, y, z;
-        double xx, yy, zz, xy, xz, yz;
-    };
-
-    /// @brief Gripper actions.
-    enum class GripkitAction { GRIP, RELEASE, NONE };
-
-    /// @brief Gripkit cbun exception.
-    class GripkitException : public std::exception {
-    public:
-
-        /// @brief Create the gripkit cbun exception.
-        /// @param msg exception message
-        inline GripkitException(const std::string &msg)
-        {
-            msg_ = std::string("kswx_weiss_gripkit::GripkitException: " + msg);
-        }
-        
-        /// @brief Get the exception message.
-        inline const char* what() const throw() {
-            return msg_.c_str();
-        }
-        
-    protected:
-        std::string msg_;
-    };
-
-    /// @brief Status of the CrEasy gripper and CBun.
-    enum class GripkitCrEasyStatus
-    {
-        /// @brief gripper deactivated or gripper error present
-        IDLE_OR_ERROR,
-
-        /// @brief workpiece released
-        RELEASED,
-
-        /// @brief no workpiece detected
-        NO_PART,
-
-        /// @brief workpiece gripped
-        HOLDING,
-
-        /// @brief error while reading the status
-        STATUS_ERROR
-    };
-
     /// @brief Class implementing the Gripkit CrEasy gripper device.
     class GripkitCrEasy : public kr2_bundle_api::CustomDevice {
     public:
 
         GripkitCrEasy(boost::shared_ptr<kr2_program_api::ProgramInterface> api, const boost::property_tree::ptree &xml_bundle_node);
-        virtual ~GripkitCrEasy() = default;
+
+        /// @brief Power off a gripper still waiting for a scheduled power off.
+        virtual ~GripkitCrEasy();
 
 
 
@@ -149,7 +121,7 @@ namespace kswx_weiss_gripkit {
         /// @return always 0
         virtual int onBind();
 
-        /// @brief Set activated to false.
+        /// @brief Set activated to false and release the gripper lease of the ending sequence. Power off is left to the master instance.
         /// @return always 0
         virtual int onUnbind();
 
@@ -173,6 +145,39 @@ namespace kswx_weiss_gripkit {
         /// @return ok on success, error if not activated, exception if internal error or bad status occurred 
         virtual CBUN_PCALL release(bool blocking);
 
+        /// @brief Define the payload of a slot for gripPayload, replacing the previous definition. Definitions are kept until the CBun is destroyed.
+        /// @param slot slot id, 1 to PAYLOAD_SLOT_COUNT
+        /// @param payload load set to LOAD2 when the gripper detects a part after gripPayload with this slot, in relation to the tool flange
+        /// @return ok on success, error if the slot id is out of range, exception if internal error occurred
+        virtual CBUN_PCALL registerPayload(kr2_program_api::Number slot, kr2_program_api::Load payload);
+
+        /// @brief Same as grip, with the payload given by a slot defined by registerPayload. The status monitor applies the load converted at
+        /// registration time, grip only passes the slot id.
+        /// @param blocking see grip
+        /// @param slot slot id, PAYLOAD_SLOT_NONE (0) to clear LOAD2
+        /// @return ok on success, error if not activated or the slot is not defined, exception if internal error or bad status occurred
+        virtual CBUN_PCALL gripPayload(bool blocking, kr2_program_api::Number slot);
+
+        /// @brief Run a macro defined by the defineMacro XML-RPC method and wait for it to finish. The status monitor executes all steps,
+        /// one blocking call replaces a sequence of grip/release calls and status checks.
+        /// @param macro macro slot, 1 to MACRO_SLOT_COUNT
+        /// @param payload payload slot applied by grip steps, see gripPayload
+        /// @return ok when the macro finished or was interrupted by another call, error if not activated or the macro or payload slot
+        /// is not defined, exception if a wait step timed out or failed on bad status, or on internal error
+        virtual CBUN_PCALL runMacro(kr2_program_api::Number macro, kr2_program_api::Number payload);
+
+        /// @brief Acquire exclusive use of the gripper for the calling sequence, or renew it. While held, grip/release/macro requests of
+        /// other sequences are rejected instead of interrupting the owner's strokes, operator requests override it. The owner renews the
+        /// lease every LEASE_RENEW_MS while it runs, it expires LEASE_DURATION_MS later when the owner hangs, or when the owner exits.
+        /// @param priority queue priority while waiting for another owner, higher is served first
+        /// @param timeout_ms maximum wait in milliseconds, 0 to fail at once
+        /// @return ok when granted, error if not granted within the timeout, exception if internal error occurred
+        virtual CBUN_PCALL acquireGripper(kr2_program_api::Number priority, kr2_program_api::Number timeout_ms);
+
+        /// @brief Release the gripper lease of the calling sequence, if it holds it.
+        /// @return always ok
+        virtual CBUN_PCALL releaseGripper();
+
 
 
 
@@ -190,6 +195,45 @@ namespace kswx_weiss_gripkit {
         /// @brief Return 1 if gripper status is IDLE_OR_ERROR, 0 otherwise.
         virtual kr2_program_api::Number isError();
 
+        /// @brief Blocking grip returning the final status, replaces grip followed by isHolding/isNoPart/isError calls.
+        /// @param payload see grip
+        /// @return GripkitCrEasyStatus after the stroke: HOLDING or NO_PART when done, the current status if interrupted,
+        /// STATUS_ERROR if the action failed (lease refused, stroke timeout, error status, stale or unreadable status),
+        /// IDLE_OR_ERROR if not activated; never raises an error. Enum order, unlike XML-RPC getStatus (1 holding, 3 released).
+        virtual kr2_program_api::Number gripAndGetStatus(boost::optional<kr2_program_api::Load> payload);
+
+        /// @brief Blocking release returning the final status, see gripAndGetStatus.
+        /// @return GripkitCrEasyStatus after the stroke: RELEASED when done
+        virtual kr2_program_api::Number releaseAndGetStatus();
+
+        /// @brief Return status, activation, mounting and fault in one number, never raises an error.
+        /// @return GripkitCrEasyStatus in STATE_STATUS_MASK (STATUS_ERROR if not available), STATE_ACTIVATED, STATE_MOUNTED,
+        /// STATE_STALE if the status is not available (monitor not running), STATE_FAULT if activated with an error status
+        virtual kr2_program_api::Number getState();
+
+        /// @brief Sleep until the gripper status is one of status_mask, replaces polling isHolding etc. in a loop. The status monitor
+        /// wakes the caller through shm_status_event_ within the tick of the transition.
+        /// @param status_mask bit (1 << GripkitCrEasyStatus) per accepted status: 1 IDLE_OR_ERROR, 2 RELEASED, 4 NO_PART, 8 HOLDING,
+        /// 16 STATUS_ERROR; raises an error for 0, values above WAIT_STATUS_MASK_ALL and non-integers
+        /// @param timeout_ms maximum time to wait, 0 checks the current status only, at most WAIT_STATUS_MAX_TIMEOUT_MS
+        /// @return the accepted GripkitCrEasyStatus, WAIT_STATUS_TIMEOUT (-1) on timeout, WAIT_STATUS_UNAVAILABLE (-2) if the status
+        /// is stale (monitor not running) or the shared memory is not initialized
+        virtual kr2_program_api::Number waitForStatus(kr2_program_api::Number status_mask, kr2_program_api::Number timeout_ms);
+
+
+
+
+        // in-process event subscription
+
+        /// @brief Subscribe an observer to status transitions, action completions and faults selected by event_mask (StatusEventType bits).
+        /// Events come from the status monitoring thread of the master instance, the observer is called from its own executor thread.
+        /// @return subscription id, -1 if no subscription slot is free
+        int subscribeStatus(StatusObserver* observer, unsigned int event_mask = STATUS_EVENT_ALL);
+
+        /// @brief Remove a subscription, the observer is not called after return. Must not be called from the observer.
+        /// @return false if the id is not subscribed
+        bool unsubscribeStatus(int subscription_id);
+
 
 
         
@@ -219,16 +263,55 @@ namespace kswx_weiss_gripkit {
 
         /// @brief Common method for performing GRIP or RELEASE. Check activation, share load to shared memory for GRIP to be set on move finished,
         /// increment request id, send request (processed in onTick called from value_monitor_), and if blocking wait for finish or interrupt.
+        /// Blocking wait fails fast if the published status gets stale (monitor not running) or the stroke takes longer than the adaptive deadline.
         /// @param action action to perform, GRIP or RELEASE
         /// @param blocking True for a blocking call, returns after move is finished or sooner if interrupted by another grip/release call.
         /// @param payload Payload to set if gripper detects part - will be set after the move finishes, which can be after non-blocking call returns.
         /// @return ok on success, error if not activated, exception if internal error or bad status occurred 
-        CBUN_PCALL performActionCommon(GripkitAction action, bool blocking, boost::optional<kr2_program_api::Load> payload);
+        /// @param payload_slot slot of the payload for GRIP, PAYLOAD_SLOT_INLINE to use payload instead
+        /// @param final_status set to the status that ended a blocking wait (DONE or interrupted), left unchanged otherwise
+        /// @param operator_request true for operator requests (XML-RPC, control channel), which override a lease of a sequence
+        CBUN_PCALL performActionCommon(GripkitAction action, bool blocking, boost::optional<kr2_program_api::Load> payload,
+            int payload_slot = PAYLOAD_SLOT_INLINE, GripkitCrEasyStatus* final_status = NULL, bool operator_request = false);
 
-        /// @brief Read gripper status from shared memory and return in; Throw GripkitException on failure to access shared memory.
+        /// @brief Check the gripper lease for a grip/release/macro request of the calling process, renewing it if held by the caller.
+        /// @param operator_request admit an operator request even if a sequence holds the lease
+        /// @return true if the lease is free, held by the calling process or overridden by the operator
+        bool admitRequest(bool operator_request);
+
+        /// @brief Renew the lease of this process every LEASE_RENEW_MS in a helper thread until stopLeaseKeeper or the lease is lost.
+        void startLeaseKeeper();
+
+        /// @brief Stop the helper thread of startLeaseKeeper, if running.
+        void stopLeaseKeeper();
+
+        /// @brief Common method of gripAndGetStatus and releaseAndGetStatus. Perform a blocking action and return the final status.
+        kr2_program_api::Number actionAndGetStatus(GripkitAction action, boost::optional<kr2_program_api::Load> payload);
+
+        /// @brief Read gripper status from shared memory and return in; Throw GripkitException on failure to access shared memory
+        /// or if the status is stale (monitor not running).
+        /// Throwing adapter of queryStatusSharedMemory, for use at the API boundary only.
         GripkitCrEasyStatus getStatusSharedMemory();
 
+        /// @brief Throw GripkitException if the queried status is not available (shared memory not initialized or status stale).
+        void checkStatusAvailable(const StatusQuery& query);
+
+        /// @brief Read gripper status from shared memory without throwing, for internal callers and wait loops.
+        /// @return status, or error if shared memory is not accessible, the status could not be read or is stale
+        StatusQuery queryStatusSharedMemory();
+
+        /// @brief Register a XML-RPC method on xmlrpc_server_, executed by rpc_service_ with per-method statistics.
+        /// @param int_result true if the method returns an int, answered -1 if busy or failed; struct methods are answered
+        /// success 0 with the error
+        /// @param long_running true if the method may block, eg. waits for a stroke
+        void addRpcMethod(const std::string& name, boost::shared_ptr<kr2_xmlrpc::Method> method, bool int_result, bool long_running = false);
+
+        /// @brief Answer a STATUS/GRIP/RELEASE request of the binary control channel. Called from the control_server_ thread,
+        /// grip and release are always non-blocking, completion is reported by status change events.
+        void handleControlRequest(const ControlRequest& request, ControlMessage& response);
+
         /// @brief Common method for status requests. Read gripper status from shared memory and return 1 if it matches checkedStatus, 0 otherwise.
+        /// A status read error counts as IDLE_OR_ERROR; throws GripkitException only if the status is stale or not initialized.
         kr2_program_api::Number isCommon(GripkitCrEasyStatus checkedStatus);
 
         /// @brief Read gripped and no_error pins from gpio. Return STATUS_ERROR, if the values were not found. Otherwise return the actual status.
@@ -236,14 +319,32 @@ namespace kswx_weiss_gripkit {
         /// @return gripper status or STATUS_ERROR if status could not be read
         GripkitCrEasyStatus getStatus();
 
-        /// @brief Called by value_monitor_ when gripper status changes. Set payload from shared memory if status changed to HOLDING.
-        /// Set no payload if status changed to NO_PART or RELEASED.
+        /// @brief Read the gripper inputs without decoding them, for phase acquisition of cycle_sync_. Only called in the status monitoring thread.
+        /// @return fingerprint of the input voltages, changes with every I/O update of the controller
+        uint64_t probeIOFrame();
+
+        /// @brief Called by value_monitor_ when gripper status changes. Set payload selected in shm_payload_ if status changed to HOLDING.
+        /// Set no payload if status changed to NO_PART or RELEASED. Payload writes go through payload_writer_.
+        /// Send the new status to control channel subscribers.
         void onStatusChange(GripkitCrEasyStatus newStatus);
 
-        /// @brief Called by value_monitor_ in every loop cycle. Update gripper status in shared memory and 
-        /// process gripper action requests (GRIP/RELEASE or NONE for no request).
+        /// @brief Called by value_monitor_ in every loop cycle. Publish gripper status with heartbeat to shared memory,
+        /// process gripper action requests (GRIP/RELEASE or NONE for no request) and macro steps, learn stroke times, update signal health statistics,
+        /// publish gripper events to status_events_, update metrics_, record the tick in flight_recorder_ and publish it to status_view_.
         void onTick(GripkitCrEasyStatus newStatus);
 
+        /// @brief Update metrics_ with the outcome of a monitor tick and publish them to metrics_buffer_ every METRICS_PUBLISH_TICKS ticks.
+        /// Only called in the status monitoring thread.
+        /// @param events StatusEventType bits produced by monitor_tick_ in this tick
+        /// @param tick_start_ns CLOCK_MONOTONIC time at the start of onTick
+        void updateMetrics(GripkitCrEasyStatus status, GripkitAction picked_action, unsigned int events, uint64_t tick_start_ns);
+
+        /// @brief Pick up a macro run request, advance the running macro and publish its result when it finishes.
+        /// Only called in the status monitoring thread.
+        /// @param requested_action action picked up from shm_action_ in this tick, interrupts the running macro
+        /// @return action of the macro to apply in this tick, NONE if there is none or requested_action takes precedence
+        GripkitAction tickMacro(GripkitCrEasyStatus status, GripkitAction requested_action);
+
         /// @brief Set digital output identified by its DUID to specified state and configuration.
         /// @param gpio_id DUID, id of the gpio pin
         /// @param state true for on, false for off
@@ -255,6 +356,18 @@ namespace kswx_weiss_gripkit {
         /// @return true on success (generation supported), false otherwise
         bool setupGPIO(int robot_generation);
 
+        /// @brief Disable grip, activation and power outputs.
+        void powerOff();
+
+        /// @brief Power off after POWER_OFF_DELAY_MS in a helper thread, unless cancelled by cancelPowerOff. Keeps the gripper powered
+        /// and its grip output unchanged for a quick re-activation.
+        void schedulePowerOff();
+
+        /// @brief Cancel a scheduled power off and wait for the helper thread. Callers switch the outputs off themselves when
+        /// the instance goes away, the helper thread never outlives it.
+        /// @return true if the power off was cancelled before it ran, ie. the outputs are still asserted
+        bool cancelPowerOff();
+
 
 
 
@@ -266,6 +379,12 @@ namespace kswx_weiss_gripkit {
         /// @brief pointer to the system payload variable
         boost::shared_ptr<kr2_program_api::Load> payload_;
 
+        /// @brief change-only writes to toolload_, used from the device API thread
+        LoadVariableWriter toolload_writer_;
+
+        /// @brief change-only, coalesced writes to payload_, used from the status monitoring thread
+        LoadVariableWriter payload_writer_;
+
 
 
         /// @brief thread-safe activated flag, true after onActivate (activates gripper communication) and 
@@ -281,8 +400,22 @@ namespace kswx_weiss_gripkit {
         /// master instance sets load on gripper status change, so that non-blocking sequence calls can return
         SharedMemoryObject<SynchronizedData<LoadData>> shm_load_;
 
-        /// @brief shared memory for sharing status from master instance (reads status periodically in value_monitor_) to sequences
-        SharedMemoryObject<SynchronizedData<GripkitCrEasyStatus>> shm_status_;
+        /// @brief shared memory for payloads registered by slot and the payload selected by the last grip
+        SharedMemoryObject<PayloadTable> shm_payload_;
+
+        /// @brief shared memory for macros defined by slot and the macro run request/result
+        SharedMemoryObject<MacroShared> shm_macro_;
+
+        /// @brief shared memory for the optional gripper lease of one sequence and its contention counters
+        SharedMemoryObject<GripperLease> shm_lease_;
+
+        /// @brief shared memory for sharing status from master instance (reads status periodically in value_monitor_) to sequences,
+        /// with sequence number, sample timestamp and monitor heartbeat for staleness checks
+        SharedMemoryObject<SynchronizedData<PublishedStatus>> shm_status_;
+
+        /// @brief shared memory for status change notifications, master instance notifies on every status transition, sequences
+        /// sleep on it in waitForStatus
+        SharedMemoryObject<SharedEventCount> shm_status_event_;
 
         /// @brief shared memory for requesting action (GRIP/RELEASE), sequence requests and master instance processes the request.
         SharedMemoryObject<SynchronizedData<GripkitAction>> shm_action_;
@@ -290,6 +423,15 @@ namespace kswx_weiss_gripkit {
         /// @brief shared memory for current request id, sequences use this to find out when their request has been interrupted.
         SharedMemoryObject<SynchronizedIncrement> shm_request_id_;
 
+        /// @brief shared memory for adaptive deadlines of blocking calls, master instance updates them from the stroke model of monitor_tick_.
+        SharedMemoryObject<SynchronizedData<StrokeDeadlines>> shm_stroke_;
+
+        /// @brief shared memory for input signal health statistics, master instance publishes it periodically from monitor_tick_.
+        SharedMemoryObject<SynchronizedData<SignalHealth>> shm_signal_;
+
+        /// @brief shared memory for hot-path stage histograms, created by master instance only if built with WEISS_GRIPKIT_PROFILE.
+        SharedMemoryObject<ProfileData> shm_profile_;
+
 
 
         // DUIDs and config ids for gpio communication with gripper.
@@ -305,8 +447,112 @@ namespace kswx_weiss_gripkit {
             unsigned int config_disabled_;
         } gpio_setup_;
 
+        /// @brief robot generation of gpio_setup_, 0 before the first activation
+        int robot_generation_;
+
+        /// @brief keep a healthy gripper powered for POWER_OFF_DELAY_MS after deactivation, activation parameter keep_powered
+        bool keep_powered_;
+
+        /// @brief helper thread of schedulePowerOff and its state
+        std::thread power_off_thread_;
+        std::mutex power_off_mutex_;
+        std::condition_variable power_off_cv_;
+        bool power_off_pending_;
+
+        /// @brief helper thread of startLeaseKeeper and its state
+        std::thread lease_keeper_thread_;
+        std::mutex lease_keeper_mutex_;
+        std::condition_variable lease_keeper_cv_;
+        bool lease_keeper_running_;
+
+        /// @brief raw input values of the last getStatus call, only accessed from the status monitoring thread
+        GripkitSample last_sample_;
+
+        /// @brief prepared payloads of shm_payload_, only accessed from the status monitoring thread
+        PayloadCache payload_cache_;
+
+        /// @brief macro run picked up from shm_macro_, only accessed from the status monitoring thread
+        MacroRunner macro_runner_;
+
+        /// @brief device counters and latencies, only accessed from the status monitoring thread
+        MetricsSnapshot metrics_;
+
+        /// @brief sample time of the previous tick for monitor overrun detection, 0 after activation
+        uint64_t metrics_previous_sample_ns_;
+
+        /// @brief snapshots of metrics_ for metrics_exporter_
+        MetricsBuffer metrics_buffer_;
+
+        /// @brief OpenMetrics export to METRICS_TEXTFILE and METRICS_SOCKET_FILE, master instance only
+        MetricsExporter metrics_exporter_;
+
+        /// @brief ring file with every monitor tick for post-mortem analysis, opened in master instance only
+        FlightRecorder flight_recorder_;
+
+        /// @brief monitor tick shared with the gripper daemon: status sequence, event source, learned stroke times (master instance
+        /// only) and signal health, only accessed from the status monitoring thread except its stroke model
+        MonitorTick monitor_tick_;
+
+        /// @brief lock-free read-only status snapshot for external processes, created in master instance only
+        StatusViewWriter status_view_;
+
+        /// @brief last snapshot written to status_view_ with its counters, only accessed from the status monitoring thread
+        StatusViewData status_view_data_;
+
+        /// @brief observers of gripper events, outlives value_monitor_ which publishes to it
+        StatusEventHub status_events_;
+
+        /// @brief Binds value_monitor_ to getStatus, onStatusChange and onTick without type erasure.
+        struct StatusMonitorPolicy
+        {
+            inline GripkitCrEasyStatus getValue() { return device_->getStatus(); }
+            inline void onValueChanged(GripkitCrEasyStatus newStatus) { device_->onStatusChange(newStatus); }
+            inline void onTick(GripkitCrEasyStatus newStatus) { device_->onTick(newStatus); }
+
+            GripkitCrEasy* device_;
+        };
+
+        /// @brief Binds monitor_tick_ to the macro runner and the grip output.
+        struct MonitorTickPolicy
+        {
+            GripkitAction pickAction(GripkitCrEasyStatus status, GripkitAction requested);
+            void applyAction(GripkitAction action);
+
+            GripkitCrEasy* device_;
+        };
+
+        /// @brief Binds cycle_sync_ to probeIOFrame.
+        struct StatusProbe
+        {
+            inline uint64_t operator()() { return device_->probeIOFrame(); }
+
+            GripkitCrEasy* device_;
+        };
+
+        /// @brief Waits of value_monitor_, free running or synchronized to the controller I/O cycle.
+        struct StatusMonitorWait
+        {
+            inline void operator()() { sync_->wait(); }
+
+            CycleSync<MonotonicClockSource, StatusProbe>* sync_;
+        };
+
+        /// @brief sampling schedule of the status monitoring thread
+        CycleSync<MonotonicClockSource, StatusProbe> cycle_sync_;
+
         /// @brief status monitoring thread
-        ValueMonitor<GripkitCrEasyStatus> value_monitor_;
+        BasicValueMonitor<GripkitCrEasyStatus, StatusMonitorPolicy, StatusMonitorWait> value_monitor_;
+
+        /// @brief admission of long-running calls and call statistics of the XML-RPC methods
+        RpcService rpc_service_;
+
+        /// @brief XML-RPC methods of the device, registered in the constructor and kept for the lifetime of the device;
+        /// destroyed before rpc_service_ which runs them
+        kr2_xmlrpc::XmlRpcServer xmlrpc_server_;
+
+        /// @brief binary control channel on CONTROL_SOCKET_FILE, master instance only; declared last so that its thread
+        /// is stopped before the members used by handleControlRequest are destroyed
+        ControlServer control_server_;
     };
 
 } // namespace kswx_weiss_gripkit
@@ -0,0 +1,359 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2023, KR Soft s.r.o.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the Kassow Robots nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#ifndef KR2_CBUN_GRIPKIT_LOGIC
+#define KR2_CBUN_GRIPKIT_LOGIC
+
+#include "weiss_gripkit/gripkit_types.h"
+#include "weiss_gripkit/shared_memory.h"
+
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <time.h>
+
+#define INPUT_HIGH_VOLTAGE 12
+#define MIN_CONTINUOUS_ERROR_COUNT 4
+#define STATUS_STALE_MS 200
+
+namespace kswx_weiss_gripkit {
+
+    /// @brief Raw gripper inputs read in one status sample.
+    struct GripkitSample
+    {
+        /// @brief CLOCK_REALTIME timestamp of the sample in nanoseconds
+        uint64_t timestamp_ns_;
+
+        /// @brief CLOCK_MONOTONIC timestamp of the sample in nanoseconds, comparable between processes
+        uint64_t monotonic_ns_;
+
+        /// @brief voltage of the gripped input, NaN if the input was not found
+        float gripped_voltage_;
+
+        /// @brief voltage of the no error input, NaN if the input was not found
+        float no_error_voltage_;
+    };
+
+    /// @brief Status published to shared memory by the status monitoring thread in every tick.
+    struct PublishedStatus
+    {
+        /// @brief decoded gripper status
+        GripkitCrEasyStatus status_;
+
+        /// @brief incremented with every publish, readers can tell a new sample from an old one
+        uint64_t sequence_;
+
+        /// @brief CLOCK_MONOTONIC timestamp of the GPIO sample in nanoseconds
+        uint64_t sample_time_ns_;
+
+        /// @brief CLOCK_MONOTONIC timestamp of the publish in nanoseconds, 0 if the monitor is not running
+        uint64_t heartbeat_ns_;
+    };
+
+    /// @brief Current CLOCK_MONOTONIC in nanoseconds (vDSO, no syscall).
+    inline uint64_t monotonicNowNs()
+    {
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return static_cast<uint64_t>(ts.tv_sec) * 1000000000ULL + static_cast<uint64_t>(ts.tv_nsec);
+    }
+
+    /// @brief Convert a program Number to an integer, casting NaN or an out of range double is undefined.
+    /// @return false if value is NaN, has a fraction or is outside [min, max]
+    template <typename integer_t>
+    inline bool toInteger(double value, integer_t min, integer_t max, integer_t& result)
+    {
+        if (!(value >= static_cast<double>(min) && value <= static_cast<double>(max)) || value != std::floor(value))
+            return false;
+
+        result = static_cast<integer_t>(value);
+        return true;
+    }
+
+    /// @brief Unsigned counter as int for XML-RPC replies, which carry 32-bit integers. Saturates at INT_MAX instead of wrapping negative.
+    template <typename integer_t>
+    inline int saturatingInt(integer_t value)
+    {
+        static_assert(std::numeric_limits<integer_t>::is_integer && !std::numeric_limits<integer_t>::is_signed, "unsigned counters only");
+        return (value > static_cast<unsigned int>(std::numeric_limits<int>::max())) ? std::numeric_limits<int>::max() : static_cast<int>(value);
+    }
+
+    /// @brief Scan GPIO float inputs for gripped and no error input voltages. Timestamp is left to the caller.
+    /// @tparam io_data_t kr2rc_api::IOData or any type providing read_N_GPIOFloat() and read_GPIOFloat(i) (ie. simulated I/O)
+    /// @param io_data I/O data to scan, already updated by the caller
+    /// @param duid_gripped DUID of the gripped input
+    /// @param duid_no_error DUID of the no error input
+    /// @param sample output, voltages set to NaN if the inputs were not found
+    template <typename io_data_t>
+    inline void readSample(io_data_t& io_data, uint32_t duid_gripped, uint32_t duid_no_error, GripkitSample& sample)
+    {
+        sample.gripped_voltage_ = std::numeric_limits<float>::quiet_NaN();
+        sample.no_error_voltage_ = std::numeric_limits<float>::quiet_NaN();
+
+        int gpio_float_count = io_data.read_N_GPIOFloat();
+        for (int i = 0; i < gpio_float_count; ++i)
+        {
+            const auto* data = io_data.read_GPIOFloat(i);
+
+            if (data)
+            {
+                if (data->gpio_id_ == duid_gripped)
+                    sample.gripped_voltage_ = data->value_;
+
+                if (data->gpio_id_ == duid_no_error)
+                    sample.no_error_voltage_ = data->value_;
+            }
+        }
+    }
+
+    /// @brief Decode gripper status from input voltages.
+    /// @return gripper status or STATUS_ERROR if any of the inputs was not found
+    inline GripkitCrEasyStatus decodeStatus(const GripkitSample& sample)
+    {
+        if (std::isnan(sample.gripped_voltage_) || std::isnan(sample.no_error_voltage_))
+            return GripkitCrEasyStatus::STATUS_ERROR;
+
+        bool gripped = sample.gripped_voltage_ > INPUT_HIGH_VOLTAGE;
+        bool no_error = sample.no_error_voltage_ > INPUT_HIGH_VOLTAGE;
+
+        if (gripped)
+            return no_error ? GripkitCrEasyStatus::HOLDING : GripkitCrEasyStatus::NO_PART;
+        else
+            return no_error ? GripkitCrEasyStatus::RELEASED : GripkitCrEasyStatus::IDLE_OR_ERROR;
+    }
+
+    /// @brief Result of a non-throwing status query, status is valid only if ok().
+    struct StatusQuery
+    {
+        enum class Error
+        {
+            /// @brief status read successfully
+            NONE,
+
+            /// @brief shared memory not initialized
+            NOT_INITIALIZED,
+
+            /// @brief monitor published STATUS_ERROR
+            READ_ERROR,
+
+            /// @brief monitor not running or stalled, heartbeat older than the allowed age
+            STALE
+        };
+
+        inline bool ok() const { return error_ == Error::NONE; }
+
+        GripkitCrEasyStatus status_;
+        Error error_;
+
+        /// @brief publish sequence number of the status
+        uint64_t sequence_;
+
+        /// @brief age of the monitor heartbeat in nanoseconds
+        uint64_t age_ns_;
+    };
+
+    /// @brief Read gripper status from shared memory, report failures in the result instead of throwing.
+    /// @param shm_status_sync status in shared memory, may be NULL if not initialized
+    /// @param now_ns current CLOCK_MONOTONIC time in nanoseconds
+    /// @param max_age_ns maximal age of the monitor heartbeat, older status is reported as STALE
+    inline StatusQuery queryStatus(SynchronizedData<PublishedStatus>* shm_status_sync, uint64_t now_ns, uint64_t max_age_ns = STATUS_STALE_MS * 1000000ULL)
+    {
+        if (!shm_status_sync)
+            return StatusQuery{ GripkitCrEasyStatus::STATUS_ERROR, StatusQuery::Error::NOT_INITIALIZED, 0, 0 };
+
+        PublishedStatus published = shm_status_sync->get();
+        uint64_t age_ns = (published.heartbeat_ns_ == 0) ? std::numeric_limits<uint64_t>::max()
+            : ((now_ns > published.heartbeat_ns_) ? now_ns - published.heartbeat_ns_ : 0);
+
+        if (age_ns > max_age_ns)
+            return StatusQuery{ published.status_, StatusQuery::Error::STALE, published.sequence_, age_ns };
+
+        if (published.status_ == GripkitCrEasyStatus::STATUS_ERROR)
+            return StatusQuery{ published.status_, StatusQuery::Error::READ_ERROR, published.sequence_, age_ns };
+
+        return StatusQuery{ published.status_, StatusQuery::Error::NONE, published.sequence_, age_ns };
+    }
+
+    /// @brief Result of isHolding, isReleased, isNoPart and isError for a status query: 1 if the status is checked_status, 0 otherwise.
+    /// A status read glitch (READ_ERROR) counts as IDLE_OR_ERROR. NOT_INITIALIZED and STALE are left to the caller.
+    inline long statusMatches(const StatusQuery& query, GripkitCrEasyStatus checked_status)
+    {
+        GripkitCrEasyStatus status = (query.error_ == StatusQuery::Error::READ_ERROR) ? GripkitCrEasyStatus::IDLE_OR_ERROR : query.status_;
+        return (status == checked_status) ? 1L : 0L;
+    }
+
+    /// @brief Evaluates statuses seen by a blocking grip/release call until the action finishes or fails.
+    class ActionWait
+    {
+    public:
+        enum class Result { PENDING, DONE, FAILED };
+
+        /// @param action awaited action, GRIP or RELEASE
+        inline explicit ActionWait(GripkitAction action) : action_(action), error_count_(0) {}
+
+        /// @brief Process the next status read from shared memory.
+        /// @return DONE if the action finished, FAILED if the error status repeated MIN_CONTINUOUS_ERROR_COUNT times, PENDING otherwise
+        inline Result update(GripkitCrEasyStatus status)
+        {
+            if (action_ == GripkitAction::GRIP && (status == GripkitCrEasyStatus::HOLDING || status == GripkitCrEasyStatus::NO_PART))
+                return Result::DONE;
+
+            if (action_ == GripkitAction::RELEASE && status == GripkitCrEasyStatus::RELEASED)
+                return Result::DONE;
+
+            if (status == GripkitCrEasyStatus::IDLE_OR_ERROR || status == GripkitCrEasyStatus::STATUS_ERROR)
+            {
+                // fail only if the error status repeats several times
+                // gripper sometimes returns error for a few short moments when switching from RELEASED to NO_PART
+                ++error_count_;
+                return (error_count_ >= MIN_CONTINUOUS_ERROR_COUNT) ? Result::FAILED : Result::PENDING;
+            }
+
+            error_count_ = 0;
+            return Result::PENDING;
+        }
+
+        /// @brief Number of continuous error statuses seen so far.
+        inline int errorCount() const { return error_count_; }
+
+    private:
+        GripkitAction action_;
+        int error_count_;
+    };
+
+    /// @brief How a picked up grip/release action ended.
+    enum class ActionResult : uint8_t
+    {
+        /// @brief gripper reached the target status
+        DONE,
+
+        /// @brief error status repeated MIN_CONTINUOUS_ERROR_COUNT times during the stroke
+        FAILED,
+
+        /// @brief another action was picked up before the stroke finished
+        INTERRUPTED
+    };
+
+    /// @brief Grip/release action picked up by the status monitor finished.
+    struct ActionCompletion
+    {
+        GripkitAction action_;
+        ActionResult result_;
+
+        /// @brief false if the gripper already reported the target status when the action was picked up, no stroke was measured
+        bool moved_;
+
+        /// @brief status that finished the action
+        GripkitCrEasyStatus status_;
+
+        /// @brief time from the pick up to the finishing sample in nanoseconds
+        uint64_t duration_ns_;
+
+        uint64_t sequence_;
+        uint64_t sample_time_ns_;
+    };
+
+    /// @brief Follows the grip/release actions picked up by the status monitor until they finish. The single source of action
+    /// completions for status events, metrics and stroke learning. Only accessed from the status monitoring thread.
+    class ActionTracker
+    {
+    public:
+        inline ActionTracker() : completion_(), wait_(GripkitAction::NONE) { reset(); }
+
+        /// @brief Forget any action in progress.
+        inline void reset()
+        {
+            waiting_ = false;
+            wait_ = ActionWait(GripkitAction::NONE);
+            wait_action_ = GripkitAction::NONE;
+            wait_moved_ = false;
+            wait_start_ns_ = 0;
+        }
+
+        /// @brief Process one monitor tick.
+        /// @param status status sampled in the tick, before the picked up action changed the outputs
+        /// @param picked_action action picked up in the tick, NONE if there was no request
+        /// @param sample_time_ns CLOCK_MONOTONIC time of the sample in nanoseconds
+        /// @return true if an action finished in this tick, see completion(); a tick finishes at most one action
+        inline bool update(GripkitCrEasyStatus status, GripkitAction picked_action, uint64_t sequence, uint64_t sample_time_ns)
+        {
+            bool completed = false;
+
+            // status sampled before the output changed finishes the action picked up in an earlier tick
+            if (waiting_)
+            {
+                ActionWait::Result result = wait_.update(status);
+                if (result == ActionWait::Result::DONE)
+                    completed = complete(ActionResult::DONE, status, sequence, sample_time_ns);
+                else if (result == ActionWait::Result::FAILED)
+                    completed = complete(ActionResult::FAILED, status, sequence, sample_time_ns);
+            }
+
+            if (picked_action == GripkitAction::GRIP || picked_action == GripkitAction::RELEASE)
+            {
+                if (waiting_)
+                    completed = complete(ActionResult::INTERRUPTED, status, sequence, sample_time_ns);
+
+                waiting_ = true;
+                wait_ = ActionWait(picked_action);
+                wait_action_ = picked_action;
+                wait_moved_ = ActionWait(picked_action).update(status) != ActionWait::Result::DONE;
+                wait_start_ns_ = sample_time_ns;
+            }
+
+            return completed;
+        }
+
+        /// @brief Last finished action, valid after update returned true.
+        inline const ActionCompletion& completion() const { return completion_; }
+
+    private:
+        inline bool complete(ActionResult result, GripkitCrEasyStatus status, uint64_t sequence, uint64_t sample_time_ns)
+        {
+            waiting_ = false;
+            completion_ = ActionCompletion{ wait_action_, result, wait_moved_, status, sample_time_ns - wait_start_ns_, sequence, sample_time_ns };
+            return true;
+        }
+
+        ActionCompletion completion_;
+        bool waiting_;
+        ActionWait wait_;
+        GripkitAction wait_action_;
+        bool wait_moved_;
+        uint64_t wait_start_ns_;
+    };
+
+} // namespace kswx_weiss_gripkit
+
+#endif // KR2_CBUN_GRIPKIT_LOGIC
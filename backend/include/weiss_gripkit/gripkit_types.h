@@ -0,0 +1,113 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2023, KR Soft s.r.o.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the Kassow Robots nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#ifndef KR2_CBUN_GRIPKIT_TYPES
+#define KR2_CBUN_GRIPKIT_TYPES
+
+#include <exception>
+#include <string>
+
+namespace kswx_weiss_gripkit {
+
+    /// @brief Gripper actions.
+    enum class GripkitAction { GRIP, RELEASE, NONE };
+
+    /// @brief Status of the CrEasy gripper and CBun.
+    enum class GripkitCrEasyStatus
+    {
+        /// @brief gripper deactivated or gripper error present
+        IDLE_OR_ERROR,
+
+        /// @brief workpiece released
+        RELEASED,
+
+        /// @brief no workpiece detected
+        NO_PART,
+
+        /// @brief workpiece gripped
+        HOLDING,
+
+        /// @brief error while reading the status
+        STATUS_ERROR
+    };
+
+    /// @brief Gripkit cbun exception.
+    class GripkitException : public std::exception {
+    public:
+
+        /// @brief Create the gripkit cbun exception.
+        /// @param msg exception message
+        inline GripkitException(const std::string &msg)
+        {
+            msg_ = std::string("kswx_weiss_gripkit::GripkitException: " + msg);
+        }
+        
+        /// @brief Get the exception message.
+        inline const char* what() const throw() {
+            return msg_.c_str();
+        }
+        
+    protected:
+        std::string msg_;
+    };
+
+    /// @brief Get printable name of the gripper action.
+    inline const char* toString(GripkitAction action)
+    {
+        switch (action)
+        {
+            case GripkitAction::GRIP:       return "GRIP";
+            case GripkitAction::RELEASE:    return "RELEASE";
+            case GripkitAction::NONE:       return "NONE";
+        }
+        return "UNKNOWN";
+    }
+
+    /// @brief Get printable name of the gripper status.
+    inline const char* toString(GripkitCrEasyStatus status)
+    {
+        switch (status)
+        {
+            case GripkitCrEasyStatus::IDLE_OR_ERROR:    return "IDLE_OR_ERROR";
+            case GripkitCrEasyStatus::RELEASED:         return "RELEASED";
+            case GripkitCrEasyStatus::NO_PART:          return "NO_PART";
+            case GripkitCrEasyStatus::HOLDING:          return "HOLDING";
+            case GripkitCrEasyStatus::STATUS_ERROR:     return "STATUS_ERROR";
+        }
+        return "UNKNOWN";
+    }
+
+} // namespace kswx_weiss_gripkit
+
+#endif // KR2_CBUN_GRIPKIT_TYPES
@@ -0,0 +1,233 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2023, KR Soft s.r.o.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the Kassow Robots nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#ifndef KR2_CBUN_GRIPPER_DAEMON
+#define KR2_CBUN_GRIPPER_DAEMON
+
+#include "weiss_gripkit/gripkit_logic.h"
+#include "weiss_gripkit/gripper_lease.h"
+#include "weiss_gripkit/monitor_tick.h"
+#include "weiss_gripkit/shared_memory.h"
+#include "weiss_gripkit/simulated_io.h"
+#include "weiss_gripkit/value_monitor.h"
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <sys/types.h>
+
+// same as SHM_GLOBAL_ID of the CBun, the daemon serves the segments the CBun would create
+#define DAEMON_SHM_PREFIX "kswx_weiss_gripkit.gkeasy"
+#define DAEMON_PERIOD_MS 10
+#define DAEMON_STROKE_MODEL_FILE "/var/tmp/" DAEMON_SHM_PREFIX ".daemon.stroke"
+#define DAEMON_SIMULATED_DUID_GRIPPED 1
+#define DAEMON_SIMULATED_DUID_NO_ERROR 2
+
+namespace kswx_weiss_gripkit {
+
+    /// @brief State of the gripper daemon published in its ".daemon" segment every tick.
+    struct DaemonState
+    {
+        /// @brief process id of the daemon, 0 if it stopped
+        pid_t pid_;
+
+        /// @brief CLOCK_MONOTONIC time of the daemon start in nanoseconds
+        uint64_t started_ns_;
+
+        /// @brief inputs of the last tick
+        GripkitSample sample_;
+
+        /// @brief decoded status of the last tick
+        GripkitCrEasyStatus status_;
+
+        /// @brief sequence number of the last status published to ".status"
+        uint64_t sequence_;
+
+        /// @brief CLOCK_MONOTONIC time of the last tick in nanoseconds, 0 if the daemon stopped
+        uint64_t heartbeat_ns_;
+
+        /// @brief last GRIP/RELEASE request applied to the grip output and the number of applied requests
+        GripkitAction last_action_;
+        uint64_t action_count_;
+
+        /// @brief monitor ticks and ticks sampled more than METRICS_OVERRUN_FACTOR periods after the previous one
+        uint64_t ticks_;
+        uint64_t overruns_;
+
+        /// @brief 1 if the monitor thread runs with SCHED_FIFO
+        int32_t realtime_;
+    };
+
+    /// @brief Gripper inputs and grip output of the daemon. The CBun reads them through the KR2 API, the daemon through a backend.
+    class GripperIO
+    {
+    public:
+        inline virtual ~GripperIO() {}
+
+        /// @brief Read the gripper input voltages into sample, NaN if an input was not found. Timestamps are left to the caller.
+        virtual void read(GripkitSample& sample) = 0;
+
+        /// @brief Set the grip output (IN1).
+        /// @return true on success
+        virtual bool setGrip(bool grip) = 0;
+
+        /// @brief Name of the backend for logs.
+        virtual const char* name() const = 0;
+    };
+
+    /// @brief GripperIO backed by SimulatedGripper, for running the daemon and its clients without a controller.
+    class SimulatedGripperIO : public GripperIO
+    {
+    public:
+        explicit SimulatedGripperIO(const SimulatedGripper::Config& config);
+
+        virtual void read(GripkitSample& sample);
+        virtual bool setGrip(bool grip);
+        inline virtual const char* name() const { return "simulated"; }
+
+    private:
+        SimulatedGripper gripper_;
+        SimulatedIOData io_data_;
+        uint64_t start_ns_;
+    };
+
+    /// @brief Configuration of GripperDaemon.
+    struct DaemonConfig
+    {
+        /// @brief prefix of the shared memory segments
+        std::string prefix = DAEMON_SHM_PREFIX;
+
+        /// @brief sampling period of the monitor thread
+        int period_ms = DAEMON_PERIOD_MS;
+
+        /// @brief SCHED_FIFO priority of the monitor thread, 0 keeps the default scheduling class
+        int fifo_priority = 0;
+
+        /// @brief CPU the monitor thread is pinned to, -1 for no pinning
+        int cpu = -1;
+
+        /// @brief learned stroke times are loaded from and saved to this file, empty to disable
+        std::string stroke_model_file = DAEMON_STROKE_MODEL_FILE;
+    };
+
+    /// @brief Status monitor of the gripper running outside the controller process. Owns the status, status event, action, request id,
+    /// stroke, signal and lease segments of the CBun and runs the same monitor tick on them: sample the inputs, publish the status
+    /// with heartbeat, wake status waiters on transitions, apply GRIP/RELEASE requests to the grip output, learn stroke times and
+    /// publish signal health. Sequences use the segments unchanged. Host tool
+    /// and test fixture until a GripperIO backend for the controller I/O exists.
+    class GripperDaemon
+    {
+    public:
+        /// @param io gripper I/O backend, must outlive the daemon
+        GripperDaemon(const DaemonConfig& config, GripperIO* io);
+
+        /// @brief Stop the daemon if running.
+        ~GripperDaemon();
+
+        GripperDaemon(const GripperDaemon&) = delete;
+        GripperDaemon& operator=(const GripperDaemon&) = delete;
+
+        /// @brief Create the segments, release the gripper and start the monitor thread.
+        /// @return true if the monitor thread started
+        bool start();
+
+        /// @brief Stop the monitor thread, mark the status stale, save the stroke model and remove the segments.
+        void stop();
+
+        /// @brief Copy of the state published in the ".daemon" segment.
+        DaemonState state();
+
+        /// @brief Tick of the monitor thread, runs the MonitorTick the CBun runs. Public for benchmarks only.
+        void onTick(GripkitCrEasyStatus status);
+
+        /// @brief Status of the inputs read through io_, applies the scheduling setup on the first call in the monitor thread.
+        /// Public for benchmarks only.
+        GripkitCrEasyStatus getStatus();
+
+        /// @brief Wake sequences sleeping in waitForStatus. Public for benchmarks only.
+        void onStatusChange(GripkitCrEasyStatus status);
+
+    private:
+        /// @brief Binds monitor_ to getStatus, onStatusChange and onTick without type erasure.
+        struct DaemonMonitorPolicy
+        {
+            inline GripkitCrEasyStatus getValue() { return daemon_->getStatus(); }
+            inline void onValueChanged(GripkitCrEasyStatus status) { daemon_->onStatusChange(status); }
+            inline void onTick(GripkitCrEasyStatus status) { daemon_->onTick(status); }
+
+            GripperDaemon* daemon_;
+        };
+
+        /// @brief Binds monitor_tick_ to the grip output of io_.
+        struct DaemonTickPolicy
+        {
+            inline GripkitAction pickAction(GripkitCrEasyStatus, GripkitAction requested) { return requested; }
+            inline void applyAction(GripkitAction action) { daemon_->applyAction(action); }
+
+            GripperDaemon* daemon_;
+        };
+
+        /// @brief Set the grip output for a GRIP or RELEASE request and count it.
+        void applyAction(GripkitAction action);
+
+        /// @brief Set SCHED_FIFO and CPU affinity of the calling thread as configured.
+        void setupThread();
+
+        DaemonConfig config_;
+        GripperIO* io_;
+
+        SharedMemoryObject<SynchronizedData<PublishedStatus>> shm_status_;
+        SharedMemoryObject<SharedEventCount> shm_status_event_;
+        SharedMemoryObject<SynchronizedData<GripkitAction>> shm_action_;
+        SharedMemoryObject<SynchronizedIncrement> shm_request_id_;
+        SharedMemoryObject<SynchronizedData<StrokeDeadlines>> shm_stroke_;
+        SharedMemoryObject<SynchronizedData<SignalHealth>> shm_signal_;
+        SharedMemoryObject<GripperLease> shm_lease_;
+        SharedMemoryObject<SynchronizedData<DaemonState>> shm_daemon_;
+
+        /// @brief state of the monitor thread, published to shm_daemon_ every tick
+        DaemonState state_;
+        MonitorTick monitor_tick_;
+
+        /// @brief the daemon has no observers, the tick derives its events for stroke learning only
+        StatusEventHub status_events_;
+        bool thread_setup_done_;
+        bool running_;
+
+        BasicValueMonitor<GripkitCrEasyStatus, DaemonMonitorPolicy, DeadlineSleepWait> monitor_;
+    };
+
+} // namespace kswx_weiss_gripkit
+
+#endif // KR2_CBUN_GRIPPER_DAEMON
@@ -0,0 +1,171 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2023, KR Soft s.r.o.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the Kassow Robots nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#ifndef KR2_CBUN_GRIPPER_LEASE
+#define KR2_CBUN_GRIPPER_LEASE
+
+#include "weiss_gripkit/metrics.h"
+
+#include <boost/interprocess/sync/interprocess_condition.hpp>
+#include <boost/interprocess/sync/interprocess_mutex.hpp>
+#include <cstdint>
+#include <sys/types.h>
+
+#define LEASE_MAX_WAITERS 16
+#define LEASE_DURATION_MS 10000
+#define LEASE_RENEW_MS 2500
+#define LEASE_CHECK_MS 50
+#define LEASE_MAX_TIMEOUT_MS 3600000
+#define LEASE_WAIT_BUCKETS 10
+
+namespace kswx_weiss_gripkit {
+
+    /// @brief Upper bounds of the lease wait buckets in seconds.
+    extern const double LEASE_WAIT_BOUNDS_S[LEASE_WAIT_BUCKETS];
+
+    /// @brief Result of GripperLease::acquire.
+    enum class LeaseResult : uint8_t
+    {
+        /// @brief lease granted or renewed
+        GRANTED = 0,
+        /// @brief held by another process and no wait requested
+        REJECTED = 1,
+        /// @brief not granted within the timeout
+        TIMEOUT = 2,
+        /// @brief LEASE_MAX_WAITERS processes already waiting
+        FULL = 3
+    };
+
+    const char* toString(LeaseResult result);
+
+    /// @brief Holder of the lease, owner_pid_ 0 if free.
+    struct LeaseHolder
+    {
+        pid_t owner_pid_;
+        int32_t priority_;
+        uint64_t remaining_ns_;
+        int32_t waiters_;
+    };
+
+    /// @brief Contention counters of the lease.
+    struct LeaseStats
+    {
+        /// @brief acquisitions granted, those granted without waiting, timed out and full acquisitions
+        uint64_t granted_;
+        uint64_t immediate_;
+        uint64_t timeouts_;
+        uint64_t full_;
+
+        /// @brief grip/release/macro requests of other processes rejected while the lease was held
+        uint64_t rejected_;
+
+        /// @brief operator requests (XML-RPC, control channel) admitted while another process held the lease
+        uint64_t overrides_;
+
+        /// @brief leases reclaimed because the owner did not renew in time or exited
+        uint64_t expired_;
+
+        /// @brief wait of granted acquisitions
+        uint64_t max_wait_ns_;
+        MetricsHistogram<LEASE_WAIT_BUCKETS> wait_;
+    };
+
+    /// @brief Optional exclusive use of the gripper by one process, placed in shared memory. A sequence that acquires the lease
+    /// is no longer interrupted by grip/release requests of other sequences, those are rejected at once instead of preempting
+    /// its stroke. Processes acquiring a held lease sleep on a process-shared condition in a queue ordered by priority (higher
+    /// first), then arrival. The lease expires LEASE_DURATION_MS after the last acquire or renew (the owner renews it from a
+    /// keeper thread and with every request) or when the owner exits. Operator requests may override the lease.
+    /// Without a lease held every process may act, as before.
+    class GripperLease
+    {
+    public:
+        GripperLease();
+
+        /// @brief Acquire or renew the lease, waiting up to timeout_ms while another process holds it.
+        /// @param pid calling process
+        /// @param priority queue priority, higher is served first
+        /// @param duration_ms lease duration without renewal
+        /// @param timeout_ms maximum wait, 0 to fail at once
+        LeaseResult acquire(pid_t pid, int priority, uint32_t duration_ms, uint32_t timeout_ms);
+
+        /// @brief Extend the lease held by pid.
+        /// @return false if pid does not hold the lease (anymore)
+        bool renew(pid_t pid, uint32_t duration_ms);
+
+        /// @brief Release the lease if held by pid.
+        /// @return true if it was held by pid
+        bool release(pid_t pid);
+
+        /// @brief Check whether pid may request an action, renew the lease if pid holds it. Counts a rejection otherwise.
+        /// @param operator_override admit even if another process holds the lease, counted as an override
+        /// @return true if the lease is free, held by pid or overridden
+        bool admit(pid_t pid, uint32_t duration_ms, bool operator_override = false);
+
+        LeaseHolder holder();
+
+        LeaseStats stats();
+
+    private:
+        /// @brief Free the lease if it expired or its owner exited, drop waiters that exited. Called with mutex_ locked.
+        void reclaimLocked(uint64_t now_ns);
+
+        /// @brief Free the lease and wake the waiters. Called with mutex_ locked.
+        void freeLocked();
+
+        /// @brief Return the index of the waiter to serve next, -1 if none. Called with mutex_ locked.
+        int nextWaiterLocked() const;
+
+        /// @brief Remove pid from the queue and wake the waiters, the next one may now take a free lease. Called with mutex_ locked.
+        void removeWaiterLocked(pid_t pid);
+
+        struct Waiter
+        {
+            pid_t pid_;
+            int32_t priority_;
+            uint64_t since_ns_;
+        };
+
+        boost::interprocess::interprocess_mutex mutex_;
+        boost::interprocess::interprocess_condition changed_;
+        pid_t owner_pid_;
+        int32_t owner_priority_;
+        uint64_t expires_ns_;
+        Waiter waiters_[LEASE_MAX_WAITERS];
+        int32_t waiter_count_;
+        LeaseStats stats_;
+    };
+
+} // namespace kswx_weiss_gripkit
+
+#endif // KR2_CBUN_GRIPPER_LEASE
@@ -0,0 +1,239 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2023, KR Soft s.r.o.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the Kassow Robots nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#ifndef KR2_CBUN_GRIPPER_MACRO
+#define KR2_CBUN_GRIPPER_MACRO
+
+#include "weiss_gripkit/gripkit_types.h"
+#include "weiss_gripkit/shared_memory.h"
+
+#include <cstdint>
+#include <string>
+
+#define MACRO_MAX_STEPS 16
+#define MACRO_SLOT_COUNT 8
+#define MACRO_MAX_JUMPS 64
+
+namespace kswx_weiss_gripkit {
+
+    /// @brief Operation of a macro step.
+    enum class MacroOp : uint8_t
+    {
+        /// @brief set the grip output, action_ is GRIP or RELEASE
+        ACTION,
+
+        /// @brief wait until the status is in status_mask_, fail after time_ms_ (0 waits forever)
+        WAIT_STATUS,
+
+        /// @brief wait for time_ms_
+        DWELL,
+
+        /// @brief if the status is in status_mask_, jump to step target_ at most count_ times, continue otherwise
+        RETRY_IF_STATUS
+    };
+
+    /// @brief One step of a gripper macro, 8 bytes.
+    struct MacroStep
+    {
+        MacroOp op_;
+        GripkitAction action_;
+
+        /// @brief bit (1 << GripkitCrEasyStatus) per accepted status
+        uint8_t status_mask_;
+
+        uint8_t target_;
+        uint16_t time_ms_;
+        uint16_t count_;
+    };
+
+    /// @brief Compact step list executed by MacroRunner.
+    struct MacroProgram
+    {
+        uint8_t step_count_;
+        MacroStep steps_[MACRO_MAX_STEPS];
+    };
+
+    /// @brief Status mask bit of a status.
+    inline uint8_t statusBit(GripkitCrEasyStatus status) { return static_cast<uint8_t>(1u << static_cast<unsigned int>(status)); }
+
+    /// @brief Parse a macro from its text form, whitespace separated steps:
+    /// "grip", "release", "wait:STATUS[|STATUS...][:TIMEOUT_MS]", "dwell:MS", "retry:STATUS[|STATUS...]:STEP:COUNT".
+    /// Status names as printed by toString, steps counted from 0. Example: re-grip up to 2 times if no part was detected,
+    /// "release wait:RELEASED:1000 grip wait:HOLDING|NO_PART:1000 retry:NO_PART:0:2"
+    /// @param error output, description of the first invalid step
+    /// @return false if the text is not a valid macro
+    bool parseMacro(const std::string& text, MacroProgram& program, std::string& error);
+
+    /// @brief Print a macro in the text form accepted by parseMacro.
+    std::string formatMacro(const MacroProgram& program);
+
+    /// @brief State of a macro run.
+    enum class MacroState : uint8_t
+    {
+        IDLE,
+        RUNNING,
+        DONE,
+
+        /// @brief error status persisted MIN_CONTINUOUS_ERROR_COUNT ticks in a wait step
+        FAILED,
+
+        /// @brief wait step timed out
+        TIMEOUT,
+
+        /// @brief another grip/release request or macro took over the gripper
+        INTERRUPTED
+    };
+
+    /// @brief Get printable name of the macro state.
+    const char* toString(MacroState state);
+
+    /// @brief Macro run requested by a sequence, picked up by the status monitoring thread.
+    struct MacroRequest
+    {
+        /// @brief request number of the run, 0 for no request
+        uint64_t run_;
+
+        /// @brief macro slot, 1 to MACRO_SLOT_COUNT
+        int32_t slot_;
+    };
+
+    /// @brief Outcome of the last finished macro run.
+    struct MacroResult
+    {
+        uint64_t run_;
+        MacroState state_;
+
+        /// @brief step that failed or timed out
+        uint8_t step_;
+
+        /// @brief monitor ticks from pick up to finish
+        uint32_t ticks_;
+    };
+
+    /// @brief Macros defined by slot and the run request/result, placed in shared memory.
+    class MacroShared
+    {
+    public:
+        inline MacroShared()
+        {
+            for (bool& defined : defined_)
+                defined = false;
+        }
+
+        static inline bool isSlot(int slot) { return slot >= 1 && slot <= MACRO_SLOT_COUNT; }
+
+        /// @brief Define the macro of a slot, replacing the previous definition.
+        /// @return false if slot is out of range
+        inline bool define(int slot, const MacroProgram& program)
+        {
+            if (!isSlot(slot))
+                return false;
+
+            boost::interprocess::scoped_lock<boost::interprocess::interprocess_mutex> lock(mutex_);
+            programs_[slot - 1] = program;
+            defined_[slot - 1] = true;
+            return true;
+        }
+
+        /// @brief Copy the macro of a slot.
+        /// @return false if the slot is not defined
+        inline bool get(int slot, MacroProgram& program)
+        {
+            if (!isSlot(slot))
+                return false;
+
+            boost::interprocess::scoped_lock<boost::interprocess::interprocess_mutex> lock(mutex_);
+            if (!defined_[slot - 1])
+                return false;
+            program = programs_[slot - 1];
+            return true;
+        }
+
+        SynchronizedData<MacroRequest> request_;
+        SynchronizedData<MacroResult> result_;
+
+    private:
+        boost::interprocess::interprocess_mutex mutex_;
+        MacroProgram programs_[MACRO_SLOT_COUNT];
+        bool defined_[MACRO_SLOT_COUNT];
+    };
+
+    /// @brief Executes a macro one monitor tick at a time. Only accessed from the status monitoring thread.
+    class MacroRunner
+    {
+    public:
+        MacroRunner();
+
+        /// @brief Start a program, a running one is interrupted.
+        /// @param run run number reported with the result
+        void start(const MacroProgram& program, uint64_t run, uint64_t now_ns);
+
+        /// @brief Stop the running program with state INTERRUPTED.
+        void interrupt();
+
+        /// @brief Advance the program with the status of this tick. Steps that complete within the tick are chained,
+        /// an ACTION step ends the tick. A wait step issued right after an action evaluates statuses from the next tick on,
+        /// the status of the action's tick was sampled before the output changed.
+        /// @param action output, action to apply in this tick or NONE
+        /// @return state after the tick
+        MacroState tick(GripkitCrEasyStatus status, uint64_t now_ns, GripkitAction& action);
+
+        inline bool isRunning() const { return state_ == MacroState::RUNNING; }
+        inline MacroState state() const { return state_; }
+        inline uint64_t run() const { return run_; }
+
+        /// @brief current step, the failed step after FAILED/TIMEOUT
+        inline int step() const { return step_; }
+
+        /// @brief monitor ticks since start
+        inline uint32_t ticks() const { return ticks_; }
+
+    private:
+        void enterStep(int step, uint64_t now_ns);
+
+        MacroProgram program_;
+        MacroState state_;
+        uint64_t run_;
+        int step_;
+        uint32_t ticks_;
+        uint64_t step_start_ns_;
+        bool action_tick_;
+        int error_ticks_;
+        int jumps_;
+        uint16_t retries_[MACRO_MAX_STEPS];
+    };
+
+} // namespace kswx_weiss_gripkit
+
+#endif // KR2_CBUN_GRIPPER_MACRO
@@ -0,0 +1,153 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2023, KR Soft s.r.o.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the Kassow Robots nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#ifndef KR2_CBUN_LOAD_VARIABLE
+#define KR2_CBUN_LOAD_VARIABLE
+
+#include <kr2_program_api/api_v1/bundles/custom_device.h>
+#include <atomic>
+
+#define NO_LOAD kr2_program_api::Load(0.0, kr2_program_api::Position(0.0, 0.0, 0.0), kr2_program_api::Imx(0.001, 0.001, 0.001, 0.0, 0.0, 0.0))
+
+namespace kswx_weiss_gripkit {
+
+    /// @brief Structure containing load data, can be used in shared memory.
+    struct LoadData
+    {
+        /// @brief Constructor for empty load (small values in inertial matrix).
+        inline LoadData() : LoadData(NO_LOAD) {}
+
+        /// @brief Construct LoadData from data in a specified Load.
+        explicit inline LoadData(kr2_program_api::Load load)
+        {
+            mass = load.mass().d();
+
+            x = load.cog().x().d();
+            y = load.cog().y().d();
+            z = load.cog().z().d();
+
+            xx = load.imx().xx().d();
+            yy = load.imx().yy().d();
+            zz = load.imx().zz().d();
+            xy = load.imx().xy().d();
+            xz = load.imx().xz().d();
+            yz = load.imx().yz().d();
+        }
+
+        /// @brief Create Load object based on saved LoadData.
+        kr2_program_api::Load toLoad() const
+        {
+            return kr2_program_api::Load(mass, kr2_program_api::Position(x, y, z), kr2_program_api::Imx(xx, yy, zz, xy, xz, yz));
+        }
+
+        /// @brief Exact comparison of all values.
+        inline bool operator==(const LoadData& other) const
+        {
+            return mass == other.mass && x == other.x && y == other.y && z == other.z
+                && xx == other.xx && yy == other.yy && zz == other.zz && xy == other.xy && xz == other.xz && yz == other.yz;
+        }
+
+        inline bool operator!=(const LoadData& other) const { return !(*this == other); }
+
+        double mass;
+        double x, y, z;
+        double xx, yy, zz, xy, xz, yz;
+    };
+
+    /// @brief Load with its program API value converted in advance, so that committing it is a plain assignment.
+    struct PreparedLoad
+    {
+        /// @brief Empty load.
+        inline PreparedLoad() : PreparedLoad(LoadData()) {}
+
+        explicit inline PreparedLoad(const LoadData& data) : data_(data), value_(data.toLoad()) {}
+
+        LoadData data_;
+        kr2_program_api::Load value_;
+    };
+
+    /// @brief Writes a system load variable only when its value changes. Each assignment to the variable is a controller side update
+    /// that may trigger dynamics model recomputation. A different load is always committed at once; requests repeating the committed
+    /// value within a few monitor ticks of the last controller update (status glitches) are dropped. Not thread-safe except for the
+    /// counters, use from a single thread.
+    class LoadVariableWriter
+    {
+    public:
+        /// @param coalesce_ticks number of ticks after a controller update in which requests for the same value count as coalesced
+        explicit LoadVariableWriter(int coalesce_ticks);
+
+        /// @brief Set the system load variable to write to. Forgets the committed value.
+        void setVariable(boost::shared_ptr<kr2_program_api::Load> variable);
+
+        /// @brief Write the load now, unless the variable already holds it.
+        void write(const LoadData& load);
+
+        /// @brief Request write of the load. A load different from the committed one is committed immediately, the same load is
+        /// dropped (coalesced within coalesce_ticks of the last controller update, skipped otherwise).
+        void request(const LoadData& load);
+
+        /// @brief Request write of a load converted in advance, same as request(const LoadData&) without the conversion.
+        void request(const PreparedLoad& load);
+
+        /// @brief Advance the coalescing window by one tick.
+        void tick();
+
+        /// @brief Number of controller updates made.
+        inline uint64_t writes() const { return writes_; }
+
+        /// @brief Number of controller updates avoided because the variable already held the value.
+        inline uint64_t skipped() const { return skipped_; }
+
+        /// @brief Number of requests for the committed value dropped within the coalescing window.
+        inline uint64_t coalesced() const { return coalesced_; }
+
+    private:
+        /// @brief Assign the load to the variable, skip if it is the committed value and the variable was not changed by anyone else.
+        void commit(const PreparedLoad& load);
+
+        boost::shared_ptr<kr2_program_api::Load> variable_;
+        int coalesce_ticks_;
+        int ticks_since_commit_;
+
+        bool committed_valid_;
+        LoadData committed_;
+
+        std::atomic<uint64_t> writes_;
+        std::atomic<uint64_t> skipped_;
+        std::atomic<uint64_t> coalesced_;
+    };
+
+} // namespace kswx_weiss_gripkit
+
+#endif // KR2_CBUN_LOAD_VARIABLE
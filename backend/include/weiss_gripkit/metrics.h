@@ -0,0 +1,179 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2023, KR Soft s.r.o.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the Kassow Robots nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#ifndef KR2_CBUN_METRICS
+#define KR2_CBUN_METRICS
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <thread>
+
+#define METRICS_TICK_BUCKETS 10
+#define METRICS_ACTION_BUCKETS 10
+#define METRICS_PUBLISH_TICKS 10
+#define METRICS_EXPORT_INTERVAL_MS 1000
+#define METRICS_OVERRUN_FACTOR 1.5
+
+namespace kswx_weiss_gripkit {
+
+    /// @brief Upper bounds of the monitor tick duration buckets in seconds.
+    extern const double METRICS_TICK_BOUNDS_S[METRICS_TICK_BUCKETS];
+
+    /// @brief Upper bounds of the action latency buckets in seconds.
+    extern const double METRICS_ACTION_BOUNDS_S[METRICS_ACTION_BUCKETS];
+
+    /// @brief Histogram with fixed bucket bounds, buckets are not cumulative, the last one counts values above all bounds.
+    template <int bucket_count>
+    struct MetricsHistogram
+    {
+        inline void add(double value, const double* bounds)
+        {
+            int i = 0;
+            while (i < bucket_count && value > bounds[i])
+                ++i;
+            ++buckets_[i];
+            ++count_;
+            sum_ += value;
+        }
+
+        uint64_t buckets_[bucket_count + 1];
+        uint64_t count_;
+        double sum_;
+    };
+
+    /// @brief Device counters and latencies, plain data updated by the status monitoring thread and copied to MetricsBuffer.
+    struct MetricsSnapshot
+    {
+        /// @brief CLOCK_REALTIME time of the snapshot in nanoseconds
+        uint64_t timestamp_ns_;
+
+        // gauges
+        uint8_t activated_;
+        uint8_t status_;
+
+        // counters
+        uint64_t ticks_;
+        uint64_t grip_actions_;
+        uint64_t release_actions_;
+        uint64_t holding_;
+        uint64_t no_part_;
+        uint64_t error_ticks_;
+        uint64_t faults_;
+        uint64_t actions_done_;
+        uint64_t actions_failed_;
+        uint64_t actions_interrupted_;
+        uint64_t monitor_overruns_;
+        uint64_t stroke_deadline_misses_;
+        uint64_t payload_writes_;
+        uint64_t payload_skipped_;
+        uint64_t payload_coalesced_;
+        uint64_t event_drops_;
+
+        MetricsHistogram<METRICS_TICK_BUCKETS> tick_duration_;
+        MetricsHistogram<METRICS_ACTION_BUCKETS> grip_latency_;
+        MetricsHistogram<METRICS_ACTION_BUCKETS> release_latency_;
+    };
+
+    /// @brief Serialize a snapshot in the OpenMetrics text format, metric names prefixed with weiss_gripkit_.
+    std::string formatOpenMetrics(const MetricsSnapshot& snapshot);
+
+    /// @brief Double buffer of snapshots. The writer fills the buffer not published and flips, a reader copies the published one.
+    /// Neither side blocks: a publish that would overwrite a buffer still being read is skipped, the reader retries if the buffer
+    /// was flipped before it registered.
+    class MetricsBuffer
+    {
+    public:
+        MetricsBuffer();
+
+        /// @brief Publish a snapshot. Single writer thread, never blocks.
+        /// @return false if skipped because the reader was still copying the other buffer
+        bool publish(const MetricsSnapshot& snapshot);
+
+        /// @brief Copy the last published snapshot. Single reader thread.
+        /// @return false if nothing was published yet
+        bool read(MetricsSnapshot& snapshot);
+
+        /// @brief number of publishes skipped because of a slow reader
+        inline uint64_t skipped() const { return skipped_.load(std::memory_order_relaxed); }
+
+    private:
+        MetricsSnapshot buffers_[2];
+        std::atomic<int> front_;
+        std::atomic<int> readers_[2];
+        std::atomic<bool> published_;
+        std::atomic<uint64_t> skipped_;
+    };
+
+    /// @brief Thread serializing the snapshots of a MetricsBuffer every METRICS_EXPORT_INTERVAL_MS into a textfile (written to a
+    /// temporary file and renamed, for textfile collectors) and serving them on a Unix stream socket (one scrape per connection).
+    class MetricsExporter
+    {
+    public:
+        MetricsExporter();
+
+        virtual ~MetricsExporter();
+
+        MetricsExporter(const MetricsExporter&) = delete;
+        MetricsExporter& operator=(const MetricsExporter&) = delete;
+
+        /// @brief Start the exporter thread.
+        /// @param buffer snapshots to export, must outlive the exporter thread
+        /// @param textfile_path path of the textfile, empty to disable
+        /// @param socket_path path of the socket file, empty to disable; a stale socket file is replaced
+        /// @return true on success, false otherwise
+        bool start(MetricsBuffer* buffer, const std::string& textfile_path, const std::string& socket_path);
+
+        /// @brief Stop the exporter thread and remove the socket file. The textfile is kept.
+        void stop();
+
+        inline bool isRunning() const { return running_; }
+
+    private:
+        void run();
+        void writeTextfile(const std::string& text);
+
+        MetricsBuffer* buffer_;
+        std::string textfile_path_;
+        std::string socket_path_;
+        int listen_fd_;
+        int wake_fd_;
+        std::thread thread_;
+        std::atomic<bool> running_;
+        std::atomic<bool> stopping_;
+    };
+
+} // namespace kswx_weiss_gripkit
+
+#endif // KR2_CBUN_METRICS
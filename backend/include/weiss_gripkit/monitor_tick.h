@@ -0,0 +1,136 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2023, KR Soft s.r.o.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the Kassow Robots nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+
+#ifndef KR2_CBUN_MONITOR_TICK
+#define KR2_CBUN_MONITOR_TICK
+
+#include "weiss_gripkit/gripkit_logic.h"
+#include "weiss_gripkit/profiler.h"
+#include "weiss_gripkit/shared_memory.h"
+#include "weiss_gripkit/signal_health.h"
+#include "weiss_gripkit/status_events.h"
+#include "weiss_gripkit/stroke_model.h"
+
+#include <cstdint>
+
+namespace kswx_weiss_gripkit {
+
+    /// @brief Shared memory segments written by MonitorTick, a NULL segment skips its step.
+    struct MonitorSegments
+    {
+        SynchronizedData<PublishedStatus>* status_;
+        SynchronizedData<GripkitAction>* action_;
+        SynchronizedData<StrokeDeadlines>* stroke_;
+        SynchronizedData<SignalHealth>* signal_;
+
+        /// @brief stage timings of the shared memory accesses, NULL to skip
+        ProfileData* profile_;
+    };
+
+    /// @brief Status monitor tick shared by the CBun master instance and the gripper daemon, with the state it keeps between ticks.
+    /// Only accessed from the status monitoring thread, except strokeModel(), which is thread-safe.
+    class MonitorTick
+    {
+    public:
+        MonitorTick() : sequence_(0) {}
+
+        /// @brief Forget the previous status, any action in progress and the signal statistics, call before the monitor starts.
+        /// The status sequence continues and learned stroke times are kept.
+        void reset();
+
+        /// @brief Publish a status with a new sequence number and the current heartbeat.
+        /// @param status segment to publish to, NULL only advances the sequence
+        /// @return sequence number of the status
+        uint64_t publish(SynchronizedData<PublishedStatus>* status, GripkitCrEasyStatus value, uint64_t sample_time_ns);
+
+        /// @brief One tick: publish the status, pick up the requested action, apply it to the grip output, derive events, learn
+        /// stroke times from completed actions and publish signal health every SIGNAL_HEALTH_PUBLISH_TICKS ticks.
+        /// @tparam policy_t provides GripkitAction pickAction(GripkitCrEasyStatus, GripkitAction requested), which may replace the
+        /// requested action (macro step), and void applyAction(GripkitAction) setting the grip output for GRIP or RELEASE
+        /// @param action set to the applied action, NONE if there was none
+        /// @return StatusEventType bits of this tick
+        template <typename policy_t>
+        unsigned int run(GripkitCrEasyStatus status, const GripkitSample& sample, const MonitorSegments& segments, StatusEventHub& hub,
+            policy_t& policy, GripkitAction& action)
+        {
+            {
+                PROFILE_SCOPE(segments.profile_, ProfileStage::SHM_STATUS)
+                publish(segments.status_, status, sample.monotonic_ns_);
+            }
+
+            // read from shared memory and perform requested action: grip/release
+            action = GripkitAction::NONE;
+            if (segments.action_)
+            {
+                PROFILE_SCOPE(segments.profile_, ProfileStage::SHM_ACTION)
+                action = segments.action_->exchange(GripkitAction::NONE);
+            }
+            action = policy.pickAction(status, action);
+            if (action == GripkitAction::GRIP || action == GripkitAction::RELEASE)
+                policy.applyAction(action);
+
+            unsigned int events = learn(status, action, sample, segments, hub);
+
+            // update signal health, publish it only every few ticks
+            signal_health_.add(sample);
+            if (segments.signal_ && sequence_ % SIGNAL_HEALTH_PUBLISH_TICKS == 0)
+                segments.signal_->set(signal_health_);
+
+            return events;
+        }
+
+        /// @brief sequence number of the last published status
+        inline uint64_t sequence() const { return sequence_; }
+
+        /// @brief last action completion, valid after a tick reported StatusEventType::ACTION_COMPLETED
+        inline const ActionCompletion& lastCompletion() const { return event_source_.lastCompletion(); }
+
+        inline StrokeModel& strokeModel() { return stroke_model_; }
+        inline const StrokeModel& strokeModel() const { return stroke_model_; }
+
+    private:
+        /// @brief Derive events, learn the stroke time of a completed action and share the updated deadlines.
+        unsigned int learn(GripkitCrEasyStatus status, GripkitAction action, const GripkitSample& sample, const MonitorSegments& segments,
+            StatusEventHub& hub);
+
+        uint64_t sequence_;
+        StatusEventSource event_source_;
+        StrokeModel stroke_model_;
+        SignalHealth signal_health_;
+    };
+
+} // namespace kswx_weiss_gripkit
+
+#endif // KR2_CBUN_MONITOR_TICK
@@ -0,0 +1,168 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2023, KR Soft s.r.o.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the Kassow Robots nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#ifndef KR2_CBUN_PAYLOAD_REGISTRY
+#define KR2_CBUN_PAYLOAD_REGISTRY
+
+#include "weiss_gripkit/load_variable.h"
+
+#include <boost/interprocess/sync/interprocess_mutex.hpp>
+#include <boost/interprocess/sync/scoped_lock.hpp>
+#include <atomic>
+#include <cstdint>
+
+#define PAYLOAD_SLOT_COUNT 16
+#define PAYLOAD_SLOT_NONE 0
+#define PAYLOAD_SLOT_INLINE -1
+
+namespace kswx_weiss_gripkit {
+
+    /// @brief Payload definitions registered once and referenced by slot id on grip, placed in shared memory.
+    /// Slots are numbered 1 to PAYLOAD_SLOT_COUNT, PAYLOAD_SLOT_NONE grips without payload. Registration is rare and takes the mutex,
+    /// grip only stores the selected slot id and the monitor thread reads the definitions only after a registration.
+    class PayloadTable
+    {
+    public:
+        inline PayloadTable() : selected_(PAYLOAD_SLOT_INLINE), generation_(0)
+        {
+            for (bool& registered : registered_)
+                registered = false;
+        }
+
+        /// @brief Return true if slot is a valid slot id, PAYLOAD_SLOT_NONE excluded.
+        static inline bool isSlot(int slot) { return slot >= 1 && slot <= PAYLOAD_SLOT_COUNT; }
+
+        /// @brief Define the payload of a slot, replacing the previous definition.
+        /// @return false if slot is out of range
+        inline bool define(int slot, const LoadData& load)
+        {
+            if (!isSlot(slot))
+                return false;
+
+            boost::interprocess::scoped_lock<boost::interprocess::interprocess_mutex> lock(mutex_);
+            loads_[slot - 1] = load;
+            registered_[slot - 1] = true;
+            generation_.fetch_add(1, std::memory_order_release);
+            return true;
+        }
+
+        /// @brief Return true if the slot has a payload defined, PAYLOAD_SLOT_NONE is always defined.
+        inline bool isDefined(int slot)
+        {
+            if (slot == PAYLOAD_SLOT_NONE)
+                return true;
+            if (!isSlot(slot))
+                return false;
+
+            boost::interprocess::scoped_lock<boost::interprocess::interprocess_mutex> lock(mutex_);
+            return registered_[slot - 1];
+        }
+
+        /// @brief Copy all definitions.
+        /// @param loads output, PAYLOAD_SLOT_COUNT entries
+        /// @param registered output, PAYLOAD_SLOT_COUNT entries
+        /// @return generation of the copied definitions
+        inline uint64_t copy(LoadData* loads, bool* registered)
+        {
+            boost::interprocess::scoped_lock<boost::interprocess::interprocess_mutex> lock(mutex_);
+            for (int i = 0; i < PAYLOAD_SLOT_COUNT; ++i)
+            {
+                loads[i] = loads_[i];
+                registered[i] = registered_[i];
+            }
+            return generation_.load(std::memory_order_relaxed);
+        }
+
+        /// @brief Select the payload applied when the gripper starts holding a part: a slot, PAYLOAD_SLOT_NONE, or PAYLOAD_SLOT_INLINE
+        /// for the load passed to grip in shm_load_.
+        inline void select(int slot) { selected_.store(slot, std::memory_order_release); }
+
+        inline int selected() const { return selected_.load(std::memory_order_acquire); }
+
+        /// @brief incremented by every define, lets readers skip unchanged definitions without the mutex
+        inline uint64_t generation() const { return generation_.load(std::memory_order_acquire); }
+
+    private:
+        std::atomic<int32_t> selected_;
+        std::atomic<uint64_t> generation_;
+
+        boost::interprocess::interprocess_mutex mutex_;
+        LoadData loads_[PAYLOAD_SLOT_COUNT];
+        bool registered_[PAYLOAD_SLOT_COUNT];
+    };
+
+    /// @brief Local copy of the PayloadTable definitions with their program API values converted in advance.
+    /// Only accessed from the status monitoring thread.
+    class PayloadCache
+    {
+    public:
+        inline PayloadCache() : generation_(0) {}
+
+        /// @brief Reload the definitions if the table changed since the last call.
+        inline void refresh(PayloadTable& table)
+        {
+            if (table.generation() == generation_)
+                return;
+
+            LoadData loads[PAYLOAD_SLOT_COUNT];
+            bool registered[PAYLOAD_SLOT_COUNT];
+            generation_ = table.copy(loads, registered);
+            for (int i = 0; i < PAYLOAD_SLOT_COUNT; ++i)
+            {
+                // convert only changed definitions, a registration usually touches one slot
+                if (registered[i] && (!registered_[i] || loads_[i].data_ != loads[i]))
+                    loads_[i] = PreparedLoad(loads[i]);
+                registered_[i] = registered[i];
+            }
+        }
+
+        /// @brief Get the prepared payload of a slot, the empty load for PAYLOAD_SLOT_NONE or an undefined slot.
+        inline const PreparedLoad& get(int slot) const
+        {
+            return (PayloadTable::isSlot(slot) && registered_[slot - 1]) ? loads_[slot - 1] : no_load_;
+        }
+
+        /// @brief Get the prepared empty load.
+        inline const PreparedLoad& noLoad() const { return no_load_; }
+
+    private:
+        uint64_t generation_;
+        PreparedLoad loads_[PAYLOAD_SLOT_COUNT];
+        bool registered_[PAYLOAD_SLOT_COUNT] = {};
+        PreparedLoad no_load_;
+    };
+
+} // namespace kswx_weiss_gripkit
+
+#endif // KR2_CBUN_PAYLOAD_REGISTRY
@@ -38,21 +38,76 @@
 #include <functional>
 #include <atomic>
 #include <thread>
+#include <cerrno>
+#include <cstdint>
+#include <time.h>
+#include <unistd.h>
 
 namespace kswx_weiss_gripkit {
+
+    /// @brief Default wait of BasicPeriodicThread, fixed sleep after each cycle.
+    struct FixedSleepWait
+    {
+        inline void operator()() { usleep(1000 * sleep_ms_); }
+
+        int sleep_ms_;
+    };
+
+    /// @brief Wait of BasicPeriodicThread sleeping until absolute CLOCK_MONOTONIC deadlines, so the cycle duration does not add to the
+    /// period. A cycle that overran its deadline starts the next one right away and moves the schedule, missed cycles are not caught up.
+    struct DeadlineSleepWait
+    {
+        inline explicit DeadlineSleepWait(int period_ms) : period_ns_(static_cast<uint64_t>(period_ms) * 1000000ULL), next_ns_(0) {}
+
+        inline void operator()()
+        {
+            struct timespec ts;
+            clock_gettime(CLOCK_MONOTONIC, &ts);
+            uint64_t now_ns = static_cast<uint64_t>(ts.tv_sec) * 1000000000ULL + static_cast<uint64_t>(ts.tv_nsec);
+
+            next_ns_ += period_ns_;
+            if (next_ns_ <= now_ns)
+            {
+                next_ns_ = now_ns;
+                return;
+            }
+
+            ts.tv_sec = static_cast<time_t>(next_ns_ / 1000000000ULL);
+            ts.tv_nsec = static_cast<long>(next_ns_ % 1000000000ULL);
+            while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR) {}
+        }
+
+        uint64_t period_ns_;
+        uint64_t next_ns_;
+    };
     
     /// @brief Class for representing a thread that runs periodically with specified initialization and cycle code.
-    class PeriodicThread
+    /// Init and cycle callables are stored by value and called directly, so they can be inlined into the thread loop.
+    /// @tparam init_t callable type of the initialization code, void()
+    /// @tparam cycle_t callable type of the cycle code, void()
+    /// @tparam wait_t callable type waiting between cycles, void(); must return within a cycle period for stop() to work
+    template <typename init_t, typename cycle_t, typename wait_t = FixedSleepWait>
+    class BasicPeriodicThread
     {
     public:
         /// @brief Construct object to represent a thread that runs periodically with specified initialization and cycle code.
         /// ==== { init_method(); while (true) { cycle_method(); sleep(sleep_ms); } } ====
         /// @param init_method method to call once during initialization inside the thread
         /// @param cycle_method method to call every cycle inside the thread
-        /// @param sleep_ms sleep per cycle in milliseconds
-        PeriodicThread(std::function<void()> init_method, std::function<void()> cycle_method, int sleep_ms);
+        /// @param sleep_ms sleep per cycle in milliseconds, only for wait_t FixedSleepWait
+        BasicPeriodicThread(init_t init_method, cycle_t cycle_method, int sleep_ms);
 
-        inline virtual ~PeriodicThread() {}
+        /// @brief Construct object to represent a thread that runs periodically with specified initialization, cycle and wait code.
+        /// ==== { init_method(); while (true) { cycle_method(); wait_method(); } } ====
+        /// @param init_method method to call once during initialization inside the thread
+        /// @param cycle_method method to call every cycle inside the thread
+        /// @param wait_method method to call after every cycle inside the thread
+        BasicPeriodicThread(init_t init_method, cycle_t cycle_method, wait_t wait_method);
+
+        inline virtual ~BasicPeriodicThread() {}
+
+        BasicPeriodicThread(const BasicPeriodicThread&) = delete;
+        BasicPeriodicThread& operator=(const BasicPeriodicThread&) = delete;
 
         /// @brief Start the periodic thread. Caller needs to maintain proper call sequence (start, stop, start, stop), not (start, start) for example.
         /// @param timeout_ms timeout in milliseconds to start the thread
@@ -65,15 +120,82 @@ namespace kswx_weiss_gripkit {
         bool stop(int timeout_ms);
 
     private:
-        std::function<void()> init_method_;
-        std::function<void()> cycle_method_;
-        int sleep_ms_;
+        init_t init_method_;
+        cycle_t cycle_method_;
+        wait_t wait_method_;
 
         std::thread periodic_thread_;
         std::atomic<bool> stop_request_;
         std::atomic<bool> initialized_;
     };
 
+    /// @brief Class for representing a thread that runs periodically with specified initialization and cycle code, type-erased version.
+    class PeriodicThread : public BasicPeriodicThread<std::function<void()>, std::function<void()>>
+    {
+    public:
+        /// @brief Construct object to represent a thread that runs periodically with specified initialization and cycle code.
+        /// ==== { init_method(); while (true) { cycle_method(); sleep(sleep_ms); } } ====
+        /// @param init_method method to call once during initialization inside the thread
+        /// @param cycle_method method to call every cycle inside the thread
+        /// @param sleep_ms sleep per cycle in milliseconds
+        PeriodicThread(std::function<void()> init_method, std::function<void()> cycle_method, int sleep_ms);
+
+        inline virtual ~PeriodicThread() {}
+    };
+
+    template <typename init_t, typename cycle_t, typename wait_t>
+    BasicPeriodicThread<init_t, cycle_t, wait_t>::BasicPeriodicThread(init_t init_method, cycle_t cycle_method, int sleep_ms) : 
+    init_method_(init_method), cycle_method_(cycle_method), wait_method_(FixedSleepWait{ sleep_ms }), stop_request_(true), initialized_(false) {}
+
+    template <typename init_t, typename cycle_t, typename wait_t>
+    BasicPeriodicThread<init_t, cycle_t, wait_t>::BasicPeriodicThread(init_t init_method, cycle_t cycle_method, wait_t wait_method) : 
+    init_method_(init_method), cycle_method_(cycle_method), wait_method_(wait_method), stop_request_(true), initialized_(false) {}
+
+    template <typename init_t, typename cycle_t, typename wait_t>
+    bool BasicPeriodicThread<init_t, cycle_t, wait_t>::start(int timeout_ms)
+    {
+        initialized_ = false;
+        stop_request_ = false;
+
+        periodic_thread_ = std::thread([this]() {
+            init_method_();
+            initialized_ = true;
+            while (!stop_request_)
+            {
+                cycle_method_();
+                wait_method_();
+            }
+            initialized_ = false;
+        });
+
+        for (int i = 0; i < timeout_ms && !initialized_; ++i)
+            usleep(1000);
+
+        return initialized_;
+    }
+
+    template <typename init_t, typename cycle_t, typename wait_t>
+    bool BasicPeriodicThread<init_t, cycle_t, wait_t>::stop(int timeout_ms)
+    {
+        stop_request_ = true;
+        for (int i = 0; i < timeout_ms && initialized_; ++i)
+            usleep(1000);
+        
+        if (initialized_)
+        {
+            return false;
+        }
+        else
+        {
+            if (periodic_thread_.joinable())
+                periodic_thread_.join();
+
+            return true;
+        }
+    }
+
+    extern template class BasicPeriodicThread<std::function<void()>, std::function<void()>>;
+
 } // namespace kswx_weiss_gripkit
 
-#endif // KR2_CBUN_PERIODIC_THREAD
\ No newline at end of file
+#endif // KR2_CBUN_PERIODIC_THREAD
@@ -0,0 +1,211 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2023, KR Soft s.r.o.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the Kassow Robots nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#ifndef KR2_CBUN_PROFILER
+#define KR2_CBUN_PROFILER
+
+#include <atomic>
+#include <cstdint>
+#include <time.h>
+
+#define PROFILE_HISTOGRAM_BINS 32
+
+namespace kswx_weiss_gripkit {
+
+    /// @brief Profiled hot-path stages.
+    enum class ProfileStage : uint8_t
+    {
+        /// @brief api_->rc_api_->spin() in getStatus
+        SPIN,
+
+        /// @brief read_GPIOFloat scan in getStatus
+        READ_INPUTS,
+
+        /// @brief cmd_TX_GPIO in setDigitalOutput
+        SET_OUTPUT,
+
+        /// @brief publishing the status to shared memory in onTick
+        SHM_STATUS,
+
+        /// @brief taking the requested action from shared memory in onTick
+        SHM_ACTION,
+
+        /// @brief reading the request id from shared memory in onTick
+        SHM_REQUEST_ID,
+
+        /// @brief whole onTick
+        TICK,
+
+        COUNT
+    };
+
+    /// @brief Get stage name.
+    inline const char* toString(ProfileStage stage)
+    {
+        switch (stage)
+        {
+            case ProfileStage::SPIN: return "spin";
+            case ProfileStage::READ_INPUTS: return "read_inputs";
+            case ProfileStage::SET_OUTPUT: return "set_output";
+            case ProfileStage::SHM_STATUS: return "shm_status";
+            case ProfileStage::SHM_ACTION: return "shm_action";
+            case ProfileStage::SHM_REQUEST_ID: return "shm_request_id";
+            case ProfileStage::TICK: return "tick";
+            default: return "unknown";
+        }
+    }
+
+    /// @brief Lock-free duration histogram with log2 bins, bin i counts durations in [2^i, 2^(i+1)) ns.
+    /// Lives in shared memory, any number of writers and readers.
+    struct StageHistogram
+    {
+        inline void add(uint64_t duration_ns)
+        {
+            int bin = 0;
+            if (duration_ns > 0)
+                bin = 63 - __builtin_clzll(duration_ns);
+            if (bin >= PROFILE_HISTOGRAM_BINS)
+                bin = PROFILE_HISTOGRAM_BINS - 1;
+
+            count_.fetch_add(1, std::memory_order_relaxed);
+            total_ns_.fetch_add(duration_ns, std::memory_order_relaxed);
+            bins_[bin].fetch_add(1, std::memory_order_relaxed);
+
+            uint64_t max_ns = max_ns_.load(std::memory_order_relaxed);
+            while (duration_ns > max_ns && !max_ns_.compare_exchange_weak(max_ns, duration_ns, std::memory_order_relaxed)) {}
+        }
+
+        inline uint64_t count() const { return count_.load(std::memory_order_relaxed); }
+
+        inline uint64_t maxNs() const { return max_ns_.load(std::memory_order_relaxed); }
+
+        inline double meanNs() const
+        {
+            uint64_t count = count_.load(std::memory_order_relaxed);
+            return count ? static_cast<double>(total_ns_.load(std::memory_order_relaxed)) / count : 0.0;
+        }
+
+        /// @brief Get percentile as the upper edge of the bin containing it, at most twice the real value.
+        /// @param p percentile in range 0-100
+        inline uint64_t percentileNs(double p) const
+        {
+            uint64_t total = 0;
+            for (int i = 0; i < PROFILE_HISTOGRAM_BINS; ++i)
+                total += bins_[i].load(std::memory_order_relaxed);
+            if (total == 0)
+                return 0;
+
+            uint64_t rank = static_cast<uint64_t>(p / 100.0 * total + 0.5);
+            uint64_t seen = 0;
+            for (int i = 0; i < PROFILE_HISTOGRAM_BINS; ++i)
+            {
+                seen += bins_[i].load(std::memory_order_relaxed);
+                if (seen >= rank && seen > 0)
+                    return 2ULL << i;
+            }
+            return maxNs();
+        }
+
+        std::atomic<uint64_t> count_;
+        std::atomic<uint64_t> total_ns_;
+        std::atomic<uint64_t> max_ns_;
+        std::atomic<uint64_t> bins_[PROFILE_HISTOGRAM_BINS];
+    };
+
+    static_assert(sizeof(std::atomic<uint64_t>) == sizeof(uint64_t), "StageHistogram requires lock-free 64 bit atomics in shared memory");
+
+    /// @brief Histograms of all stages, shared from the master instance.
+    struct ProfileData
+    {
+        /// @brief Zero all histograms.
+        inline ProfileData()
+        {
+            for (StageHistogram& stage : stages_)
+            {
+                stage.count_ = 0;
+                stage.total_ns_ = 0;
+                stage.max_ns_ = 0;
+                for (std::atomic<uint64_t>& bin : stage.bins_)
+                    bin = 0;
+            }
+        }
+
+        inline StageHistogram& stage(ProfileStage stage) { return stages_[static_cast<int>(stage)]; }
+
+        inline const StageHistogram& stage(ProfileStage stage) const { return stages_[static_cast<int>(stage)]; }
+
+        StageHistogram stages_[static_cast<int>(ProfileStage::COUNT)];
+    };
+
+    /// @brief CLOCK_MONOTONIC_RAW in nanoseconds, not slewed by NTP (vDSO, no syscall).
+    inline uint64_t profileNowNs()
+    {
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC_RAW, &ts);
+        return static_cast<uint64_t>(ts.tv_sec) * 1000000000ULL + static_cast<uint64_t>(ts.tv_nsec);
+    }
+
+    /// @brief Add the duration of the enclosing scope to a stage histogram. Does nothing if profile is NULL.
+    class ScopedStageTimer
+    {
+    public:
+        inline ScopedStageTimer(ProfileData* profile, ProfileStage stage)
+        : histogram_(profile ? &profile->stage(stage) : nullptr), start_ns_(histogram_ ? profileNowNs() : 0) {}
+
+        inline ~ScopedStageTimer()
+        {
+            if (histogram_)
+                histogram_->add(profileNowNs() - start_ns_);
+        }
+
+        ScopedStageTimer(const ScopedStageTimer&) = delete;
+        ScopedStageTimer& operator=(const ScopedStageTimer&) = delete;
+
+    private:
+        StageHistogram* histogram_;
+        uint64_t start_ns_;
+    };
+
+} // namespace kswx_weiss_gripkit
+
+// Profiling is compiled in only with WEISS_GRIPKIT_PROFILE defined, otherwise PROFILE_SCOPE expands to nothing.
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+#ifdef WEISS_GRIPKIT_PROFILE
+#define PROFILE_SCOPE(profile, stage) ::kswx_weiss_gripkit::ScopedStageTimer PROFILE_CONCAT(profile_timer_, __LINE__)((profile), (stage));
+#else
+#define PROFILE_SCOPE(profile, stage)
+#endif
+
+#endif // KR2_CBUN_PROFILER
@@ -0,0 +1,128 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2023, KR Soft s.r.o.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the Kassow Robots nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#ifndef KR2_CBUN_RPC_SERVICE
+#define KR2_CBUN_RPC_SERVICE
+
+#include "weiss_gripkit/metrics.h"
+
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#define RPC_LONG_RUNNING_CALLS 2
+#define RPC_LATENCY_BUCKETS 10
+
+namespace kswx_weiss_gripkit {
+
+    /// @brief Upper bounds of the RPC latency buckets in seconds.
+    extern const double RPC_LATENCY_BOUNDS_S[RPC_LATENCY_BUCKETS];
+
+    /// @brief Outcome of a call through RpcService.
+    enum class RpcOutcome : uint8_t
+    {
+        /// @brief handler returned
+        OK = 0,
+        /// @brief handler threw
+        FAILED = 1,
+        /// @brief rejected, RPC_LONG_RUNNING_CALLS long-running handlers already running
+        BUSY = 2
+    };
+
+    const char* toString(RpcOutcome outcome);
+
+    /// @brief Call counters and latency of one method.
+    struct RpcMethodStats
+    {
+        /// @brief Get the upper bound of the bucket holding percentile p, in seconds. Values above all bounds report max_s_.
+        double percentileS(double p) const;
+
+        std::string name_;
+        uint64_t calls_;
+        uint64_t failures_;
+        uint64_t busy_;
+        double max_s_;
+        MetricsHistogram<RPC_LATENCY_BUCKETS> latency_;
+    };
+
+    /// @brief Runs RPC handlers in place on the thread the SDK XML-RPC server calls them on and keeps per-method
+    /// statistics. Long-running handlers (blocking grip/release) are admitted RPC_LONG_RUNNING_CALLS at a time, further
+    /// ones are rejected instead of holding more transport threads. Handlers are never abandoned, a call returns when its handler did.
+    class RpcService
+    {
+    public:
+        RpcService();
+
+        virtual ~RpcService() = default;
+
+        RpcService(const RpcService&) = delete;
+        RpcService& operator=(const RpcService&) = delete;
+
+        /// @brief Register a method for statistics. Thread-safe.
+        /// @return method id passed to call()
+        int addMethod(const std::string& name);
+
+        /// @brief Run a handler on the calling thread.
+        /// @param method method id from addMethod()
+        /// @param work handler
+        /// @param result set to the handler's result if RpcOutcome::OK
+        /// @param long_running true if the handler may block for a long time
+        template <typename result_t>
+        RpcOutcome call(int method, const std::function<result_t()>& work, result_t& result, bool long_running);
+
+        /// @brief Copy the statistics of all methods. Thread-safe.
+        std::vector<RpcMethodStats> stats() const;
+
+    private:
+        RpcOutcome execute(int method, const std::function<void()>& work, bool long_running);
+        void record(int method, RpcOutcome outcome, uint64_t start_ns);
+
+        mutable std::mutex stats_mutex_;
+        std::vector<RpcMethodStats> stats_;
+
+        /// @brief long-running handlers running, guarded by stats_mutex_
+        int long_running_;
+    };
+
+    template <typename result_t>
+    RpcOutcome RpcService::call(int method, const std::function<result_t()>& work, result_t& result, bool long_running)
+    {
+        return execute(method, [&work, &result]() { result = work(); }, long_running);
+    }
+
+} // namespace kswx_weiss_gripkit
+
+#endif // KR2_CBUN_RPC_SERVICE
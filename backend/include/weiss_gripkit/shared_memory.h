@@ -37,57 +37,228 @@
 
 #include <boost/interprocess/mapped_region.hpp>
 #include <boost/interprocess/sync/interprocess_mutex.hpp>
+#include <boost/interprocess/sync/interprocess_condition.hpp>
 #include <boost/interprocess/shared_memory_object.hpp>
 #include <boost/interprocess/sync/scoped_lock.hpp>
+#include <boost/interprocess/exceptions.hpp>
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <time.h>
+#include <unistd.h>
+
+#define SHM_DATA_OFFSET 64
+#define SHM_READY_MAGIC 0x4b475259
+#define SHM_RETIRED_MAGIC 0x4b474f4c
+#define SHM_ATTACH_TIMEOUT_MS 2000
+#define SHM_ATTACH_BACKOFF_MIN_US 100
+#define SHM_ATTACH_BACKOFF_MAX_US 20000
+#define SHM_REMAP_RETRY_MS 100
 
 namespace kswx_weiss_gripkit {
 
+    /// @brief Header in front of the data of a SharedMemoryObject segment. A zero-filled segment (created, not yet constructed) reads as
+    /// not ready, the creator publishes magic_ last.
+    struct SharedMemoryHeader
+    {
+        /// @brief SHM_READY_MAGIC once data_t is constructed, SHM_RETIRED_MAGIC once the creator removed or replaced the segment
+        std::atomic<uint32_t> magic_;
+
+        /// @brief sizeof(data_t) of the creator, attach fails on a mismatch (CBun versions mixed)
+        uint32_t size_;
+
+        /// @brief CLOCK_MONOTONIC time of the creation in nanoseconds, identifies the segment
+        uint64_t generation_;
+    };
+
+    static_assert(sizeof(SharedMemoryHeader) <= SHM_DATA_OFFSET, "SharedMemoryHeader does not fit in front of the data");
+
     /// @brief Wrapper for shared memory object from boost library.
+    /// The creator constructs the data and then marks the segment ready; attach never resizes the segment and waits with bounded
+    /// backoff until it is ready. When the creator removes or recreates the segment it marks the old one retired, getData of an
+    /// attached process then maps the new segment. Mappings replaced this way stay mapped until the object is destroyed, so
+    /// pointers returned earlier remain valid.
     /// @tparam data_t type of data to put in the shared memory, has to be default-constructible and can only contain data, not references.
     template <typename data_t>
     class SharedMemoryObject
     {
+        static_assert(alignof(data_t) <= SHM_DATA_OFFSET, "data_t alignment exceeds SHM_DATA_OFFSET");
+
     public:
         /// @brief Wrapper for shared memory object from boost library.
         /// @param id string id for the shared memory
-        inline SharedMemoryObject(std::string id) : id_(id), data_(NULL) {}
+        inline SharedMemoryObject(std::string id) : id_(id), header_(NULL), data_(NULL), created_(false), next_remap_ns_(0) {}
+
+        SharedMemoryObject(const SharedMemoryObject&) = delete;
+        SharedMemoryObject& operator=(const SharedMemoryObject&) = delete;
 
-        /// @brief Create the shared memory object with id id_, to be called from the main process. Remove shared memory of the same name if it exists. data_t can only contain data, not references. 
+        /// @brief Create the shared memory object with id id_, to be called from the main process. Retire and remove shared memory of the
+        /// same name if it exists. data_t can only contain data, not references.
         inline void create()
         {
+            std::lock_guard<std::mutex> lock(map_mutex_);
+            retireExisting();
             boost::interprocess::shared_memory_object::remove(id_.c_str());
+
             boost::interprocess::shared_memory_object shm_object(boost::interprocess::create_only, id_.c_str(), boost::interprocess::read_write);
-            shm_object.truncate(sizeof(data_t));
+            shm_object.truncate(SHM_DATA_OFFSET + sizeof(data_t));
+            keepMapping();
             shm_region_ = boost::interprocess::mapped_region(shm_object, boost::interprocess::read_write);
-            data_ = new (shm_region_.get_address()) data_t();
+
+            char* base = static_cast<char*>(shm_region_.get_address());
+            SharedMemoryHeader* header = reinterpret_cast<SharedMemoryHeader*>(base);
+            data_.store(new (base + SHM_DATA_OFFSET) data_t(), std::memory_order_release);
+            header->size_ = sizeof(data_t);
+            header->generation_ = monotonicNs();
+            header->magic_.store(SHM_READY_MAGIC, std::memory_order_release);
+            header_.store(header, std::memory_order_release);
+            created_.store(true, std::memory_order_release);
         }
 
-        /// @brief Destroy the shared memory object with id id_, to be called from the main process.
+        /// @brief Destroy the shared memory object with id id_, to be called from the main process. Attached processes see it retired.
         inline void destroy()
         {
+            std::lock_guard<std::mutex> lock(map_mutex_);
+            SharedMemoryHeader* header = header_.load(std::memory_order_relaxed);
+            if (header && created_.load(std::memory_order_relaxed))
+                header->magic_.store(SHM_RETIRED_MAGIC, std::memory_order_release);
             boost::interprocess::shared_memory_object::remove(id_.c_str());
+            created_.store(false, std::memory_order_release);
         }
 
-        /// @brief Open existing shared memory object with with id id_, to be called from other processes.
-        inline void attach()
+        /// @brief Open existing shared memory object with id id_, to be called from other processes. Retries with exponential backoff
+        /// (SHM_ATTACH_BACKOFF_MIN_US up to SHM_ATTACH_BACKOFF_MAX_US) while the segment does not exist or is not ready yet.
+        /// @param timeout_ms maximum time to wait for the segment
+        /// @return true if attached, false on timeout; getData then tries once more per call and returns NULL until the segment is ready
+        inline bool attach(int timeout_ms = SHM_ATTACH_TIMEOUT_MS)
         {
-            boost::interprocess::shared_memory_object shm_object(boost::interprocess::open_only, id_.c_str(), boost::interprocess::read_write);
-            shm_object.truncate(sizeof(data_t));
-            shm_region_ = boost::interprocess::mapped_region(shm_object, boost::interprocess::read_write);
-            data_ = static_cast<data_t*>(shm_region_.get_address());
+            std::lock_guard<std::mutex> lock(map_mutex_);
+            uint64_t deadline_ns = monotonicNs() + static_cast<uint64_t>(timeout_ms) * 1000000ULL;
+            useconds_t backoff_us = SHM_ATTACH_BACKOFF_MIN_US;
+            while (true)
+            {
+                if (tryAttach())
+                    return true;
+                uint64_t now_ns = monotonicNs();
+                if (now_ns >= deadline_ns)
+                    return false;
+                usleep(static_cast<useconds_t>(std::min<uint64_t>(backoff_us, (deadline_ns - now_ns) / 1000 + 1)));
+                backoff_us = std::min<useconds_t>(backoff_us * 2, SHM_ATTACH_BACKOFF_MAX_US);
+            }
         }
 
-        /// @brief Get data from shared memory. Should only be called after create (main process) or attach (other processes) and before destroy (main process).
-        /// @return 
+        /// @brief Get data from shared memory. Should only be called after create (main process) or attach (other processes) and before
+        /// destroy (main process). In an attached process, maps the new segment if the creator replaced it. A failed remap is retried
+        /// at most every SHM_REMAP_RETRY_MS, so a segment that is never recreated does not cost an open and map on every call.
+        /// @return data, NULL if not created or attached
         inline data_t* getData()
         {
-            return data_;
+            SharedMemoryHeader* header = header_.load(std::memory_order_acquire);
+            if (!created_.load(std::memory_order_acquire) && (!header || header->magic_.load(std::memory_order_acquire) != SHM_READY_MAGIC))
+            {
+                uint64_t now_ns = monotonicNs();
+                if (now_ns < next_remap_ns_.load(std::memory_order_relaxed))
+                    return NULL;
+
+                std::lock_guard<std::mutex> lock(map_mutex_);
+                header = header_.load(std::memory_order_relaxed);
+                if ((!header || header->magic_.load(std::memory_order_acquire) != SHM_READY_MAGIC) && !tryAttach())
+                {
+                    next_remap_ns_.store(now_ns + SHM_REMAP_RETRY_MS * 1000000ULL, std::memory_order_relaxed);
+                    return NULL;
+                }
+            }
+            return data_.load(std::memory_order_acquire);
+        }
+
+        /// @brief Get the generation of the mapped segment, 0 if none. Changes when the creator recreates the segment.
+        inline uint64_t generation() const
+        {
+            SharedMemoryHeader* header = header_.load(std::memory_order_acquire);
+            return header ? header->generation_ : 0;
         }
 
     private:
+        /// @brief One attach attempt, called with map_mutex_ locked. The segment is neither created nor resized.
+        inline bool tryAttach()
+        {
+            try
+            {
+                boost::interprocess::shared_memory_object shm_object(boost::interprocess::open_only, id_.c_str(), boost::interprocess::read_write);
+                boost::interprocess::offset_t size = 0;
+                if (!shm_object.get_size(size) || size < static_cast<boost::interprocess::offset_t>(SHM_DATA_OFFSET + sizeof(data_t)))
+                    return false;
+
+                boost::interprocess::mapped_region region(shm_object, boost::interprocess::read_write);
+                char* base = static_cast<char*>(region.get_address());
+                SharedMemoryHeader* header = reinterpret_cast<SharedMemoryHeader*>(base);
+                if (header->magic_.load(std::memory_order_acquire) != SHM_READY_MAGIC || header->size_ != sizeof(data_t))
+                    return false;
+
+                keepMapping();
+                shm_region_.swap(region);
+                data_.store(reinterpret_cast<data_t*>(base + SHM_DATA_OFFSET), std::memory_order_release);
+                header_.store(header, std::memory_order_release);
+                return true;
+            }
+            catch (const boost::interprocess::interprocess_exception&)
+            {
+                return false;
+            }
+        }
+
+        /// @brief Mark a segment left by a previous creator retired, so that its attached processes remap. Called with map_mutex_ locked.
+        inline void retireExisting()
+        {
+            try
+            {
+                boost::interprocess::shared_memory_object shm_object(boost::interprocess::open_only, id_.c_str(), boost::interprocess::read_write);
+                boost::interprocess::offset_t size = 0;
+                if (!shm_object.get_size(size) || size < static_cast<boost::interprocess::offset_t>(sizeof(SharedMemoryHeader)))
+                    return;
+
+                boost::interprocess::mapped_region region(shm_object, boost::interprocess::read_write, 0, sizeof(SharedMemoryHeader));
+                static_cast<SharedMemoryHeader*>(region.get_address())->magic_.store(SHM_RETIRED_MAGIC, std::memory_order_release);
+            }
+            catch (const boost::interprocess::interprocess_exception&)
+            {
+                // no previous segment
+            }
+        }
+
+        /// @brief Keep the current mapping alive before it is replaced, pointers to it may still be in use. Called with map_mutex_ locked.
+        inline void keepMapping()
+        {
+            if (shm_region_.get_address())
+            {
+                retired_regions_.emplace_back();
+                retired_regions_.back().swap(shm_region_);
+            }
+        }
+
+        static inline uint64_t monotonicNs()
+        {
+            struct timespec ts;
+            clock_gettime(CLOCK_MONOTONIC, &ts);
+            return static_cast<uint64_t>(ts.tv_sec) * 1000000000ULL + static_cast<uint64_t>(ts.tv_nsec);
+        }
+
         std::string id_;
         boost::interprocess::mapped_region shm_region_;
-        data_t* data_;
+        std::vector<boost::interprocess::mapped_region> retired_regions_;
+        std::mutex map_mutex_;
+        std::atomic<SharedMemoryHeader*> header_;
+        std::atomic<data_t*> data_;
+
+        /// @brief true between create and destroy, read without map_mutex_ by getData
+        std::atomic<bool> created_;
+
+        /// @brief CLOCK_MONOTONIC time before which getData does not retry a failed remap
+        std::atomic<uint64_t> next_remap_ns_;
     };
 
     /// @brief Access to data_t protected by boost's interprocess mutex.
@@ -158,6 +329,52 @@ namespace kswx_weiss_gripkit {
         boost::interprocess::interprocess_mutex mutex_;
     };
 
+    /// @brief Process-shared event count, lets processes sleep until an event instead of polling shared data.
+    /// A waiter reads generation(), checks its condition on the shared data and only then calls waitChange with the read generation,
+    /// so a notify between the check and the wait is not lost.
+    class SharedEventCount
+    {
+    public:
+        /// @brief Process-shared event count. Set generation to 0.
+        inline SharedEventCount() : generation_(0) {}
+
+        /// @brief Current generation, protected by interprocess mutex.
+        inline uint64_t generation()
+        {
+            boost::interprocess::scoped_lock<boost::interprocess::interprocess_mutex> lock(mutex_);
+            return generation_;
+        }
+
+        /// @brief Increment the generation and wake all waiters, protected by interprocess mutex.
+        inline void notify()
+        {
+            boost::interprocess::scoped_lock<boost::interprocess::interprocess_mutex> lock(mutex_);
+            ++generation_;
+            condition_.notify_all();
+        }
+
+        /// @brief Sleep until the generation differs from generation or the timeout expires.
+        /// @param generation generation read before checking the awaited condition
+        /// @param timeout_ms maximum time to sleep
+        /// @return true if the generation changed, false on timeout
+        inline bool waitChange(uint64_t generation, int timeout_ms)
+        {
+            boost::posix_time::ptime deadline = boost::posix_time::microsec_clock::universal_time() + boost::posix_time::milliseconds(timeout_ms);
+            boost::interprocess::scoped_lock<boost::interprocess::interprocess_mutex> lock(mutex_);
+            while (generation_ == generation)
+            {
+                if (!condition_.timed_wait(lock, deadline))
+                    return generation_ != generation;
+            }
+            return true;
+        }
+
+    private:
+        uint64_t generation_;
+        boost::interprocess::interprocess_mutex mutex_;
+        boost::interprocess::interprocess_condition condition_;
+    };
+
 } // namespace kswx_weiss_gripkit
 
 #endif // KR2_CBUN_SHARED_MEMORY
\ No newline at end of file
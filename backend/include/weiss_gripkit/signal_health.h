@@ -0,0 +1,130 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2023, KR Soft s.r.o.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the Kassow Robots nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#ifndef KR2_CBUN_SIGNAL_HEALTH
+#define KR2_CBUN_SIGNAL_HEALTH
+
+#include "weiss_gripkit/gripkit_logic.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+#define SIGNAL_EWMA_ALPHA 0.02f
+#define SIGNAL_THRESHOLD_BAND_V 4.0f
+#define SIGNAL_HEALTH_PUBLISH_TICKS 10
+
+namespace kswx_weiss_gripkit {
+
+    /// @brief Streaming statistics of one analog input voltage, O(1) per sample. Plain data, can be used in shared memory.
+    struct PinHealth
+    {
+        /// @brief Add a sample.
+        /// @param voltage sampled voltage, NaN if the input was missing
+        /// @param now_ns CLOCK_MONOTONIC time of the sample in nanoseconds
+        inline void add(float voltage, uint64_t now_ns)
+        {
+            uint64_t elapsed_ns = (last_ns_ > 0 && now_ns > last_ns_) ? now_ns - last_ns_ : 0;
+            last_ns_ = now_ns;
+
+            if (std::isnan(voltage))
+            {
+                ++missing_;
+                return;
+            }
+
+            if (samples_ == 0)
+            {
+                ewma_ = voltage;
+                ewm_variance_ = 0.0f;
+                min_ = voltage;
+                max_ = voltage;
+            }
+            else
+            {
+                // exponentially weighted mean and variance
+                float delta = voltage - ewma_;
+                ewma_ += SIGNAL_EWMA_ALPHA * delta;
+                ewm_variance_ = (1.0f - SIGNAL_EWMA_ALPHA) * (ewm_variance_ + SIGNAL_EWMA_ALPHA * delta * delta);
+                min_ = std::min(min_, voltage);
+                max_ = std::max(max_, voltage);
+            }
+            ++samples_;
+
+            // time spent close to the decision threshold, where noise can flip the decoded bit
+            if (std::fabs(voltage - INPUT_HIGH_VOLTAGE) < SIGNAL_THRESHOLD_BAND_V)
+            {
+                near_threshold_ns_ += elapsed_ns;
+                ++near_threshold_samples_;
+            }
+        }
+
+        /// @brief number of valid samples
+        uint64_t samples_;
+
+        /// @brief number of samples with the input missing
+        uint64_t missing_;
+
+        /// @brief number of samples within SIGNAL_THRESHOLD_BAND_V of INPUT_HIGH_VOLTAGE
+        uint64_t near_threshold_samples_;
+
+        /// @brief time spent within SIGNAL_THRESHOLD_BAND_V of INPUT_HIGH_VOLTAGE in nanoseconds
+        uint64_t near_threshold_ns_;
+
+        /// @brief time of the last sample
+        uint64_t last_ns_;
+
+        float ewma_;
+        float ewm_variance_;
+        float min_;
+        float max_;
+    };
+
+    /// @brief Health statistics of the gripper inputs, shared from the master instance.
+    struct SignalHealth
+    {
+        /// @brief Add both voltages of a status sample.
+        inline void add(const GripkitSample& sample)
+        {
+            gripped_.add(sample.gripped_voltage_, sample.monotonic_ns_);
+            no_error_.add(sample.no_error_voltage_, sample.monotonic_ns_);
+        }
+
+        PinHealth gripped_;
+        PinHealth no_error_;
+    };
+
+} // namespace kswx_weiss_gripkit
+
+#endif // KR2_CBUN_SIGNAL_HEALTH
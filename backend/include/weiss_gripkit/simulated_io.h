@@ -0,0 +1,264 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2023, KR Soft s.r.o.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the Kassow Robots nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#ifndef KR2_CBUN_SIMULATED_IO
+#define KR2_CBUN_SIMULATED_IO
+
+#include <cmath>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#define SIMULATED_HIGH_VOLTAGE 24.0f
+#define SIMULATED_LOW_VOLTAGE 0.0f
+
+namespace kswx_weiss_gripkit {
+
+    /// @brief Float GPIO entry of SimulatedIOData, same members as kr2rc_api::IOData::GPIOFloat used by readSample().
+    struct SimulatedGPIOFloat
+    {
+        uint32_t gpio_id_;
+        float value_;
+    };
+
+    /// @brief Stand-in for kr2rc_api::IOData (iob_data_) serving the gripper inputs among other float GPIOs, for replay and testing without a controller.
+    class SimulatedIOData
+    {
+    public:
+        /// @param duid_gripped DUID of the gripped input
+        /// @param duid_no_error DUID of the no error input
+        /// @param other_inputs number of unrelated float GPIOs scanned before the gripper inputs, like on a real controller
+        inline SimulatedIOData(uint32_t duid_gripped, uint32_t duid_no_error, int other_inputs = 14)
+        {
+            for (int i = 0; i < other_inputs; ++i)
+                inputs_.push_back(SimulatedGPIOFloat{ static_cast<uint32_t>(1000 + i), 0.0f });
+
+            gripped_index_ = inputs_.size();
+            inputs_.push_back(SimulatedGPIOFloat{ duid_gripped, SIMULATED_LOW_VOLTAGE });
+            no_error_index_ = inputs_.size();
+            inputs_.push_back(SimulatedGPIOFloat{ duid_no_error, SIMULATED_LOW_VOLTAGE });
+            present_count_ = inputs_.size();
+        }
+
+        /// @brief Set gripper input voltages. NaN removes both inputs from the scan, which decodes as STATUS_ERROR.
+        inline void setInputs(float gripped_voltage, float no_error_voltage)
+        {
+            bool present = !std::isnan(gripped_voltage) && !std::isnan(no_error_voltage);
+            present_count_ = present ? inputs_.size() : gripped_index_;
+            inputs_[gripped_index_].value_ = gripped_voltage;
+            inputs_[no_error_index_].value_ = no_error_voltage;
+        }
+
+        inline int read_N_GPIOFloat() const { return static_cast<int>(present_count_); }
+
+        inline const SimulatedGPIOFloat* read_GPIOFloat(int index) const
+        {
+            return (index >= 0 && static_cast<size_t>(index) < present_count_) ? &inputs_[index] : nullptr;
+        }
+
+    private:
+        std::vector<SimulatedGPIOFloat> inputs_;
+        size_t gripped_index_;
+        size_t no_error_index_;
+        size_t present_count_;
+    };
+
+    /// @brief Behavioral model of the CR EASY gripper outputs driven by its grip input. Strokes take a fixed time, a grip ends in HOLDING
+    /// or NO_PART, and a switch from RELEASED to NO_PART shows a short IDLE_OR_ERROR glitch, as seen on the real gripper.
+    class SimulatedGripper
+    {
+    public:
+        struct Config
+        {
+            /// @brief duration of a grip or release stroke in seconds
+            double stroke_s = 0.15;
+
+            /// @brief probability that a grip ends with no part detected
+            double no_part_probability = 0.2;
+
+            /// @brief duration of the IDLE_OR_ERROR glitch before NO_PART in seconds
+            double no_part_glitch_s = 0.02;
+
+            /// @brief standard deviation of the voltage noise
+            double noise_v = 0.2;
+
+            unsigned int seed = 1;
+        };
+
+        inline explicit SimulatedGripper(const Config& config)
+        : config_(config), random_(config.seed), grip_(false), stroke_start_s_(-1e9), no_part_(false) {}
+
+        /// @brief Set the grip input (IN1) at time_s.
+        inline void setGrip(bool grip, double time_s)
+        {
+            if (grip == grip_)
+                return;
+
+            grip_ = grip;
+            stroke_start_s_ = time_s;
+            if (grip)
+                no_part_ = std::uniform_real_distribution<double>(0.0, 1.0)(random_) < config_.no_part_probability;
+        }
+
+        inline bool grip() const { return grip_; }
+
+        /// @brief Get output voltages at time_s (not earlier than the last setGrip call).
+        inline void sample(double time_s, float& gripped_voltage, float& no_error_voltage)
+        {
+            double elapsed_s = time_s - stroke_start_s_;
+            bool gripped;
+            bool no_error;
+
+            if (elapsed_s < config_.stroke_s)
+            {
+                // outputs keep the previous state while moving
+                gripped = !grip_;
+                no_error = grip_ || !no_part_;
+            }
+            else if (grip_ && no_part_)
+            {
+                gripped = elapsed_s >= config_.stroke_s + config_.no_part_glitch_s;
+                no_error = false;
+            }
+            else
+            {
+                gripped = grip_;
+                no_error = true;
+            }
+
+            gripped_voltage = (gripped ? SIMULATED_HIGH_VOLTAGE : SIMULATED_LOW_VOLTAGE) + noise();
+            no_error_voltage = (no_error ? SIMULATED_HIGH_VOLTAGE : SIMULATED_LOW_VOLTAGE) + noise();
+        }
+
+    private:
+        inline float noise()
+        {
+            return (config_.noise_v > 0.0) ? static_cast<float>(std::normal_distribution<double>(0.0, config_.noise_v)(random_)) : 0.0f;
+        }
+
+        Config config_;
+        std::mt19937 random_;
+        bool grip_;
+        double stroke_start_s_;
+        bool no_part_;
+    };
+
+    /// @brief Simulated time with a controller updating its I/O data every cycle, for testing cycle synchronized sampling.
+    /// Time only advances by sleeping and by the cost of I/O reads, so runs are deterministic and faster than real time.
+    class SimulatedControllerClock
+    {
+    public:
+        struct Config
+        {
+            /// @brief nominal I/O cycle of the controller in microseconds
+            double cycle_us = 1000.0;
+
+            /// @brief time of the first I/O update in microseconds
+            double phase_us = 370.0;
+
+            /// @brief drift of the controller clock against CLOCK_MONOTONIC in parts per million
+            double drift_ppm = 50.0;
+
+            /// @brief maximal wake-up latency after a sleep in microseconds, uniformly distributed
+            double wake_jitter_us = 50.0;
+
+            /// @brief duration of one I/O read in microseconds
+            double read_cost_us = 5.0;
+
+            unsigned int seed = 1;
+        };
+
+        inline explicit SimulatedControllerClock(const Config& config)
+        : config_(config), random_(config.seed), now_ns_(1000000000ULL),
+          cycle_ns_(config.cycle_us * 1000.0 * (1.0 + config.drift_ppm * 1e-6)), phase_ns_(config.phase_us * 1000.0) {}
+
+        inline uint64_t nowNs() const { return now_ns_; }
+
+        inline void advanceNs(uint64_t duration_ns) { now_ns_ += duration_ns; }
+
+        /// @brief Sleep until time_ns plus wake-up latency.
+        inline void sleepUntilNs(uint64_t time_ns)
+        {
+            if (time_ns > now_ns_)
+                now_ns_ = time_ns;
+            now_ns_ += static_cast<uint64_t>(std::uniform_real_distribution<double>(0.0, config_.wake_jitter_us * 1000.0)(random_));
+        }
+
+        /// @brief Index of the I/O frame visible now.
+        inline uint64_t frame() const
+        {
+            return (now_ns_ > phase_ns_) ? static_cast<uint64_t>((now_ns_ - phase_ns_) / cycle_ns_) : 0;
+        }
+
+        /// @brief Time when the I/O frame visible now was published.
+        inline uint64_t lastUpdateNs() const
+        {
+            return static_cast<uint64_t>(phase_ns_ + frame() * cycle_ns_);
+        }
+
+        /// @brief Read the I/O data, return the frame index as fingerprint.
+        inline uint64_t read()
+        {
+            now_ns_ += static_cast<uint64_t>(config_.read_cost_us * 1000.0);
+            return frame();
+        }
+
+    private:
+        Config config_;
+        std::mt19937 random_;
+        uint64_t now_ns_;
+        double cycle_ns_;
+        double phase_ns_;
+    };
+
+    /// @brief Clock source of CycleSync backed by SimulatedControllerClock.
+    struct SimulatedClockSource
+    {
+        inline uint64_t nowNs() { return clock_->nowNs(); }
+        inline void sleepUntilNs(uint64_t time_ns) { clock_->sleepUntilNs(time_ns); }
+
+        SimulatedControllerClock* clock_;
+    };
+
+    /// @brief I/O probe of CycleSync backed by SimulatedControllerClock.
+    struct SimulatedIOProbe
+    {
+        inline uint64_t operator()() { return clock_->read(); }
+
+        SimulatedControllerClock* clock_;
+    };
+
+} // namespace kswx_weiss_gripkit
+
+#endif // KR2_CBUN_SIMULATED_IO
@@ -0,0 +1,280 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2023, KR Soft s.r.o.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the Kassow Robots nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#ifndef KR2_CBUN_STATUS_EVENTS
+#define KR2_CBUN_STATUS_EVENTS
+
+#include "weiss_gripkit/gripkit_types.h"
+#include "weiss_gripkit/gripkit_logic.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <semaphore.h>
+#include <thread>
+
+#define STATUS_EVENT_QUEUE_CAPACITY 64
+#define STATUS_EVENT_MAX_SUBSCRIBERS 8
+
+namespace kswx_weiss_gripkit {
+
+    /// @brief Type of a gripper event, bit mask values for subscriptions.
+    enum class StatusEventType : uint8_t
+    {
+        STATUS_CHANGED = 1,
+        ACTION_COMPLETED = 2,
+        FAULT = 4
+    };
+
+    /// @brief subscription mask of all event types
+    #define STATUS_EVENT_ALL (static_cast<unsigned int>(StatusEventType::STATUS_CHANGED) | \
+        static_cast<unsigned int>(StatusEventType::ACTION_COMPLETED) | static_cast<unsigned int>(StatusEventType::FAULT))
+
+    /// @brief Gripper status changed.
+    struct StatusTransition
+    {
+        GripkitCrEasyStatus status_;
+
+        /// @brief status before the change, equal to status_ for the first status after activation
+        GripkitCrEasyStatus previous_status_;
+
+        /// @brief sequence number of the published status
+        uint64_t sequence_;
+
+        /// @brief CLOCK_MONOTONIC time of the GPIO sample in nanoseconds
+        uint64_t sample_time_ns_;
+    };
+
+    /// @brief Error status persisted MIN_CONTINUOUS_ERROR_COUNT ticks. Short error blips while switching between
+    /// RELEASED and NO_PART are not reported.
+    struct GripperFault
+    {
+        /// @brief IDLE_OR_ERROR or STATUS_ERROR
+        GripkitCrEasyStatus status_;
+
+        /// @brief last healthy status before the fault
+        GripkitCrEasyStatus previous_status_;
+
+        uint64_t sequence_;
+        uint64_t sample_time_ns_;
+    };
+
+    /// @brief Event queued for a subscriber, one of the typed events selected by type_.
+    struct StatusEvent
+    {
+        StatusEventType type_;
+        union
+        {
+            StatusTransition transition_;
+            ActionCompletion completion_;
+            GripperFault fault_;
+        };
+    };
+
+    /// @brief Typed observer of gripper events. Methods are called from the executor thread of the subscription,
+    /// one at a time and in publish order; they may block without delaying the status monitor or other subscribers.
+    class StatusObserver
+    {
+    public:
+        virtual ~StatusObserver() {}
+
+        virtual void onStatusChanged(const StatusTransition&) {}
+        virtual void onActionCompleted(const ActionCompletion&) {}
+        virtual void onFault(const GripperFault&) {}
+    };
+
+    /// @brief Lock-free bounded queue for a single producer thread and a single consumer thread.
+    /// @tparam capacity number of slots, power of two
+    template <typename item_t, size_t capacity>
+    class SpscQueue
+    {
+        static_assert(capacity > 0 && (capacity & (capacity - 1)) == 0, "SpscQueue capacity must be a power of two");
+
+    public:
+        SpscQueue() : head_(0), tail_(0) {}
+
+        /// @brief Append an item, producer thread only.
+        /// @return false if the queue is full
+        inline bool push(const item_t& item)
+        {
+            size_t tail = tail_.load(std::memory_order_relaxed);
+            if (tail - head_.load(std::memory_order_acquire) == capacity)
+                return false;
+
+            items_[tail & (capacity - 1)] = item;
+            tail_.store(tail + 1, std::memory_order_release);
+            return true;
+        }
+
+        /// @brief Remove the oldest item, consumer thread only.
+        /// @return false if the queue is empty
+        inline bool pop(item_t& item)
+        {
+            size_t head = head_.load(std::memory_order_relaxed);
+            if (head == tail_.load(std::memory_order_acquire))
+                return false;
+
+            item = items_[head & (capacity - 1)];
+            head_.store(head + 1, std::memory_order_release);
+            return true;
+        }
+
+    private:
+        // head and tail on separate cache lines, padded instead of alignas, which C++14 new does not honor
+        std::atomic<size_t> head_;
+        char head_padding_[64 - sizeof(std::atomic<size_t>)];
+        std::atomic<size_t> tail_;
+        char tail_padding_[64 - sizeof(std::atomic<size_t>)];
+        item_t items_[capacity];
+    };
+
+    /// @brief Subscription of one observer: SPSC queue filled by the status monitoring thread and an executor thread
+    /// draining it into the observer.
+    class StatusSubscription
+    {
+    public:
+        StatusSubscription(StatusObserver* observer, unsigned int event_mask);
+
+        /// @brief Stop the executor thread, events still queued are not delivered.
+        ~StatusSubscription();
+
+        StatusSubscription(const StatusSubscription&) = delete;
+        StatusSubscription& operator=(const StatusSubscription&) = delete;
+
+        /// @brief Queue the event if it matches the mask and wake the executor, never blocks. Publisher thread only.
+        /// @return false if the event was dropped because the queue is full
+        bool post(const StatusEvent& event);
+
+        /// @brief number of events dropped because the observer did not keep up
+        inline uint64_t droppedEvents() const { return dropped_events_.load(std::memory_order_relaxed); }
+
+    private:
+        void run();
+
+        StatusObserver* observer_;
+        unsigned int event_mask_;
+        SpscQueue<StatusEvent, STATUS_EVENT_QUEUE_CAPACITY> queue_;
+        sem_t wake_;
+        std::atomic<bool> running_;
+        std::atomic<uint64_t> dropped_events_;
+        std::thread thread_;
+    };
+
+    /// @brief Fan-out of gripper events from the status monitoring thread to subscribed observers. publish() takes no lock,
+    /// subscribe and unsubscribe serialize among themselves only.
+    class StatusEventHub
+    {
+    public:
+        StatusEventHub();
+
+        /// @brief Unsubscribe all observers. The publishing thread must be stopped.
+        ~StatusEventHub();
+
+        StatusEventHub(const StatusEventHub&) = delete;
+        StatusEventHub& operator=(const StatusEventHub&) = delete;
+
+        /// @brief Subscribe an observer to the event types in event_mask, the observer must outlive the subscription.
+        /// @return subscription id, -1 if the observer is NULL, the mask is empty or all STATUS_EVENT_MAX_SUBSCRIBERS slots are used
+        int subscribe(StatusObserver* observer, unsigned int event_mask = STATUS_EVENT_ALL);
+
+        /// @brief Remove a subscription and stop its executor, no observer method is running or called after return.
+        /// Must not be called from an observer method.
+        /// @return false if the id is not subscribed
+        bool unsubscribe(int subscription_id);
+
+        /// @brief Return true if at least one observer is subscribed, lets the publisher skip building events.
+        inline bool hasSubscribers() const { return subscribers_.load(std::memory_order_relaxed) > 0; }
+
+        /// @brief Deliver an event to all matching subscriptions. Single publisher thread, never blocks.
+        void publish(const StatusEvent& event);
+
+        /// @brief number of events dropped by all subscriptions since construction, lock-free
+        inline uint64_t droppedEvents() const { return dropped_events_.load(std::memory_order_relaxed); }
+
+    private:
+        /// @brief serializes subscribe/unsubscribe and owns the subscriptions
+        mutable std::mutex mutex_;
+        std::unique_ptr<StatusSubscription> owned_[STATUS_EVENT_MAX_SUBSCRIBERS];
+
+        /// @brief subscriptions visible to publish()
+        std::atomic<StatusSubscription*> slots_[STATUS_EVENT_MAX_SUBSCRIBERS];
+        std::atomic<int> subscribers_;
+
+        /// @brief set while publish() reads slots_, unsubscribe waits for it before deleting a subscription
+        std::atomic<bool> publishing_;
+
+        std::atomic<uint64_t> dropped_events_;
+    };
+
+    /// @brief Derives status transitions, action completions and faults from the per-tick status and picked up action.
+    /// Action completions come from its ActionTracker, which also feeds metrics and stroke learning.
+    /// Only accessed from the status monitoring thread.
+    class StatusEventSource
+    {
+    public:
+        StatusEventSource() : tracker_() { reset(); }
+
+        /// @brief Forget the previous status and any action in progress, call before the monitor starts.
+        inline void reset()
+        {
+            initialized_ = false;
+            status_ = GripkitCrEasyStatus::STATUS_ERROR;
+            healthy_status_ = GripkitCrEasyStatus::STATUS_ERROR;
+            error_ticks_ = 0;
+            tracker_.reset();
+        }
+
+        /// @brief Process one monitor tick and publish the resulting events to hub. Events are derived even without subscribers,
+        /// the returned mask and lastCompletion() feed the device metrics and stroke learning.
+        /// @param status status decoded in this tick
+        /// @param picked_action action picked up in this tick, NONE if there was no request
+        /// @return StatusEventType bits of the events of this tick
+        unsigned int update(StatusEventHub& hub, GripkitCrEasyStatus status, GripkitAction picked_action, uint64_t sequence, uint64_t sample_time_ns);
+
+        /// @brief Last action completion, valid after update returned ACTION_COMPLETED. A tick completes at most one action.
+        inline const ActionCompletion& lastCompletion() const { return tracker_.completion(); }
+
+    private:
+        ActionTracker tracker_;
+        bool initialized_;
+        GripkitCrEasyStatus status_;
+        GripkitCrEasyStatus healthy_status_;
+        int error_ticks_;
+    };
+
+} // namespace kswx_weiss_gripkit
+
+#endif // KR2_CBUN_STATUS_EVENTS
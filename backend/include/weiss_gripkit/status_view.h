@@ -0,0 +1,339 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2023, KR Soft s.r.o.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the Kassow Robots nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#ifndef KR2_CBUN_STATUS_VIEW
+#define KR2_CBUN_STATUS_VIEW
+
+// Standalone header, no KR2 API or boost dependency: external processes include it to read the gripper status.
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define STATUS_VIEW_NAME "/kswx_weiss_gripkit.gkeasy.view"
+#define STATUS_VIEW_MAGIC 0x56534b47
+#define STATUS_VIEW_RETIRED_MAGIC 0x52534b47
+#define STATUS_VIEW_VERSION 1
+#define STATUS_VIEW_READ_RETRIES 1000
+
+namespace kswx_weiss_gripkit {
+
+    /// @brief Status snapshot published by the status monitor of the master instance.
+    struct StatusViewData
+    {
+        /// @brief sequence number of the published status, same as in the status shared memory
+        uint64_t sequence;
+
+        /// @brief CLOCK_MONOTONIC time of the GPIO sample in nanoseconds
+        uint64_t sample_time_ns;
+
+        /// @brief CLOCK_REALTIME time of the GPIO sample in nanoseconds
+        uint64_t timestamp_ns;
+
+        /// @brief CLOCK_MONOTONIC time of the last monitor tick in nanoseconds, 0 if the monitor is not running
+        uint64_t heartbeat_ns;
+
+        /// @brief id of the last grip/release request
+        uint64_t request_id;
+
+        /// @brief number of grip and release actions executed by the monitor
+        uint64_t grip_count;
+        uint64_t release_count;
+
+        /// @brief number of status changes seen by the monitor
+        uint64_t status_changes;
+
+        /// @brief raw input voltages, NaN if the input was not found
+        float gripped_voltage;
+        float no_error_voltage;
+
+        /// @brief GripkitCrEasyStatus
+        uint8_t status;
+
+        /// @brief GripkitAction executed in the last tick, NONE if no request was picked up
+        uint8_t action;
+
+        uint8_t reserved[6];
+    };
+
+    static_assert(sizeof(StatusViewData) == 80, "StatusViewData layout changed, bump STATUS_VIEW_VERSION");
+
+    /// @brief Layout of the status view segment. Single writer seqlock: sequence is odd while the writer updates data.
+    /// A segment replaced or removed by the writer gets STATUS_VIEW_RETIRED_MAGIC, readers still mapping it reopen the new one.
+    struct StatusViewSegment
+    {
+        std::atomic<uint32_t> magic;
+        uint32_t version;
+        uint32_t data_size;
+        uint32_t reserved;
+        std::atomic<uint64_t> seqlock;
+        StatusViewData data;
+    };
+
+    /// @brief Writer of the status view, used by the status monitoring thread of the master instance. write() does no syscalls.
+    class StatusViewWriter
+    {
+    public:
+        inline StatusViewWriter() : segment_(nullptr) {}
+
+        inline virtual ~StatusViewWriter() { close(); }
+
+        StatusViewWriter(const StatusViewWriter&) = delete;
+        StatusViewWriter& operator=(const StatusViewWriter&) = delete;
+
+        /// @brief Create (or recreate) the segment and map it read-write. A segment left by a previous writer is retired first.
+        /// @return true on success, false otherwise (write() does nothing)
+        inline bool create(const char* name = STATUS_VIEW_NAME)
+        {
+            close();
+
+            retire(name);
+            shm_unlink(name);
+            int fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0644);
+            if (fd < 0)
+                return false;
+
+            if (ftruncate(fd, sizeof(StatusViewSegment)) != 0)
+            {
+                ::close(fd);
+                shm_unlink(name);
+                return false;
+            }
+
+            void* address = mmap(NULL, sizeof(StatusViewSegment), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, 0);
+            ::close(fd);
+            if (address == MAP_FAILED)
+            {
+                shm_unlink(name);
+                return false;
+            }
+
+            // readers check the header last, publish it after the data is initialized
+            segment_ = static_cast<StatusViewSegment*>(address);
+            std::memset(&segment_->data, 0, sizeof(segment_->data));
+            segment_->seqlock.store(0, std::memory_order_relaxed);
+            segment_->data_size = sizeof(StatusViewData);
+            segment_->version = STATUS_VIEW_VERSION;
+            segment_->reserved = 0;
+            segment_->magic.store(STATUS_VIEW_MAGIC, std::memory_order_release);
+
+            return true;
+        }
+
+        /// @brief Unmap and remove the segment, readers see it retired.
+        inline void destroy(const char* name = STATUS_VIEW_NAME)
+        {
+            close();
+            retire(name);
+            shm_unlink(name);
+        }
+
+        /// @brief Unmap the segment, it stays available to readers.
+        inline void close()
+        {
+            if (segment_)
+                munmap(segment_, sizeof(StatusViewSegment));
+            segment_ = nullptr;
+        }
+
+        inline bool isOpen() const { return segment_ != nullptr; }
+
+        /// @brief Publish a snapshot. Not thread-safe, single writer only.
+        inline void write(const StatusViewData& data)
+        {
+            if (!segment_)
+                return;
+
+            uint64_t sequence = segment_->seqlock.load(std::memory_order_relaxed);
+            segment_->seqlock.store(sequence + 1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+
+            segment_->data = data;
+
+            segment_->seqlock.store(sequence + 2, std::memory_order_release);
+        }
+
+    private:
+        /// @brief Mark the existing segment as retired, so readers mapping it switch to the next one.
+        static inline void retire(const char* name)
+        {
+            int fd = shm_open(name, O_RDWR, 0);
+            if (fd < 0)
+                return;
+
+            struct stat file_stat;
+            if (fstat(fd, &file_stat) == 0 && static_cast<size_t>(file_stat.st_size) >= sizeof(StatusViewSegment))
+            {
+                void* address = mmap(NULL, sizeof(StatusViewSegment), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+                if (address != MAP_FAILED)
+                {
+                    static_cast<StatusViewSegment*>(address)->magic.store(STATUS_VIEW_RETIRED_MAGIC, std::memory_order_release);
+                    munmap(address, sizeof(StatusViewSegment));
+                }
+            }
+            ::close(fd);
+        }
+
+        StatusViewSegment* segment_;
+    };
+
+    /// @brief Read-only mapping of the status view for external processes. Reads never block the writer and take no locks.
+    /// When the master instance recreates the segment, the next read() maps the new one.
+    class StatusViewReader
+    {
+    public:
+        enum class Error
+        {
+            NONE,
+
+            /// @brief segment does not exist (master instance not created or destroyed) or could not be mapped
+            NOT_FOUND,
+
+            /// @brief segment was created by an incompatible version
+            VERSION_MISMATCH,
+
+            /// @brief no consistent snapshot within STATUS_VIEW_READ_RETRIES attempts
+            BUSY
+        };
+
+        inline StatusViewReader() : segment_(nullptr) {}
+
+        inline virtual ~StatusViewReader() { close(); }
+
+        StatusViewReader(const StatusViewReader&) = delete;
+        StatusViewReader& operator=(const StatusViewReader&) = delete;
+
+        /// @brief Map the segment read-only and check its layout.
+        inline Error open(const char* name = STATUS_VIEW_NAME)
+        {
+            name_ = name;
+            return map();
+        }
+
+        inline void close()
+        {
+            unmap();
+            name_.clear();
+        }
+
+        inline bool isOpen() const { return segment_ != nullptr; }
+
+        /// @brief Copy a consistent snapshot, retry while the writer is updating it. A retired segment is replaced by the
+        /// current one, an opened reader whose segment was missing maps it once it exists. Both cost a shm_open per read
+        /// until the segment is available again.
+        inline Error read(StatusViewData& data)
+        {
+            if (name_.empty())
+                return Error::NOT_FOUND;
+
+            if (!segment_ || segment_->magic.load(std::memory_order_acquire) != STATUS_VIEW_MAGIC)
+            {
+                Error error = map();
+                if (error != Error::NONE)
+                    return error;
+            }
+
+            for (int i = 0; i < STATUS_VIEW_READ_RETRIES; ++i)
+            {
+                uint64_t before = segment_->seqlock.load(std::memory_order_acquire);
+                if (before & 1)
+                    continue;
+
+                std::memcpy(&data, const_cast<const StatusViewData*>(&segment_->data), sizeof(data));
+                std::atomic_thread_fence(std::memory_order_acquire);
+
+                if (segment_->seqlock.load(std::memory_order_relaxed) == before)
+                    return Error::NONE;
+            }
+
+            return Error::BUSY;
+        }
+
+    private:
+        inline Error map()
+        {
+            unmap();
+
+            int fd = shm_open(name_.c_str(), O_RDONLY, 0);
+            if (fd < 0)
+                return Error::NOT_FOUND;
+
+            struct stat file_stat;
+            if (fstat(fd, &file_stat) != 0 || static_cast<size_t>(file_stat.st_size) < sizeof(StatusViewSegment))
+            {
+                ::close(fd);
+                return Error::VERSION_MISMATCH;
+            }
+
+            void* address = mmap(NULL, sizeof(StatusViewSegment), PROT_READ, MAP_SHARED, fd, 0);
+            ::close(fd);
+            if (address == MAP_FAILED)
+                return Error::NOT_FOUND;
+
+            segment_ = static_cast<const StatusViewSegment*>(address);
+            uint32_t magic = segment_->magic.load(std::memory_order_acquire);
+            if (magic == STATUS_VIEW_RETIRED_MAGIC)
+            {
+                // removed, or replaced between shm_open and mmap
+                unmap();
+                return Error::NOT_FOUND;
+            }
+            if (magic != STATUS_VIEW_MAGIC || segment_->version != STATUS_VIEW_VERSION || segment_->data_size != sizeof(StatusViewData))
+            {
+                unmap();
+                return Error::VERSION_MISMATCH;
+            }
+
+            return Error::NONE;
+        }
+
+        inline void unmap()
+        {
+            if (segment_)
+                munmap(const_cast<StatusViewSegment*>(segment_), sizeof(StatusViewSegment));
+            segment_ = nullptr;
+        }
+
+        const StatusViewSegment* segment_;
+        std::string name_;
+    };
+
+} // namespace kswx_weiss_gripkit
+
+#endif // KR2_CBUN_STATUS_VIEW
@@ -0,0 +1,127 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2023, KR Soft s.r.o.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the Kassow Robots nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#ifndef KR2_CBUN_STROKE_MODEL
+#define KR2_CBUN_STROKE_MODEL
+
+#include "weiss_gripkit/gripkit_logic.h"
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+
+#define STROKE_HISTOGRAM_BIN_MS 5
+#define STROKE_HISTOGRAM_BINS 400
+#define STROKE_MIN_SAMPLES 20
+#define STROKE_DEADLINE_MARGIN 1.5
+#define STROKE_DEADLINE_SLACK_MS 30
+#define STROKE_DEADLINE_MIN_MS 100
+#define STROKE_UNLEARNED_GRIP_FACTOR 2.0
+
+namespace kswx_weiss_gripkit {
+
+    /// @brief Incremental statistics of stroke times: running mean and variance (Welford) and a fixed histogram for percentiles.
+    /// Plain data, persisted as is.
+    struct StrokeStats
+    {
+        /// @brief Add stroke time, O(1).
+        void add(double stroke_ms);
+
+        inline double mean() const { return mean_ms_; }
+
+        /// @brief Sample variance in ms^2.
+        inline double variance() const { return (count_ > 1) ? m2_ / (count_ - 1) : 0.0; }
+
+        /// @brief Percentile from the histogram, upper edge of the bin, strokes longer than the histogram count to the last bin.
+        /// @param p percentile in range 0-100
+        double percentile(double p) const;
+
+        /// @brief Blocking call deadline in ms: p99 * STROKE_DEADLINE_MARGIN + STROKE_DEADLINE_SLACK_MS, at least STROKE_DEADLINE_MIN_MS.
+        /// @return deadline, 0 (no deadline) until STROKE_MIN_SAMPLES strokes were learned
+        uint32_t deadlineMs() const;
+
+        uint64_t count_;
+        double mean_ms_;
+        double m2_;
+        uint32_t histogram_[STROKE_HISTOGRAM_BINS];
+    };
+
+    /// @brief Adaptive deadlines of blocking grip/release calls, shared from the master instance to sequences. 0 means no deadline.
+    struct StrokeDeadlines
+    {
+        uint32_t grip_ms_;
+        uint32_t release_ms_;
+    };
+
+    /// @brief Learns grip and release stroke times from the action completions of the status monitor (ActionTracker) and
+    /// persists them across restarts. Stroke time is measured from the tick that picked up the action to the first tick with
+    /// the final status. Actions that find the gripper already in the final state, fail or get interrupted by another action
+    /// are not learned.
+    /// Grips ending in HOLDING and in NO_PART are learned separately, a grip without a part closes fully and takes longer.
+    /// The grip deadline covers both: the larger of the two, or STROKE_UNLEARNED_GRIP_FACTOR times the learned one while the
+    /// other has fewer than STROKE_MIN_SAMPLES strokes.
+    class StrokeModel
+    {
+    public:
+        StrokeModel();
+
+        /// @brief Learn from a finished action. Called from the status monitoring thread only.
+        /// @return true if the completion was a stroke and was learned
+        bool learn(const ActionCompletion& completion);
+
+        /// @brief Get thread-safe copy of the statistics.
+        /// @param final_status HOLDING or NO_PART for grip strokes, ignored for release
+        StrokeStats stats(GripkitAction action, GripkitCrEasyStatus final_status = GripkitCrEasyStatus::HOLDING) const;
+
+        /// @brief Get deadlines from the current statistics.
+        StrokeDeadlines deadlines() const;
+
+        /// @brief Load statistics from file, keep current statistics on failure.
+        /// @return true on success
+        bool load(const std::string& path);
+
+        /// @brief Save statistics to file.
+        /// @return true on success
+        bool save(const std::string& path) const;
+
+    private:
+        mutable std::mutex mutex_;
+        StrokeStats grip_holding_;
+        StrokeStats grip_no_part_;
+        StrokeStats release_;
+    };
+
+} // namespace kswx_weiss_gripkit
+
+#endif // KR2_CBUN_STROKE_MODEL
@@ -44,21 +44,56 @@
 #include <unistd.h>
 
 namespace kswx_weiss_gripkit {
-    
-    /// @brief Class for monitoring a value and calling on_value_changed method on value change. Starts a separate thread.
+
+    /// @brief Monitor policy made of three callables, for BasicValueMonitor.
     /// @tparam value_t type of value to monitor
-    template <typename value_t>
-    class ValueMonitor
+    /// @tparam get_value_t callable type, value_t()
+    /// @tparam on_value_changed_t callable type, void(value_t)
+    /// @tparam tick_t callable type, void(value_t)
+    template <typename value_t, typename get_value_t, typename on_value_changed_t, typename tick_t>
+    struct CallbackMonitorPolicy
+    {
+        inline value_t getValue() { return get_value_function_(); }
+        inline void onValueChanged(value_t value) { on_value_changed_method_(value); }
+        inline void onTick(value_t value) { tick_method_(value); }
+
+        get_value_t get_value_function_;
+        on_value_changed_t on_value_changed_method_;
+        tick_t tick_method_;
+    };
+
+    /// @brief Create CallbackMonitorPolicy with deduced callable types, ie. lambdas stored by value without type erasure.
+    template <typename value_t, typename get_value_t, typename on_value_changed_t, typename tick_t>
+    inline CallbackMonitorPolicy<value_t, get_value_t, on_value_changed_t, tick_t> makeMonitorPolicy(get_value_t get_value_function,
+        on_value_changed_t on_value_changed_method, tick_t tick_method)
+    {
+        return CallbackMonitorPolicy<value_t, get_value_t, on_value_changed_t, tick_t>{ get_value_function, on_value_changed_method, tick_method };
+    }
+
+    /// @brief Class for monitoring a value and calling policy's onValueChanged method on value change. Starts a separate thread.
+    /// Policy methods are called directly, so they can be inlined into the monitoring loop, and nothing is allocated on construction.
+    /// @tparam value_t type of value to monitor
+    /// @tparam policy_t copyable type providing value_t getValue(), void onValueChanged(value_t) and void onTick(value_t)
+    /// @tparam wait_t callable type waiting between cycles, void(), e.g. a fixed sleep or a wait synchronized to the controller cycle
+    template <typename value_t, typename policy_t, typename wait_t = FixedSleepWait>
+    class BasicValueMonitor
     {
     public:
-        /// @brief Construct a thread that periodically checks a value using get_value and reports changes using on_value_changed.
-        /// @param get_value_function periodically called to get value
-        /// @param on_value_changed_method called with new value when value changed since last get_value call
-        /// @param tick_method called each cycle with value from get_value call
-        /// @param sleep_ms milliseconds to sleep each cycle
-        ValueMonitor(std::function<value_t()> get_value_function, std::function<void(value_t)> on_value_changed_method, std::function<void(value_t)> tick_method, int sleep_ms);
+        /// @brief Construct a thread that periodically checks a value using policy's getValue and reports changes using onValueChanged.
+        /// @param policy getValue periodically called to get value, onValueChanged called with new value when value changed since
+        /// last getValue call, onTick called each cycle with value from getValue call
+        /// @param sleep_ms milliseconds to sleep each cycle, only for wait_t FixedSleepWait
+        BasicValueMonitor(policy_t policy, int sleep_ms);
 
-        inline virtual ~ValueMonitor() {}
+        /// @brief Construct a thread that checks a value using policy's getValue after every wait_method call.
+        /// @param policy see above
+        /// @param wait_method called after each cycle, decides when the next value is sampled
+        BasicValueMonitor(policy_t policy, wait_t wait_method);
+
+        inline virtual ~BasicValueMonitor() {}
+
+        BasicValueMonitor(const BasicValueMonitor&) = delete;
+        BasicValueMonitor& operator=(const BasicValueMonitor&) = delete;
 
         /// @brief Start the monitoring thread with specified timeout. Caller needs to maintain proper call sequence (start, stop, start, stop), not (start, start) for example.
         /// @param timeout_ms timeout in milliseconds to start the thread
@@ -70,44 +105,82 @@ namespace kswx_weiss_gripkit {
         /// @return true if thread acknowledged stop request within timeout_ms milliseconds, false otherwise. Thread not joined if false.
         inline bool stop(int timeout_ms) { return periodic_thread_.stop(timeout_ms); }
 
-    private:
-        /// @brief Helper method for PeriodicThread.
+        /// @brief Run the initialization in the calling thread. Called from the monitoring thread, public for benchmarks only.
         void init();
 
-        /// @brief Helper method for PeriodicThread.
+        /// @brief Run one monitoring cycle in the calling thread. Called from the monitoring thread, public for benchmarks only.
         void cycle();
 
-        std::function<value_t()> get_value_function_;
-        std::function<void(value_t)> on_value_changed_method_;
-        std::function<void(value_t)> tick_method_;
+    private:
+        /// @brief Helper callable for BasicPeriodicThread.
+        struct InitMethod
+        {
+            BasicValueMonitor* monitor_;
+            inline void operator()() { monitor_->init(); }
+        };
+
+        /// @brief Helper callable for BasicPeriodicThread.
+        struct CycleMethod
+        {
+            BasicValueMonitor* monitor_;
+            inline void operator()() { monitor_->cycle(); }
+        };
+
+        policy_t policy_;
         
-        PeriodicThread periodic_thread_;
+        BasicPeriodicThread<InitMethod, CycleMethod, wait_t> periodic_thread_;
         value_t last_value_;
     };
-
+    
+    /// @brief Class for monitoring a value and calling on_value_changed method on value change. Starts a separate thread.
+    /// Type-erased version of BasicValueMonitor taking std::functions.
+    /// @tparam value_t type of value to monitor
     template <typename value_t>
-    void ValueMonitor<value_t>::init()
+    class ValueMonitor : public BasicValueMonitor<value_t,
+        CallbackMonitorPolicy<value_t, std::function<value_t()>, std::function<void(value_t)>, std::function<void(value_t)>>>
     {
-        last_value_ = get_value_function_();   
+    public:
+        /// @brief Construct a thread that periodically checks a value using get_value and reports changes using on_value_changed.
+        /// @param get_value_function periodically called to get value
+        /// @param on_value_changed_method called with new value when value changed since last get_value call
+        /// @param tick_method called each cycle with value from get_value call
+        /// @param sleep_ms milliseconds to sleep each cycle
+        ValueMonitor(std::function<value_t()> get_value_function, std::function<void(value_t)> on_value_changed_method, std::function<void(value_t)> tick_method, int sleep_ms);
+
+        inline virtual ~ValueMonitor() {}
+    };
+
+    template <typename value_t, typename policy_t, typename wait_t>
+    void BasicValueMonitor<value_t, policy_t, wait_t>::init()
+    {
+        last_value_ = policy_.getValue();   
     }
 
-    template <typename value_t>
-    void ValueMonitor<value_t>::cycle()
+    template <typename value_t, typename policy_t, typename wait_t>
+    void BasicValueMonitor<value_t, policy_t, wait_t>::cycle()
     {
-        value_t act_value = get_value_function_();
-        tick_method_(act_value);
+        value_t act_value = policy_.getValue();
+        policy_.onTick(act_value);
         if (last_value_ != act_value)
         {
-            on_value_changed_method_(act_value);
+            policy_.onValueChanged(act_value);
         }
         last_value_ = act_value;  
     }
 
+    template <typename value_t, typename policy_t, typename wait_t>
+    BasicValueMonitor<value_t, policy_t, wait_t>::BasicValueMonitor(policy_t policy, int sleep_ms) :
+    policy_(policy), periodic_thread_(InitMethod{ this }, CycleMethod{ this }, sleep_ms), last_value_() {}
+
+    template <typename value_t, typename policy_t, typename wait_t>
+    BasicValueMonitor<value_t, policy_t, wait_t>::BasicValueMonitor(policy_t policy, wait_t wait_method) :
+    policy_(policy), periodic_thread_(InitMethod{ this }, CycleMethod{ this }, wait_method), last_value_() {}
+
     template <typename value_t>
     ValueMonitor<value_t>::ValueMonitor(std::function<value_t()> get_value_function, std::function<void(value_t)> on_value_changed_method, std::function<void(value_t)> tick_method, int sleep_ms) :
-    get_value_function_(get_value_function), on_value_changed_method_(on_value_changed_method), tick_method_(tick_method),
-    periodic_thread_([this]() { init(); }, [this]() { cycle(); }, sleep_ms) {}
+    BasicValueMonitor<value_t, CallbackMonitorPolicy<value_t, std::function<value_t()>, std::function<void(value_t)>, std::function<void(value_t)>>>(
+        { get_value_function, on_value_changed_method, tick_method }, sleep_ms) {}
 
 } // namespace kswx_weiss_gripkit
 
-#endif // KR2_CBUN_VALUE_MONITOR
\ No newline at end of file
+#endif // KR2_CBUN_VALUE_MONITOR
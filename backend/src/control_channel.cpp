@@ -0,0 +1,450 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2023, KR Soft s.r.o.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the Kassow Robots nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#include "weiss_gripkit/control_channel.h"
+
+#include <cerrno>
+#include <cstring>
+#include <poll.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+using namespace kswx_weiss_gripkit;
+
+
+static bool makeAddress(const std::string& path, struct sockaddr_un& address)
+{
+    std::memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(address.sun_path))
+        return false;
+    std::strncpy(address.sun_path, path.c_str(), sizeof(address.sun_path) - 1);
+    return true;
+}
+
+ControlServer::ControlServer() :
+listen_fd_(-1),
+epoll_fd_(-1),
+wake_fd_(-1),
+running_(false),
+stopping_(false),
+dropped_events_(0),
+rejected_clients_(0),
+events_()
+{}
+
+ControlServer::~ControlServer()
+{
+    stop();
+}
+
+bool ControlServer::start(const std::string& path, handler_t handler)
+{
+    stop();
+
+    struct sockaddr_un address;
+    if (!makeAddress(path, address))
+        return false;
+
+    listen_fd_ = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    epoll_fd_ = epoll_create1(EPOLL_CLOEXEC);
+    wake_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (listen_fd_ < 0 || epoll_fd_ < 0 || wake_fd_ < 0)
+    {
+        stop();
+        return false;
+    }
+
+    // replace the socket file left behind by a previous instance, restrict it before anybody can connect
+    unlink(path.c_str());
+    if (bind(listen_fd_, reinterpret_cast<struct sockaddr*>(&address), sizeof(address)) != 0 ||
+        chmod(path.c_str(), CONTROL_SOCKET_MODE) != 0 || listen(listen_fd_, CONTROL_MAX_CLIENTS) != 0)
+    {
+        stop();
+        return false;
+    }
+    path_ = path;
+
+    {
+        std::lock_guard<std::mutex> lock(event_mutex_);
+        events_.clear();
+    }
+
+    struct epoll_event event;
+    std::memset(&event, 0, sizeof(event));
+    event.events = EPOLLIN;
+    event.data.fd = listen_fd_;
+    bool added = (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, listen_fd_, &event) == 0);
+    event.data.fd = wake_fd_;
+    added = added && (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, wake_fd_, &event) == 0);
+    if (!added)
+    {
+        stop();
+        return false;
+    }
+
+    handler_ = handler;
+    stopping_ = false;
+    running_ = true;
+    thread_ = std::thread(&ControlServer::run, this);
+
+    return true;
+}
+
+void ControlServer::stop()
+{
+    if (thread_.joinable())
+    {
+        stopping_ = true;
+        uint64_t value = 1;
+        if (write(wake_fd_, &value, sizeof(value)) < 0)
+        {
+            // eventfd counter saturated, the thread is woken anyway
+        }
+        thread_.join();
+    }
+    running_ = false;
+
+    for (const Client& client : clients_)
+        ::close(client.fd_);
+    clients_.clear();
+
+    if (listen_fd_ >= 0)
+        ::close(listen_fd_);
+    if (epoll_fd_ >= 0)
+        ::close(epoll_fd_);
+    if (wake_fd_ >= 0)
+        ::close(wake_fd_);
+    listen_fd_ = epoll_fd_ = wake_fd_ = -1;
+
+    if (!path_.empty())
+        unlink(path_.c_str());
+    path_.clear();
+}
+
+void ControlServer::publish(uint8_t status, uint64_t sequence, uint64_t sample_time_ns)
+{
+    if (!running_)
+        return;
+
+    ControlMessage event;
+    std::memset(&event, 0, sizeof(event));
+    event.magic = CONTROL_PROTOCOL_MAGIC;
+    event.type = static_cast<uint8_t>(ControlMessageType::EVENT);
+    event.status = status;
+    event.sequence = sequence;
+    event.sample_time_ns = sample_time_ns;
+
+    {
+        std::lock_guard<std::mutex> lock(event_mutex_);
+        if (events_.size() >= CONTROL_EVENT_QUEUE_SIZE)
+        {
+            events_.pop_front();
+            dropped_events_.fetch_add(1, std::memory_order_relaxed);
+        }
+        events_.push_back(event);
+    }
+
+    uint64_t value = 1;
+    if (write(wake_fd_, &value, sizeof(value)) < 0)
+    {
+        // eventfd counter saturated, the thread is woken anyway
+    }
+}
+
+void ControlServer::run()
+{
+    struct epoll_event events[CONTROL_MAX_CLIENTS + 2];
+
+    while (!stopping_)
+    {
+        int count = epoll_wait(epoll_fd_, events, CONTROL_MAX_CLIENTS + 2, -1);
+        if (count < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            break;
+        }
+
+        for (int i = 0; i < count; ++i)
+        {
+            int fd = events[i].data.fd;
+            if (fd == listen_fd_)
+            {
+                accept();
+            }
+            else if (fd == wake_fd_)
+            {
+                uint64_t value;
+                if (read(wake_fd_, &value, sizeof(value)) < 0)
+                {
+                    // spurious wake up, nothing to read
+                }
+                if (stopping_)
+                    break;
+                sendEvent();
+            }
+            else if (events[i].events & (EPOLLHUP | EPOLLERR))
+            {
+                disconnect(fd);
+            }
+            else
+            {
+                receive(fd);
+            }
+        }
+    }
+
+    running_ = false;
+}
+
+void ControlServer::accept()
+{
+    int fd = accept4(listen_fd_, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+    if (fd < 0)
+        return;
+
+    if (clients_.size() >= CONTROL_MAX_CLIENTS)
+    {
+        ::close(fd);
+        return;
+    }
+
+    // the socket file mode is the first barrier, the peer credentials cannot be changed by the peer
+    struct ucred credentials;
+    socklen_t length = sizeof(credentials);
+    if (getsockopt(fd, SOL_SOCKET, SO_PEERCRED, &credentials, &length) != 0 ||
+        (credentials.uid != 0 && credentials.uid != geteuid() && credentials.gid != getegid()))
+    {
+        rejected_clients_.fetch_add(1, std::memory_order_relaxed);
+        ::close(fd);
+        return;
+    }
+
+    struct epoll_event event;
+    std::memset(&event, 0, sizeof(event));
+    event.events = EPOLLIN;
+    event.data.fd = fd;
+    if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &event) != 0)
+    {
+        ::close(fd);
+        return;
+    }
+
+    clients_.push_back(Client{ fd, false });
+}
+
+void ControlServer::receive(int fd)
+{
+    ControlRequest request;
+    ssize_t size = recv(fd, &request, sizeof(request), MSG_DONTWAIT);
+    if (size == 0 || (size < 0 && errno != EAGAIN && errno != EINTR))
+    {
+        disconnect(fd);
+        return;
+    }
+    if (size < 0)
+        return;
+
+    ControlMessage response;
+    std::memset(&response, 0, sizeof(response));
+    response.magic = CONTROL_PROTOCOL_MAGIC;
+    response.type = static_cast<uint8_t>(ControlMessageType::RESPONSE);
+    response.command = request.command;
+    response.tag = request.tag;
+
+    if (size != sizeof(request) || request.magic != CONTROL_PROTOCOL_MAGIC || request.version != CONTROL_PROTOCOL_VERSION)
+    {
+        response.result = static_cast<uint8_t>(ControlResult::BAD_REQUEST);
+    }
+    else
+    {
+        switch (static_cast<ControlCommand>(request.command))
+        {
+            case ControlCommand::STATUS:
+            case ControlCommand::GRIP:
+            case ControlCommand::RELEASE:
+                handler_(request, response);
+                break;
+            case ControlCommand::SUBSCRIBE:
+            case ControlCommand::UNSUBSCRIBE:
+            {
+                for (Client& client : clients_)
+                {
+                    if (client.fd_ == fd)
+                        client.subscribed_ = (static_cast<ControlCommand>(request.command) == ControlCommand::SUBSCRIBE);
+                }
+
+                // answer with the current status, so the subscriber does not miss the state before the first event
+                ControlRequest status_request = request;
+                status_request.command = static_cast<uint8_t>(ControlCommand::STATUS);
+                handler_(status_request, response);
+                break;
+            }
+            default:
+                response.result = static_cast<uint8_t>(ControlResult::BAD_REQUEST);
+                break;
+        }
+    }
+
+    if (send(fd, &response, sizeof(response), MSG_DONTWAIT | MSG_NOSIGNAL) < 0 && errno != EAGAIN)
+    {
+        disconnect(fd);
+    }
+}
+
+void ControlServer::disconnect(int fd)
+{
+    epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, fd, NULL);
+    ::close(fd);
+
+    for (std::vector<Client>::iterator it = clients_.begin(); it != clients_.end(); ++it)
+    {
+        if (it->fd_ == fd)
+        {
+            clients_.erase(it);
+            break;
+        }
+    }
+}
+
+void ControlServer::sendEvent()
+{
+    std::deque<ControlMessage> events;
+    {
+        std::lock_guard<std::mutex> lock(event_mutex_);
+        events.swap(events_);
+    }
+
+    // never block the server on a slow subscriber, drop the event for it instead
+    for (const ControlMessage& event : events)
+    {
+        for (const Client& client : clients_)
+        {
+            if (client.subscribed_ && send(client.fd_, &event, sizeof(event), MSG_DONTWAIT | MSG_NOSIGNAL) < 0)
+            {
+                dropped_events_.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+    }
+}
+
+
+ControlClient::ControlClient() : fd_(-1), tag_(0) {}
+
+ControlClient::~ControlClient()
+{
+    close();
+}
+
+bool ControlClient::connect(const std::string& path)
+{
+    close();
+
+    struct sockaddr_un address;
+    if (!makeAddress(path, address))
+        return false;
+
+    fd_ = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+    if (fd_ < 0)
+        return false;
+
+    if (::connect(fd_, reinterpret_cast<struct sockaddr*>(&address), sizeof(address)) != 0)
+    {
+        close();
+        return false;
+    }
+
+    return true;
+}
+
+void ControlClient::close()
+{
+    if (fd_ >= 0)
+        ::close(fd_);
+    fd_ = -1;
+}
+
+bool ControlClient::call(ControlCommand command, ControlMessage& response)
+{
+    if (fd_ < 0)
+        return false;
+
+    ControlRequest request;
+    std::memset(&request, 0, sizeof(request));
+    request.magic = CONTROL_PROTOCOL_MAGIC;
+    request.version = CONTROL_PROTOCOL_VERSION;
+    request.command = static_cast<uint8_t>(command);
+    request.tag = ++tag_;
+
+    if (send(fd_, &request, sizeof(request), MSG_NOSIGNAL) != sizeof(request))
+        return false;
+
+    while (true)
+    {
+        ssize_t size = recv(fd_, &response, sizeof(response), 0);
+        if (size < 0 && errno == EINTR)
+            continue;
+        if (size != sizeof(response))
+            return false;
+        if (response.type == static_cast<uint8_t>(ControlMessageType::RESPONSE) && response.tag == request.tag)
+            return true;
+    }
+}
+
+bool ControlClient::waitEvent(ControlMessage& event, int timeout_ms)
+{
+    if (fd_ < 0)
+        return false;
+
+    while (true)
+    {
+        struct pollfd poll_fd = { fd_, POLLIN, 0 };
+        int ready = poll(&poll_fd, 1, timeout_ms);
+        if (ready < 0 && errno == EINTR)
+            continue;
+        if (ready <= 0)
+            return false;
+
+        ssize_t size = recv(fd_, &event, sizeof(event), 0);
+        if (size != sizeof(event))
+            return false;
+        if (event.type == static_cast<uint8_t>(ControlMessageType::EVENT))
+            return true;
+    }
+}
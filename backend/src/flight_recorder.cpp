@@ -0,0 +1,162 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2023, KR Soft s.r.o.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the Kassow Robots nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#include "weiss_gripkit/flight_recorder.h"
+
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace kswx_weiss_gripkit;
+
+
+bool FlightRecorder::open(const std::string& path, uint32_t capacity)
+{
+    close();
+
+    if (capacity == 0)
+        return false;
+
+    size_t size = sizeof(FlightRecorderHeader) + static_cast<size_t>(capacity) * sizeof(FlightRecord);
+
+    int fd = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+    if (fd < 0)
+        return false;
+
+    struct stat file_stat;
+    if (fstat(fd, &file_stat) != 0)
+    {
+        ::close(fd);
+        return false;
+    }
+
+    bool reuse = (static_cast<size_t>(file_stat.st_size) == size);
+    if (!reuse && ftruncate(fd, size) != 0)
+    {
+        ::close(fd);
+        return false;
+    }
+
+    // populate the mapping now, so that record() never page faults into the kernel
+    void* address = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, 0);
+    ::close(fd);
+    if (address == MAP_FAILED)
+        return false;
+
+    FlightRecorderHeader* header = static_cast<FlightRecorderHeader*>(address);
+    if (!reuse || header->magic != FLIGHT_RECORDER_MAGIC || header->version != FLIGHT_RECORDER_VERSION
+        || header->record_size != sizeof(FlightRecord) || header->capacity != capacity)
+    {
+        memset(address, 0, size);
+        header->magic = FLIGHT_RECORDER_MAGIC;
+        header->version = FLIGHT_RECORDER_VERSION;
+        header->record_size = sizeof(FlightRecord);
+        header->capacity = capacity;
+        header->write_index.store(0);
+    }
+
+    records_ = reinterpret_cast<FlightRecord*>(header + 1);
+    capacity_ = capacity;
+    size_ = size;
+    header_ = header;
+
+    return true;
+}
+
+void FlightRecorder::close()
+{
+    if (header_)
+    {
+        munmap(header_, size_);
+        header_ = nullptr;
+        records_ = nullptr;
+        capacity_ = 0;
+        size_ = 0;
+    }
+}
+
+bool FlightRecorder::read(const std::string& path, std::vector<FlightRecord>& records)
+{
+    records.clear();
+
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        return false;
+
+    struct stat file_stat;
+    if (fstat(fd, &file_stat) != 0 || static_cast<size_t>(file_stat.st_size) < sizeof(FlightRecorderHeader))
+    {
+        ::close(fd);
+        return false;
+    }
+
+    size_t size = file_stat.st_size;
+    void* address = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (address == MAP_FAILED)
+        return false;
+
+    const FlightRecorderHeader* header = static_cast<const FlightRecorderHeader*>(address);
+    if (header->magic != FLIGHT_RECORDER_MAGIC || header->version != FLIGHT_RECORDER_VERSION || header->record_size != sizeof(FlightRecord)
+        || size < sizeof(FlightRecorderHeader) + static_cast<size_t>(header->capacity) * sizeof(FlightRecord))
+    {
+        munmap(address, size);
+        return false;
+    }
+
+    const FlightRecord* slots = reinterpret_cast<const FlightRecord*>(header + 1);
+    uint64_t capacity = header->capacity;
+    uint64_t end = header->write_index.load(std::memory_order_acquire);
+    uint64_t begin = (end > capacity) ? end - capacity : 0;
+
+    records.reserve(end - begin);
+    for (uint64_t index = begin; index < end; ++index)
+    {
+        const FlightRecord* slot = &slots[index % capacity];
+        uint32_t sequence = reinterpret_cast<const std::atomic<uint32_t>*>(&slot->sequence)->load(std::memory_order_acquire);
+        FlightRecord record = *slot;
+        std::atomic_thread_fence(std::memory_order_acquire);
+
+        // skip records overwritten or being written by the recorder while reading
+        if (sequence != static_cast<uint32_t>(index + 1) || reinterpret_cast<const std::atomic<uint32_t>*>(&slot->sequence)->load(std::memory_order_relaxed) != sequence)
+            continue;
+
+        records.push_back(record);
+    }
+
+    munmap(address, size);
+    return true;
+}
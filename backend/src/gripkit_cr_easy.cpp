@@ -36,10 +36,49 @@
 #include "weiss_gripkit/logging.h"
 
 #include <kr2_program_api/api_v1/bundles/arg_provider_xml.h>
-#include <kr2_program_api/api_v1/cbun/xmlrpc/xmlrpc_server.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
 
 using namespace kswx_weiss_gripkit;
 
+
+namespace {
+
+    /// @brief XML-RPC method executed by RpcService, answers without calling the handler if the service is busy.
+    class ServicedMethod : public kr2_xmlrpc::Method {
+    public:
+
+        ServicedMethod(boost::shared_ptr<kr2_xmlrpc::Method> method, RpcService* service, int id, bool int_result, bool long_running)
+        : method_(method), service_(service), id_(id), int_result_(int_result), long_running_(long_running)
+        {}
+
+        kr2_xmlrpc::Value execute(const kr2_xmlrpc::Params& a_params) {
+            boost::shared_ptr<kr2_xmlrpc::Method> method = method_;
+            kr2_xmlrpc::Value result = kr2_xmlrpc::Value::Int(-1);
+            RpcOutcome outcome = service_->call<kr2_xmlrpc::Value>(id_, [&method, &a_params]() { return method->execute(a_params); }, result,
+                long_running_);
+            if (outcome == RpcOutcome::OK || int_result_)
+                return result;
+
+            std::map<std::string, kr2_xmlrpc::Value> values;
+            values.emplace("success", kr2_xmlrpc::Value::Int(0));
+            values.emplace("error", kr2_xmlrpc::Value::String(toString(outcome)));
+            return kr2_xmlrpc::Value::Struct(values);
+        }
+
+    private:
+        boost::shared_ptr<kr2_xmlrpc::Method> method_;
+        RpcService* service_;
+        int id_;
+        bool int_result_;
+        bool long_running_;
+    };
+
+} // namespace
+
 // The class has to be registered, otherwise the robot user will not be able
 // to create an instance of the device (ie. he would not be able to Apply it).
 REGISTER_CLASS(kswx_weiss_gripkit::GripkitCrEasy)
@@ -47,29 +86,49 @@ REGISTER_CLASS(kswx_weiss_gripkit::GripkitCrEasy)
 GripkitCrEasy::GripkitCrEasy(boost::shared_ptr<kr2_program_api::ProgramInterface> a_api,
                                        const boost::property_tree::ptree &a_xml_bundle_node)
 :   kr2_bundle_api::CustomDevice(a_api, a_xml_bundle_node),
+    toolload_writer_(0),
+    payload_writer_(PAYLOAD_COALESCE_TICKS),
     activated_(false),
     mounted_(false),
     shm_load_(SHM_GLOBAL_ID + std::string(".load")), 
+    shm_payload_(SHM_GLOBAL_ID + std::string(".payload")),
+    shm_macro_(SHM_GLOBAL_ID + std::string(".macro")),
+    shm_lease_(SHM_GLOBAL_ID + std::string(".lease")),
     shm_status_(SHM_GLOBAL_ID + std::string(".status")),
+    shm_status_event_(SHM_GLOBAL_ID + std::string(".status_event")),
     shm_action_(SHM_GLOBAL_ID + std::string(".action")),
     shm_request_id_(SHM_GLOBAL_ID + std::string(".request_increment")),
-    value_monitor_(
-        [this]() { return getStatus(); },
-        [this] (GripkitCrEasyStatus newStatus) { onStatusChange(newStatus); },
-        [this] (GripkitCrEasyStatus newStatus) { onTick(newStatus); }, 10
-        )
+    shm_stroke_(SHM_GLOBAL_ID + std::string(".stroke")),
+    shm_signal_(SHM_GLOBAL_ID + std::string(".signal")),
+    shm_profile_(SHM_GLOBAL_ID + std::string(".profile")),
+    robot_generation_(0),
+    keep_powered_(false),
+    power_off_pending_(false),
+    lease_keeper_running_(false),
+    last_sample_(),
+    metrics_(),
+    metrics_previous_sample_ns_(0),
+    monitor_tick_(),
+    status_view_data_(),
+    cycle_sync_(MonotonicClockSource(), StatusProbe{ this }, MONITOR_PERIOD_MS, CONTROLLER_IO_CYCLE_US),
+    value_monitor_(StatusMonitorPolicy{ this }, StatusMonitorWait{ &cycle_sync_ })
 {
     // load system's variables for tool load and payload 
     toolload_ = api_->variables_->allocSystemLoad("toolload", kr2rc_api::Load::SysId::LOAD_TOOL);
     payload_ = api_->variables_->allocSystemLoad("payload", kr2rc_api::Load::SysId::LOAD_PAYLOAD);
+    toolload_writer_.setVariable(toolload_);
+    payload_writer_.setVariable(payload_);
 
     // register methods so they can be called from the master thread
     REGISTER_RPC(&GripkitCrEasy::grip, this, ARG_BOOL(0), ARG_LOAD_OPT(1))
     REGISTER_RPC(&GripkitCrEasy::release, this, ARG_BOOL(0))
+    REGISTER_RPC(&GripkitCrEasy::registerPayload, this, ARG_NUMBER(0), ARG_LOAD(1))
+    REGISTER_RPC(&GripkitCrEasy::gripPayload, this, ARG_BOOL(0), ARG_NUMBER(1))
+    REGISTER_RPC(&GripkitCrEasy::runMacro, this, ARG_NUMBER(0), ARG_NUMBER(1))
+    REGISTER_RPC(&GripkitCrEasy::acquireGripper, this, ARG_NUMBER(0), ARG_NUMBER(1))
+    REGISTER_RPC(&GripkitCrEasy::releaseGripper, this)
 
 
-    kr2_xmlrpc::XmlRpcServer server;
-
     class SetGripperMethod : public kr2_xmlrpc::Method {
     public:
 
@@ -86,13 +145,14 @@ GripkitCrEasy::GripkitCrEasy(boost::shared_ptr<kr2_program_api::ProgramInterface
             {
                 if (device_->activated_)
                 {
+                    // operator request, overrides a lease of a sequence
                     if (a_params.getBool(0))
                     {
-                        device_->grip(false, boost::optional<kr2_program_api::Load>(NULL));
+                        device_->performActionCommon(GripkitAction::GRIP, false, boost::optional<kr2_program_api::Load>(NULL), PAYLOAD_SLOT_INLINE, NULL, true);
                     }
                     else
                     {
-                        device_->release(false);
+                        device_->performActionCommon(GripkitAction::RELEASE, false, NO_LOAD, PAYLOAD_SLOT_INLINE, NULL, true);
                     }
                     return kr2_xmlrpc::Value::Int(1);
                 }
@@ -109,7 +169,29 @@ GripkitCrEasy::GripkitCrEasy(boost::shared_ptr<kr2_program_api::ProgramInterface
         
         
     };
-    server.addMethod("setGripper", boost::shared_ptr<SetGripperMethod>(new SetGripperMethod(this)));
+    addRpcMethod("setGripper", boost::shared_ptr<SetGripperMethod>(new SetGripperMethod(this)), true);
+
+    class SetGripperBlockingMethod : public kr2_xmlrpc::Method {
+    public:
+
+        GripkitCrEasy* device_;
+
+        SetGripperBlockingMethod(GripkitCrEasy* device)
+        : device_(device)
+        {}
+
+        kr2_xmlrpc::Value execute(const kr2_xmlrpc::Params& a_params) {
+            LOG_INFO("RPC/Settings gripper and waiting to: " << (a_params.getBool(0) ? "grip" : "release"));
+
+            if (!device_->activated_)
+                return kr2_xmlrpc::Value::Int(0);
+
+            GripkitAction action = a_params.getBool(0) ? GripkitAction::GRIP : GripkitAction::RELEASE;
+            CBUN_PCALL result = device_->performActionCommon(action, true, NO_LOAD, PAYLOAD_SLOT_INLINE, NULL, true);
+            return kr2_xmlrpc::Value::Int((result.result_ == kr2_program_api::CmdResult<>::OK) ? 1 : -1);
+        }
+    };
+    addRpcMethod("setGripperBlocking", boost::shared_ptr<SetGripperBlockingMethod>(new SetGripperBlockingMethod(this)), true, true);
 
     class GetStatusMethod : public kr2_xmlrpc::Method {
     public:
@@ -126,10 +208,20 @@ GripkitCrEasy::GripkitCrEasy(boost::shared_ptr<kr2_program_api::ProgramInterface
             {                
                 GripkitCrEasyStatus status;
                 if (device_->activated_)
-                    status = device_->getStatusSharedMemory();
+                {
+                    StatusQuery query = device_->queryStatusSharedMemory();
+                    if (!query.ok())
+                    {
+                        values.emplace("success", kr2_xmlrpc::Value::Int(0));
+                        return kr2_xmlrpc::Value::Struct(values);
+                    }
+                    status = query.status_;
+                }
                 else
                     status = GripkitCrEasyStatus::IDLE_OR_ERROR;
 
+                // numbering of the original XML-RPC interface used by the dashboard, not the enum order returned by
+                // gripAndGetStatus, getState and waitForStatus
                 int status_int;
                 if (status == GripkitCrEasyStatus::IDLE_OR_ERROR)
                     status_int = 0;
@@ -156,9 +248,309 @@ GripkitCrEasy::GripkitCrEasy(boost::shared_ptr<kr2_program_api::ProgramInterface
         
         
     };
-    server.addMethod("getStatus", boost::shared_ptr<GetStatusMethod>(new GetStatusMethod(this)));
+    addRpcMethod("getStatus", boost::shared_ptr<GetStatusMethod>(new GetStatusMethod(this)), false);
+
+    class GetLoadCountersMethod : public kr2_xmlrpc::Method {
+    public:
+
+        GripkitCrEasy* device_;
+
+        GetLoadCountersMethod(GripkitCrEasy* device)
+        : device_(device)
+        {}
+
+        kr2_xmlrpc::Value execute(const kr2_xmlrpc::Params& a_params) {
+            std::map<std::string, kr2_xmlrpc::Value> values;
+            values.emplace("success", kr2_xmlrpc::Value::Int(1));
+            values.emplace("toolload_writes", kr2_xmlrpc::Value::Int(saturatingInt(device_->toolload_writer_.writes())));
+            values.emplace("toolload_skipped", kr2_xmlrpc::Value::Int(saturatingInt(device_->toolload_writer_.skipped())));
+            values.emplace("payload_writes", kr2_xmlrpc::Value::Int(saturatingInt(device_->payload_writer_.writes())));
+            values.emplace("payload_skipped", kr2_xmlrpc::Value::Int(saturatingInt(device_->payload_writer_.skipped())));
+            values.emplace("payload_coalesced", kr2_xmlrpc::Value::Int(saturatingInt(device_->payload_writer_.coalesced())));
+            return kr2_xmlrpc::Value::Struct(values);
+        }
+    };
+    addRpcMethod("getLoadCounters", boost::shared_ptr<GetLoadCountersMethod>(new GetLoadCountersMethod(this)), false);
+
+    class GetStrokeStatsMethod : public kr2_xmlrpc::Method {
+    public:
+
+        GripkitCrEasy* device_;
+
+        GetStrokeStatsMethod(GripkitCrEasy* device)
+        : device_(device)
+        {}
+
+        kr2_xmlrpc::Value strokeStats(GripkitAction action, GripkitCrEasyStatus final_status) {
+            StrokeStats stats = device_->monitor_tick_.strokeModel().stats(action, final_status);
+            std::map<std::string, kr2_xmlrpc::Value> values;
+            values.emplace("count", kr2_xmlrpc::Value::Int(saturatingInt(stats.count_)));
+            values.emplace("mean_ms", kr2_xmlrpc::Value::Double(stats.mean()));
+            values.emplace("stddev_ms", kr2_xmlrpc::Value::Double(std::sqrt(stats.variance())));
+            values.emplace("p50_ms", kr2_xmlrpc::Value::Double(stats.percentile(50)));
+            values.emplace("p90_ms", kr2_xmlrpc::Value::Double(stats.percentile(90)));
+            values.emplace("p99_ms", kr2_xmlrpc::Value::Double(stats.percentile(99)));
+            values.emplace("deadline_ms", kr2_xmlrpc::Value::Int(saturatingInt(stats.deadlineMs())));
+            return kr2_xmlrpc::Value::Struct(values);
+        }
+
+        kr2_xmlrpc::Value execute(const kr2_xmlrpc::Params& a_params) {
+            std::map<std::string, kr2_xmlrpc::Value> values;
+            values.emplace("success", kr2_xmlrpc::Value::Int(1));
+            StrokeDeadlines deadlines = device_->monitor_tick_.strokeModel().deadlines();
+            values.emplace("grip", strokeStats(GripkitAction::GRIP, GripkitCrEasyStatus::HOLDING));
+            values.emplace("grip_no_part", strokeStats(GripkitAction::GRIP, GripkitCrEasyStatus::NO_PART));
+            values.emplace("release", strokeStats(GripkitAction::RELEASE, GripkitCrEasyStatus::RELEASED));
+            values.emplace("grip_deadline_ms", kr2_xmlrpc::Value::Int(saturatingInt(deadlines.grip_ms_)));
+            values.emplace("release_deadline_ms", kr2_xmlrpc::Value::Int(saturatingInt(deadlines.release_ms_)));
+            return kr2_xmlrpc::Value::Struct(values);
+        }
+    };
+    addRpcMethod("getStrokeStats", boost::shared_ptr<GetStrokeStatsMethod>(new GetStrokeStatsMethod(this)), false);
+
+    class GetSignalHealthMethod : public kr2_xmlrpc::Method {
+    public:
+
+        GripkitCrEasy* device_;
+
+        GetSignalHealthMethod(GripkitCrEasy* device)
+        : device_(device)
+        {}
+
+        kr2_xmlrpc::Value pinHealth(const PinHealth& pin) {
+            std::map<std::string, kr2_xmlrpc::Value> values;
+            values.emplace("samples", kr2_xmlrpc::Value::Int(saturatingInt(pin.samples_)));
+            values.emplace("missing", kr2_xmlrpc::Value::Int(saturatingInt(pin.missing_)));
+            values.emplace("ewma", kr2_xmlrpc::Value::Double(pin.ewma_));
+            values.emplace("stddev", kr2_xmlrpc::Value::Double(std::sqrt(pin.ewm_variance_)));
+            values.emplace("min", kr2_xmlrpc::Value::Double(pin.min_));
+            values.emplace("max", kr2_xmlrpc::Value::Double(pin.max_));
+            values.emplace("near_threshold_samples", kr2_xmlrpc::Value::Int(saturatingInt(pin.near_threshold_samples_)));
+            values.emplace("near_threshold_s", kr2_xmlrpc::Value::Double(pin.near_threshold_ns_ * 1e-9));
+            return kr2_xmlrpc::Value::Struct(values);
+        }
+
+        kr2_xmlrpc::Value execute(const kr2_xmlrpc::Params& a_params) {
+            std::map<std::string, kr2_xmlrpc::Value> values;
+            SynchronizedData<SignalHealth>* shm_signal_sync = device_->shm_signal_.getData();
+            if (!shm_signal_sync)
+            {
+                values.emplace("success", kr2_xmlrpc::Value::Int(0));
+                return kr2_xmlrpc::Value::Struct(values);
+            }
+
+            SignalHealth health = shm_signal_sync->get();
+            values.emplace("success", kr2_xmlrpc::Value::Int(1));
+            values.emplace("gripped", pinHealth(health.gripped_));
+            values.emplace("no_error", pinHealth(health.no_error_));
+            return kr2_xmlrpc::Value::Struct(values);
+        }
+    };
+    addRpcMethod("getSignalHealth", boost::shared_ptr<GetSignalHealthMethod>(new GetSignalHealthMethod(this)), false);
+
+    class GetCycleSyncMethod : public kr2_xmlrpc::Method {
+    public:
+
+        GripkitCrEasy* device_;
+
+        GetCycleSyncMethod(GripkitCrEasy* device)
+        : device_(device)
+        {}
+
+        kr2_xmlrpc::Value execute(const kr2_xmlrpc::Params& a_params) {
+            CycleSyncStats stats = device_->cycle_sync_.stats();
+
+            std::map<std::string, kr2_xmlrpc::Value> values;
+            values.emplace("enabled", kr2_xmlrpc::Value::Int(device_->cycle_sync_.enabled() ? 1 : 0));
+            values.emplace("locked", kr2_xmlrpc::Value::Int(stats.locked_ ? 1 : 0));
+            values.emplace("stopped", kr2_xmlrpc::Value::Int(stats.stopped_ ? 1 : 0));
+            values.emplace("measured_cycle_us", kr2_xmlrpc::Value::Double(stats.measured_cycle_ns_ * 1e-3));
+            values.emplace("acquisitions", kr2_xmlrpc::Value::Int(saturatingInt(stats.acquisitions_)));
+            values.emplace("failures", kr2_xmlrpc::Value::Int(saturatingInt(stats.failures_)));
+            values.emplace("probes", kr2_xmlrpc::Value::Int(saturatingInt(stats.probes_)));
+            return kr2_xmlrpc::Value::Struct(values);
+        }
+    };
+    addRpcMethod("getCycleSync", boost::shared_ptr<GetCycleSyncMethod>(new GetCycleSyncMethod(this)), false);
+
+    class SetCycleSyncMethod : public kr2_xmlrpc::Method {
+    public:
+
+        GripkitCrEasy* device_;
+
+        SetCycleSyncMethod(GripkitCrEasy* device)
+        : device_(device)
+        {}
+
+        kr2_xmlrpc::Value execute(const kr2_xmlrpc::Params& a_params) {
+            LOG_INFO("RPC/Setting cycle synchronized sampling to: " << (a_params.getBool(0) ? "on" : "off"));
+            device_->cycle_sync_.setEnabled(a_params.getBool(0));
+            return kr2_xmlrpc::Value::Int(1);
+        }
+    };
+    addRpcMethod("setCycleSync", boost::shared_ptr<SetCycleSyncMethod>(new SetCycleSyncMethod(this)), true);
+
+    class GetProfileMethod : public kr2_xmlrpc::Method {
+    public:
+
+        GripkitCrEasy* device_;
+
+        GetProfileMethod(GripkitCrEasy* device)
+        : device_(device)
+        {}
+
+        kr2_xmlrpc::Value execute(const kr2_xmlrpc::Params& a_params) {
+            std::map<std::string, kr2_xmlrpc::Value> values;
+            ProfileData* profile = device_->shm_profile_.getData();
+            if (!profile)
+            {
+                // built without WEISS_GRIPKIT_PROFILE
+                values.emplace("success", kr2_xmlrpc::Value::Int(0));
+                return kr2_xmlrpc::Value::Struct(values);
+            }
+
+            values.emplace("success", kr2_xmlrpc::Value::Int(1));
+            for (int i = 0; i < static_cast<int>(ProfileStage::COUNT); ++i)
+            {
+                const StageHistogram& histogram = profile->stages_[i];
+                std::map<std::string, kr2_xmlrpc::Value> stage;
+                stage.emplace("count", kr2_xmlrpc::Value::Int(saturatingInt(histogram.count())));
+                stage.emplace("mean_us", kr2_xmlrpc::Value::Double(histogram.meanNs() * 1e-3));
+                stage.emplace("p50_us", kr2_xmlrpc::Value::Double(histogram.percentileNs(50) * 1e-3));
+                stage.emplace("p99_us", kr2_xmlrpc::Value::Double(histogram.percentileNs(99) * 1e-3));
+                stage.emplace("max_us", kr2_xmlrpc::Value::Double(histogram.maxNs() * 1e-3));
+                values.emplace(toString(static_cast<ProfileStage>(i)), kr2_xmlrpc::Value::Struct(stage));
+            }
+            return kr2_xmlrpc::Value::Struct(values);
+        }
+    };
+    addRpcMethod("getProfile", boost::shared_ptr<GetProfileMethod>(new GetProfileMethod(this)), false);
+
+    class DefineMacroMethod : public kr2_xmlrpc::Method {
+    public:
+
+        GripkitCrEasy* device_;
+
+        DefineMacroMethod(GripkitCrEasy* device)
+        : device_(device)
+        {}
+
+        kr2_xmlrpc::Value execute(const kr2_xmlrpc::Params& a_params) {
+            std::map<std::string, kr2_xmlrpc::Value> values;
+            int slot = a_params.getInt(0);
+            MacroProgram program;
+            std::string error;
+            MacroShared* macro = device_->shm_macro_.getData();
+
+            if (!MacroShared::isSlot(slot))
+                error = "invalid macro slot";
+            else if (!macro)
+                error = "shared memory not initialized";
+            else if (parseMacro(a_params.getString(1), program, error))
+                macro->define(slot, program);
+
+            LOG_INFO("RPC/Define macro " << slot << ": " << (error.empty() ? formatMacro(program) : error));
+            values.emplace("success", kr2_xmlrpc::Value::Int(error.empty() ? 1 : 0));
+            values.emplace("error", kr2_xmlrpc::Value::String(error));
+            values.emplace("macro", kr2_xmlrpc::Value::String(error.empty() ? formatMacro(program) : std::string()));
+            return kr2_xmlrpc::Value::Struct(values);
+        }
+    };
+    addRpcMethod("defineMacro", boost::shared_ptr<DefineMacroMethod>(new DefineMacroMethod(this)), false);
+
+    class GetRpcStatsMethod : public kr2_xmlrpc::Method {
+    public:
+
+        GripkitCrEasy* device_;
+
+        GetRpcStatsMethod(GripkitCrEasy* device)
+        : device_(device)
+        {}
+
+        kr2_xmlrpc::Value execute(const kr2_xmlrpc::Params& a_params) {
+            std::map<std::string, kr2_xmlrpc::Value> values;
+            values.emplace("success", kr2_xmlrpc::Value::Int(1));
+            for (const RpcMethodStats& stats : device_->rpc_service_.stats())
+            {
+                std::map<std::string, kr2_xmlrpc::Value> method;
+                method.emplace("calls", kr2_xmlrpc::Value::Int(saturatingInt(stats.calls_)));
+                method.emplace("failures", kr2_xmlrpc::Value::Int(saturatingInt(stats.failures_)));
+                method.emplace("busy", kr2_xmlrpc::Value::Int(saturatingInt(stats.busy_)));
+                method.emplace("mean_ms", kr2_xmlrpc::Value::Double(stats.latency_.count_ ? stats.latency_.sum_ / stats.latency_.count_ * 1e3 : 0.0));
+                method.emplace("p50_ms", kr2_xmlrpc::Value::Double(stats.percentileS(50) * 1e3));
+                method.emplace("p99_ms", kr2_xmlrpc::Value::Double(stats.percentileS(99) * 1e3));
+                method.emplace("max_ms", kr2_xmlrpc::Value::Double(stats.max_s_ * 1e3));
+                std::vector<kr2_xmlrpc::Value> buckets;
+                for (int i = 0; i <= RPC_LATENCY_BUCKETS; ++i)
+                    buckets.push_back(kr2_xmlrpc::Value::Int(saturatingInt(stats.latency_.buckets_[i])));
+                method.emplace("buckets", kr2_xmlrpc::Value::Array(buckets));
+                values.emplace(stats.name_, kr2_xmlrpc::Value::Struct(method));
+            }
+            return kr2_xmlrpc::Value::Struct(values);
+        }
+    };
+    addRpcMethod("getRpcStats", boost::shared_ptr<GetRpcStatsMethod>(new GetRpcStatsMethod(this)), false);
+
+    class GetLeaseStatsMethod : public kr2_xmlrpc::Method {
+    public:
+
+        GripkitCrEasy* device_;
+
+        GetLeaseStatsMethod(GripkitCrEasy* device)
+        : device_(device)
+        {}
+
+        kr2_xmlrpc::Value execute(const kr2_xmlrpc::Params& a_params) {
+            std::map<std::string, kr2_xmlrpc::Value> values;
+            GripperLease* lease = device_->shm_lease_.getData();
+            if (!lease)
+            {
+                values.emplace("success", kr2_xmlrpc::Value::Int(0));
+                return kr2_xmlrpc::Value::Struct(values);
+            }
+
+            LeaseHolder holder = lease->holder();
+            LeaseStats stats = lease->stats();
+            values.emplace("success", kr2_xmlrpc::Value::Int(1));
+            values.emplace("owner_pid", kr2_xmlrpc::Value::Int(static_cast<int>(holder.owner_pid_)));
+            values.emplace("owner_priority", kr2_xmlrpc::Value::Int(holder.priority_));
+            values.emplace("remaining_ms", kr2_xmlrpc::Value::Double(holder.remaining_ns_ * 1e-6));
+            values.emplace("waiters", kr2_xmlrpc::Value::Int(holder.waiters_));
+            values.emplace("granted", kr2_xmlrpc::Value::Int(saturatingInt(stats.granted_)));
+            values.emplace("immediate", kr2_xmlrpc::Value::Int(saturatingInt(stats.immediate_)));
+            values.emplace("timeouts", kr2_xmlrpc::Value::Int(saturatingInt(stats.timeouts_)));
+            values.emplace("full", kr2_xmlrpc::Value::Int(saturatingInt(stats.full_)));
+            values.emplace("rejected", kr2_xmlrpc::Value::Int(saturatingInt(stats.rejected_)));
+            values.emplace("overrides", kr2_xmlrpc::Value::Int(saturatingInt(stats.overrides_)));
+            values.emplace("expired", kr2_xmlrpc::Value::Int(saturatingInt(stats.expired_)));
+            values.emplace("mean_wait_ms", kr2_xmlrpc::Value::Double(stats.wait_.count_ ? stats.wait_.sum_ / stats.wait_.count_ * 1e3 : 0.0));
+            values.emplace("max_wait_ms", kr2_xmlrpc::Value::Double(stats.max_wait_ns_ * 1e-6));
+            std::vector<kr2_xmlrpc::Value> buckets;
+            for (int i = 0; i <= LEASE_WAIT_BUCKETS; ++i)
+                buckets.push_back(kr2_xmlrpc::Value::Int(saturatingInt(stats.wait_.buckets_[i])));
+            values.emplace("wait_buckets", kr2_xmlrpc::Value::Array(buckets));
+            return kr2_xmlrpc::Value::Struct(values);
+        }
+    };
+    addRpcMethod("getLeaseStats", boost::shared_ptr<GetLeaseStatsMethod>(new GetLeaseStatsMethod(this)), false);
+}
+
+
+void GripkitCrEasy::addRpcMethod(const std::string& name, boost::shared_ptr<kr2_xmlrpc::Method> method, bool int_result, bool long_running)
+{
+    int id = rpc_service_.addMethod(name);
+    xmlrpc_server_.addMethod(name, boost::shared_ptr<ServicedMethod>(new ServicedMethod(method, &rpc_service_, id, int_result, long_running)));
 }
 
+GripkitCrEasy::~GripkitCrEasy()
+{
+    stopLeaseKeeper();
+
+    if (cancelPowerOff())
+    {
+        powerOff();
+    }
+}
 
 int GripkitCrEasy::onCreate()
 {
@@ -166,15 +558,62 @@ int GripkitCrEasy::onCreate()
     
     // create shared memory objects for interprocess communication
     shm_load_.create();
+    shm_payload_.create();
+    shm_macro_.create();
+    shm_lease_.create();
     shm_status_.create();
+    shm_status_event_.create();
     shm_action_.create();
     shm_request_id_.create();
+    shm_stroke_.create();
+    shm_signal_.create();
+#ifdef WEISS_GRIPKIT_PROFILE
+    shm_profile_.create();
+#endif
     
     SynchronizedData<GripkitAction>* shm_action_sync = shm_action_.getData();
     if (shm_action_sync)
     {
         shm_action_sync->set(GripkitAction::NONE);
     }
+
+    // load stroke times learned before restart and share the deadlines
+    if (monitor_tick_.strokeModel().load(STROKE_MODEL_FILE))
+    {
+        SynchronizedData<StrokeDeadlines>* shm_stroke_sync = shm_stroke_.getData();
+        if (shm_stroke_sync)
+        {
+            shm_stroke_sync->set(monitor_tick_.strokeModel().deadlines());
+        }
+    }
+
+    // open flight recorder, the gripper works without it
+    if (!flight_recorder_.open(FLIGHT_RECORDER_FILE, FLIGHT_RECORDER_CAPACITY))
+    {
+        LOG_ERR("Unable to open flight recorder file " << FLIGHT_RECORDER_FILE);
+    }
+
+    // publish status snapshots for external processes, the gripper works without it
+    if (!status_view_.create())
+    {
+        LOG_ERR("Unable to create status view " << STATUS_VIEW_NAME);
+    }
+
+#ifdef WEISS_GRIPKIT_METRICS
+    // export counters and latencies for scraping, the gripper works without it
+    if (!metrics_exporter_.start(&metrics_buffer_, METRICS_TEXTFILE, METRICS_SOCKET_FILE))
+    {
+        LOG_ERR("Unable to start metrics exporter on " << METRICS_SOCKET_FILE);
+    }
+#endif
+
+#ifdef WEISS_GRIPKIT_CONTROL_CHANNEL
+    // serve the binary control channel, XML-RPC and program calls work without it
+    if (!control_server_.start(CONTROL_SOCKET_FILE, [this](const ControlRequest& request, ControlMessage& response) { handleControlRequest(request, response); }))
+    {
+        LOG_ERR("Unable to start control channel on " << CONTROL_SOCKET_FILE);
+    }
+#endif
     
     return 0;
 }
@@ -183,22 +622,43 @@ int GripkitCrEasy::onDestroy()
 {
     onDeactivate();
 
+    // the CBun goes away, do not leave the gripper powered
+    if (cancelPowerOff())
+    {
+        powerOff();
+    }
+
+    control_server_.stop();
+    metrics_exporter_.stop();
+    status_view_.destroy();
+
     // destroy shared memory objects
     shm_load_.destroy();
+    shm_payload_.destroy();
+    shm_macro_.destroy();
+    shm_lease_.destroy();
     shm_status_.destroy();
+    shm_status_event_.destroy();
     shm_action_.destroy();
     shm_request_id_.destroy();
+    shm_stroke_.destroy();
+    shm_signal_.destroy();
+#ifdef WEISS_GRIPKIT_PROFILE
+    shm_profile_.destroy();
+#endif
 
     return 0;
 }
 
 int GripkitCrEasy::onBind()
 {
-    // attach to shared memory objects for interprocess communication
-    shm_load_.attach();
-    shm_status_.attach();
-    shm_action_.attach();
-    shm_request_id_.attach();
+    // attach to shared memory objects for interprocess communication, waits until the master instance has published them;
+    // a segment that is still missing is retried by getData on use
+    if (!shm_load_.attach() || !shm_payload_.attach() || !shm_macro_.attach() || !shm_lease_.attach() || !shm_status_.attach() ||
+        !shm_status_event_.attach() || !shm_action_.attach() || !shm_request_id_.attach() || !shm_stroke_.attach() || !shm_signal_.attach())
+    {
+        LOG_ERR("Shared memory not ready after " << SHM_ATTACH_TIMEOUT_MS << " ms, is the CBun created?");
+    }
 
     // Program will only launch if CBun is activated, thus we know CBun is activated in onBind
     activated_ = true;
@@ -210,6 +670,9 @@ int GripkitCrEasy::onUnbind()
 {
     activated_ = false;
 
+    // the sequence ended, hand the gripper over at once
+    releaseGripper();
+
     return 0;
 }
 
@@ -252,6 +715,7 @@ bool GripkitCrEasy::setDigitalOutput(kr2rc_api::DUID gpio_id, bool state, unsign
     std::array<kr2rc_api::IOData::GPIOInt64,1> digital_io {{ gpio_id, (state ? 1 : 0), config}};
 
     kr2rc_api::IOData::CmdTXGPIOParams params;
+    PROFILE_SCOPE(shm_profile_.getData(), ProfileStage::SET_OUTPUT)
     kr2rc_api::CmdResult result = api_->rc_api_->iob_data_->cmd_TX_GPIO(params, nullptr, 0, digital_io.data(), digital_io.size(), nullptr, 0);
 
     if (result.err_code_ != 0)
@@ -263,35 +727,80 @@ bool GripkitCrEasy::setDigitalOutput(kr2rc_api::DUID gpio_id, bool state, unsign
 
 CBUN_PCALL GripkitCrEasy::onActivate(const boost::property_tree::ptree &a_param_tree)
 {    
+    // take over outputs left asserted by a recent deactivation
+    int previous_generation = robot_generation_;
+    auto previous_setup = gpio_setup_;
+    bool outputs_asserted = cancelPowerOff();
 
     // process activation params
     if (!processActivationParams(a_param_tree)) {
         LOG_ERR("Invalid activation params");
+        if (outputs_asserted)
+        {
+            gpio_setup_ = previous_setup;
+            powerOff();
+        }
         CBUN_PCALL_RET_ERROR(-1, "Invalid activation parameters.");
     }
 
-    // enable power output and set to true
-    if (!setDigitalOutput(gpio_setup_.duid_out_power_, true, gpio_setup_.config_enabled_))
+    if (outputs_asserted && robot_generation_ != previous_generation)
     {
-        LOG_ERR("Unable to set digital output for power (VCC) to true.");
-        CBUN_PCALL_RET_ERROR(-1, "Unable to enable power supply.");
+        // outputs of the previous setup stay asserted otherwise
+        auto new_setup = gpio_setup_;
+        gpio_setup_ = previous_setup;
+        powerOff();
+        gpio_setup_ = new_setup;
+        outputs_asserted = false;
     }
 
-    // enable activation pin and set to true
-    if (!setDigitalOutput(gpio_setup_.duid_out_activation_, true, gpio_setup_.config_enabled_))
+    // warm activation: the gripper is still powered and reports a healthy status, keep power and the grip state of a held part
+    GripkitCrEasyStatus live_status = outputs_asserted ? getStatus() : GripkitCrEasyStatus::STATUS_ERROR;
+    bool warm = (live_status == GripkitCrEasyStatus::RELEASED || live_status == GripkitCrEasyStatus::HOLDING || live_status == GripkitCrEasyStatus::NO_PART);
+
+    if (warm)
     {
-        LOG_ERR("Unable to set digital output for activation (IN0) to true.");
-        CBUN_PCALL_RET_ERROR(-1, "Unable to activate device.");
-    }
+        LOG_INFO("Warm activation, gripper status: " << toString(live_status));
 
-    // enable grip pin and set to false
-    if (!setDigitalOutput(gpio_setup_.duid_out_grip_, false, gpio_setup_.config_enabled_))
+        // publish the live status right away, blocking calls work before the first monitor tick
+        monitor_tick_.publish(shm_status_.getData(), live_status, last_sample_.monotonic_ns_);
+    }
+    else
     {
-        LOG_ERR("Unable to set digital output for grip (IN1) to false.");
-        CBUN_PCALL_RET_ERROR(-1, "Unable to activate device.");
+        // power cycle a gripper left powered in a fault state
+        if (outputs_asserted)
+        {
+            LOG_INFO("Gripper powered but not healthy (" << toString(live_status) << "), power cycling.");
+            powerOff();
+            usleep(1000 * POWER_CYCLE_OFF_MS);
+        }
+
+        // enable power output and set to true
+        if (!setDigitalOutput(gpio_setup_.duid_out_power_, true, gpio_setup_.config_enabled_))
+        {
+            LOG_ERR("Unable to set digital output for power (VCC) to true.");
+            CBUN_PCALL_RET_ERROR(-1, "Unable to enable power supply.");
+        }
+
+        // enable activation pin and set to true
+        if (!setDigitalOutput(gpio_setup_.duid_out_activation_, true, gpio_setup_.config_enabled_))
+        {
+            LOG_ERR("Unable to set digital output for activation (IN0) to true.");
+            CBUN_PCALL_RET_ERROR(-1, "Unable to activate device.");
+        }
+
+        // enable grip pin and set to false
+        if (!setDigitalOutput(gpio_setup_.duid_out_grip_, false, gpio_setup_.config_enabled_))
+        {
+            LOG_ERR("Unable to set digital output for grip (IN1) to false.");
+            CBUN_PCALL_RET_ERROR(-1, "Unable to activate device.");
+        }
     }
 
-    // start status monitoring thread
+    // start status monitoring thread with fresh signal statistics, acquire the controller cycle again
+    monitor_tick_.reset();
+    macro_runner_ = MacroRunner();
+    metrics_previous_sample_ns_ = 0;
+    cycle_sync_.reset();
     if (!value_monitor_.start(500))
     {
         LOG_ERR("Unable to start monitor thread.");
@@ -305,14 +814,52 @@ CBUN_PCALL GripkitCrEasy::onActivate(const boost::property_tree::ptree &a_param_
 
 CBUN_PCALL GripkitCrEasy::onDeactivate()
 {    
+    bool was_activated = activated_;
     activated_ = false;
+    cancelPowerOff();
 
     // stop status monitoring thread
-    if (!value_monitor_.stop(500))
+    bool monitor_stopped = value_monitor_.stop(500);
+    if (!monitor_stopped)
     {
         LOG_ERR("Unable to stop monitor thread.");
     }
+    else
+    {
+        if (!monitor_tick_.strokeModel().save(STROKE_MODEL_FILE))
+        {
+            LOG_ERR("Unable to save stroke model to " << STROKE_MODEL_FILE);
+        }
+
+        // mark status stale, so that readers fail fast instead of waiting for the heartbeat to age
+        SynchronizedData<PublishedStatus>* status = shm_status_.getData();
+        if (status)
+        {
+            PublishedStatus published = status->get();
+            published.heartbeat_ns_ = 0;
+            status->set(published);
+        }
+
+        status_view_data_.heartbeat_ns = 0;
+        status_view_.write(status_view_data_);
+    }
+
+    // on request keep a healthy gripper powered for a while, so that a re-activation does not power cycle it or drop a held part
+    GripkitCrEasyStatus live_status = (keep_powered_ && was_activated && monitor_stopped) ? getStatus() : GripkitCrEasyStatus::STATUS_ERROR;
+    if (live_status == GripkitCrEasyStatus::RELEASED || live_status == GripkitCrEasyStatus::HOLDING || live_status == GripkitCrEasyStatus::NO_PART)
+    {
+        schedulePowerOff();
+    }
+    else
+    {
+        powerOff();
+    }
+    
+    CBUN_PCALL_RET_OK;
+}
 
+void GripkitCrEasy::powerOff()
+{
     // disable grip pin and set to false
     if (!setDigitalOutput(gpio_setup_.duid_out_grip_, false, gpio_setup_.config_disabled_))
     {
@@ -330,57 +877,287 @@ CBUN_PCALL GripkitCrEasy::onDeactivate()
     {
         LOG_ERR("Unable to set digital output for power (VCC) to false.");
     }
-    
-    CBUN_PCALL_RET_OK;
 }
 
-void GripkitCrEasy::onStatusChange(GripkitCrEasyStatus newStatus)
+void GripkitCrEasy::schedulePowerOff()
 {
-    // set payload no none if gripper is released or detected no part
-    if (newStatus == GripkitCrEasyStatus::NO_PART || newStatus == GripkitCrEasyStatus::RELEASED)
+    cancelPowerOff();
+
     {
-        *payload_ = NO_LOAD;
+        std::lock_guard<std::mutex> lock(power_off_mutex_);
+        power_off_pending_ = true;
     }
 
-    // set payload to load from shared memory if gripper started holding a part
-    if (newStatus == GripkitCrEasyStatus::HOLDING)
-    {
-        SynchronizedData<LoadData>* shm_load_sync = shm_load_.getData();
-        if (shm_load_sync)
-        {
-            *payload_ = shm_load_sync->get().toLoad();
-        }
-        else
+    power_off_thread_ = std::thread([this]() {
+        std::unique_lock<std::mutex> lock(power_off_mutex_);
+        if (!power_off_cv_.wait_for(lock, std::chrono::milliseconds(POWER_OFF_DELAY_MS), [this]() { return !power_off_pending_; }))
         {
-            LOG_ERR("shm_load_sync not initialized");
+            power_off_pending_ = false;
+            lock.unlock();
+            powerOff();
         }
-    }
+    });
 }
 
-void GripkitCrEasy::onTick(GripkitCrEasyStatus newStatus)
+bool GripkitCrEasy::cancelPowerOff()
 {
-    // update status in shared memory
-    SynchronizedData<GripkitCrEasyStatus>* status = shm_status_.getData(); 
-    if (status) 
+    bool was_pending;
     {
-        status->set(newStatus);
+        std::lock_guard<std::mutex> lock(power_off_mutex_);
+        was_pending = power_off_pending_;
+        power_off_pending_ = false;
     }
+    power_off_cv_.notify_all();
 
-    // read from shared memory and perform requested action: grip/release
-    SynchronizedData<GripkitAction>* shm_action_sync = shm_action_.getData();
-    if (shm_action_sync)
-    {
-        GripkitAction requestedAction = shm_action_sync->exchange(GripkitAction::NONE);
-        if (requestedAction == GripkitAction::GRIP || requestedAction == GripkitAction::RELEASE)
-        {
-            if (!setDigitalOutput(gpio_setup_.duid_out_grip_, requestedAction == GripkitAction::GRIP, gpio_setup_.config_enabled_))
+    if (power_off_thread_.joinable())
+        power_off_thread_.join();
+
+    return was_pending;
+}
+
+GripkitAction GripkitCrEasy::MonitorTickPolicy::pickAction(GripkitCrEasyStatus status, GripkitAction requested)
+{
+    // run macro steps, a macro action is processed like a requested one
+    GripkitAction macro_action = device_->tickMacro(status, requested);
+    return (macro_action != GripkitAction::NONE) ? macro_action : requested;
+}
+
+void GripkitCrEasy::MonitorTickPolicy::applyAction(GripkitAction action)
+{
+    if (!device_->setDigitalOutput(device_->gpio_setup_.duid_out_grip_, action == GripkitAction::GRIP, device_->gpio_setup_.config_enabled_))
+    {
+        LOG_ERR("Unable to set digital output for grip (IN1) to " << ((action == GripkitAction::GRIP) ? "true." : "false."));
+    }
+}
+
+GripkitAction GripkitCrEasy::tickMacro(GripkitCrEasyStatus status, GripkitAction requested_action)
+{
+    MacroShared* macro = shm_macro_.getData();
+    if (!macro)
+    {
+        return GripkitAction::NONE;
+    }
+
+    // a grip/release request or a new macro takes over the gripper
+    MacroRequest request = macro->request_.exchange(MacroRequest{ 0, 0 });
+    bool was_running = macro_runner_.isRunning();
+    if (requested_action != GripkitAction::NONE || request.run_ != 0)
+    {
+        macro_runner_.interrupt();
+    }
+
+    if (request.run_ != 0)
+    {
+        if (was_running)
+        {
+            macro->result_.set(MacroResult{ macro_runner_.run(), MacroState::INTERRUPTED, static_cast<uint8_t>(macro_runner_.step()), macro_runner_.ticks() });
+        }
+
+        MacroProgram program;
+        if (requested_action == GripkitAction::NONE && macro->get(request.slot_, program))
+        {
+            macro_runner_.start(program, request.run_, last_sample_.monotonic_ns_);
+            was_running = true;
+        }
+        else
+        {
+            macro->result_.set(MacroResult{ request.run_, requested_action == GripkitAction::NONE ? MacroState::FAILED : MacroState::INTERRUPTED, 0, 0 });
+            was_running = false;
+        }
+    }
+
+    if (!was_running)
+    {
+        return GripkitAction::NONE;
+    }
+
+    GripkitAction action = GripkitAction::NONE;
+    MacroState state = macro_runner_.tick(status, last_sample_.monotonic_ns_, action);
+    if (state != MacroState::RUNNING)
+    {
+        macro->result_.set(MacroResult{ macro_runner_.run(), state, static_cast<uint8_t>(macro_runner_.step()), macro_runner_.ticks() });
+    }
+    return action;
+}
+
+int GripkitCrEasy::subscribeStatus(StatusObserver* observer, unsigned int event_mask)
+{
+    return status_events_.subscribe(observer, event_mask);
+}
+
+bool GripkitCrEasy::unsubscribeStatus(int subscription_id)
+{
+    return status_events_.unsubscribe(subscription_id);
+}
+
+void GripkitCrEasy::onStatusChange(GripkitCrEasyStatus newStatus)
+{
+    // onTick already published this sample, the event carries its sequence number
+    control_server_.publish(static_cast<uint8_t>(newStatus), monitor_tick_.sequence(), last_sample_.monotonic_ns_);
+
+    // wake sequences sleeping in waitForStatus
+    SharedEventCount* status_event = shm_status_event_.getData();
+    if (status_event)
+    {
+        status_event->notify();
+    }
+
+    // set payload no none if gripper is released or detected no part
+    if (newStatus == GripkitCrEasyStatus::NO_PART || newStatus == GripkitCrEasyStatus::RELEASED)
+    {
+        payload_writer_.request(payload_cache_.noLoad());
+    }
+
+    // set payload selected by the last grip if gripper started holding a part
+    if (newStatus == GripkitCrEasyStatus::HOLDING)
+    {
+        PayloadTable* payload_table = shm_payload_.getData();
+        int slot = payload_table ? payload_table->selected() : PAYLOAD_SLOT_INLINE;
+        if (slot != PAYLOAD_SLOT_INLINE)
+        {
+            // registered payload, converted when it was registered
+            payload_cache_.refresh(*payload_table);
+            payload_writer_.request(payload_cache_.get(slot));
+        }
+        else
+        {
+            SynchronizedData<LoadData>* shm_load_sync = shm_load_.getData();
+            if (shm_load_sync)
+            {
+                payload_writer_.request(shm_load_sync->get());
+            }
+            else
             {
-                LOG_ERR("Unable to set digital output for grip (IN1) to " << ((requestedAction == GripkitAction::GRIP) ? "true." : "false."));
+                LOG_ERR("shm_load_sync not initialized");
             }
         }
     }
 }
 
+void GripkitCrEasy::onTick(GripkitCrEasyStatus newStatus)
+{
+    PROFILE_SCOPE(shm_profile_.getData(), ProfileStage::TICK)
+    uint64_t tick_start_ns = monotonicNowNs();
+
+    // publish the status, apply the requested or macro action, learn stroke times and publish signal health, the daemon tool runs the same tick
+    MonitorSegments segments = { shm_status_.getData(), shm_action_.getData(), shm_stroke_.getData(), shm_signal_.getData(), shm_profile_.getData() };
+    MonitorTickPolicy policy{ this };
+    GripkitAction requestedAction = GripkitAction::NONE;
+    unsigned int events = monitor_tick_.run(newStatus, last_sample_, segments, status_events_, policy, requestedAction);
+
+    // advance the payload coalescing window
+    payload_writer_.tick();
+
+    // record the tick and publish it to external readers
+    uint64_t request_id = 0;
+    if (flight_recorder_.isOpen() || status_view_.isOpen())
+    {
+        SynchronizedIncrement* shm_request_id_sync = shm_request_id_.getData();
+        PROFILE_SCOPE(shm_profile_.getData(), ProfileStage::SHM_REQUEST_ID)
+        request_id = shm_request_id_sync ? shm_request_id_sync->get() : 0;
+    }
+
+    if (flight_recorder_.isOpen())
+    {
+        FlightRecord record;
+        record.timestamp_ns = last_sample_.timestamp_ns_;
+        record.request_id = request_id;
+        record.gripped_voltage = last_sample_.gripped_voltage_;
+        record.no_error_voltage = last_sample_.no_error_voltage_;
+        record.status = static_cast<uint8_t>(newStatus);
+        record.action = static_cast<uint8_t>(requestedAction);
+        flight_recorder_.record(record);
+    }
+
+    if (status_view_.isOpen())
+    {
+        if (status_view_data_.sequence > 0 && status_view_data_.status != static_cast<uint8_t>(newStatus))
+            ++status_view_data_.status_changes;
+        if (requestedAction == GripkitAction::GRIP)
+            ++status_view_data_.grip_count;
+        if (requestedAction == GripkitAction::RELEASE)
+            ++status_view_data_.release_count;
+
+        status_view_data_.sequence = monitor_tick_.sequence();
+        status_view_data_.sample_time_ns = last_sample_.monotonic_ns_;
+        status_view_data_.timestamp_ns = last_sample_.timestamp_ns_;
+        status_view_data_.heartbeat_ns = monotonicNowNs();
+        status_view_data_.request_id = request_id;
+        status_view_data_.gripped_voltage = last_sample_.gripped_voltage_;
+        status_view_data_.no_error_voltage = last_sample_.no_error_voltage_;
+        status_view_data_.status = static_cast<uint8_t>(newStatus);
+        status_view_data_.action = static_cast<uint8_t>(requestedAction);
+        status_view_.write(status_view_data_);
+    }
+
+    updateMetrics(newStatus, requestedAction, events, tick_start_ns);
+}
+
+void GripkitCrEasy::updateMetrics(GripkitCrEasyStatus status, GripkitAction picked_action, unsigned int events, uint64_t tick_start_ns)
+{
+    ++metrics_.ticks_;
+    if (picked_action == GripkitAction::GRIP)
+        ++metrics_.grip_actions_;
+    if (picked_action == GripkitAction::RELEASE)
+        ++metrics_.release_actions_;
+
+    if (status == GripkitCrEasyStatus::IDLE_OR_ERROR || status == GripkitCrEasyStatus::STATUS_ERROR)
+        ++metrics_.error_ticks_;
+    if (events & static_cast<unsigned int>(StatusEventType::FAULT))
+        ++metrics_.faults_;
+    if ((events & static_cast<unsigned int>(StatusEventType::STATUS_CHANGED)) && status == GripkitCrEasyStatus::HOLDING)
+        ++metrics_.holding_;
+    if ((events & static_cast<unsigned int>(StatusEventType::STATUS_CHANGED)) && status == GripkitCrEasyStatus::NO_PART)
+        ++metrics_.no_part_;
+
+    if (events & static_cast<unsigned int>(StatusEventType::ACTION_COMPLETED))
+    {
+        const ActionCompletion& completion = monitor_tick_.lastCompletion();
+        if (completion.result_ == ActionResult::DONE)
+        {
+            ++metrics_.actions_done_;
+            double latency_s = completion.duration_ns_ * 1e-9;
+            StrokeDeadlines deadlines = monitor_tick_.strokeModel().deadlines();
+            uint64_t deadline_ms = (completion.action_ == GripkitAction::GRIP) ? deadlines.grip_ms_ : deadlines.release_ms_;
+            if (deadline_ms > 0 && completion.duration_ns_ > deadline_ms * 1000000ULL)
+                ++metrics_.stroke_deadline_misses_;
+
+            if (completion.action_ == GripkitAction::GRIP)
+                metrics_.grip_latency_.add(latency_s, METRICS_ACTION_BOUNDS_S);
+            else
+                metrics_.release_latency_.add(latency_s, METRICS_ACTION_BOUNDS_S);
+        }
+        else if (completion.result_ == ActionResult::FAILED)
+        {
+            ++metrics_.actions_failed_;
+        }
+        else
+        {
+            ++metrics_.actions_interrupted_;
+        }
+    }
+
+    // a tick sampled much later than one period after the previous one missed its deadline
+    if (metrics_previous_sample_ns_ > 0 && last_sample_.monotonic_ns_ - metrics_previous_sample_ns_ > METRICS_OVERRUN_FACTOR * MONITOR_PERIOD_MS * 1e6)
+        ++metrics_.monitor_overruns_;
+    metrics_previous_sample_ns_ = last_sample_.monotonic_ns_;
+
+    uint64_t now_ns = monotonicNowNs();
+    metrics_.tick_duration_.add((now_ns - tick_start_ns) * 1e-9, METRICS_TICK_BOUNDS_S);
+
+    if (metrics_.ticks_ % METRICS_PUBLISH_TICKS == 0)
+    {
+        metrics_.timestamp_ns_ = last_sample_.timestamp_ns_;
+        metrics_.activated_ = activated_ ? 1 : 0;
+        metrics_.status_ = static_cast<uint8_t>(status);
+        metrics_.payload_writes_ = payload_writer_.writes();
+        metrics_.payload_skipped_ = payload_writer_.skipped();
+        metrics_.payload_coalesced_ = payload_writer_.coalesced();
+        metrics_.event_drops_ = status_events_.droppedEvents();
+        metrics_buffer_.publish(metrics_);
+    }
+}
+
 CBUN_PCALL GripkitCrEasy::onMount(const boost::property_tree::ptree &a_param_tree)
 {
     // get load from parameters
@@ -388,7 +1165,7 @@ CBUN_PCALL GripkitCrEasy::onMount(const boost::property_tree::ptree &a_param_tre
     kr2_program_api::Load load = arg_provider.getLoad(0);
 
     // set the system tool load
-    *toolload_ = load;
+    toolload_writer_.write(LoadData(load));
 
     mounted_ = true;
     
@@ -397,14 +1174,15 @@ CBUN_PCALL GripkitCrEasy::onMount(const boost::property_tree::ptree &a_param_tre
 
 CBUN_PCALL GripkitCrEasy::onUnmount()
 {
-    *toolload_ = NO_LOAD;
+    toolload_writer_.write(LoadData(NO_LOAD));
 
     mounted_ = false;
     
     CBUN_PCALL_RET_OK;
 }
 
-CBUN_PCALL GripkitCrEasy::performActionCommon(GripkitAction action, bool blocking, boost::optional<kr2_program_api::Load> payload)
+CBUN_PCALL GripkitCrEasy::performActionCommon(GripkitAction action, bool blocking, boost::optional<kr2_program_api::Load> payload, int payload_slot,
+    GripkitCrEasyStatus* final_status, bool operator_request)
 {
     // check activation
     if (!activated_)
@@ -413,95 +1191,64 @@ CBUN_PCALL GripkitCrEasy::performActionCommon(GripkitAction action, bool blockin
         CBUN_PCALL_RET_ERROR(-1, "CBun not activated. Activate CBun.");
     }
 
-    // set requested load to shared memory for action==GRIP
+    if (!admitRequest(operator_request))
+    {
+        CBUN_PCALL_RET_ERROR(-1, "Gripper leased by another sequence.");
+    }
+
+    // select payload for action==GRIP, a registered slot or the requested load in shared memory
     if (action == GripkitAction::GRIP)
     {
+        PayloadTable* payload_table = shm_payload_.getData();
         SynchronizedData<LoadData>* shm_load_sync = shm_load_.getData();
-        if (shm_load_sync)
+        if (!payload_table || !shm_load_sync)
+        {
+            LOG_ERR("shm_payload or shm_load_sync not initialized");
+            CBUN_PCALL_RET_EXCEPTION(-1, "Internal error");
+        }
+
+        if (payload_slot == PAYLOAD_SLOT_INLINE)
         {
             if (payload && payload->valid())
                 shm_load_sync->set(LoadData(*payload));
             else
                 shm_load_sync->set(LoadData(NO_LOAD));
         }
-        else
-        {
-            LOG_ERR("shm_load_sync not initialized");
-            CBUN_PCALL_RET_EXCEPTION(-1, "Internal error");
-        }
-    }
-
-    // get request number and notify other processes of a new request (interrupt running blocking calls)
-    uint64_t request_number;
-    SynchronizedIncrement* shm_request_id_sync = shm_request_id_.getData();
-    if (shm_request_id_sync)
-    {
-        request_number = shm_request_id_sync->increment();
-    }
-    else
-    {
-        LOG_ERR("shm_request_id_sync not initialized");
-        CBUN_PCALL_RET_EXCEPTION(-1, "Internal error");
+        payload_table->select(payload_slot);
     }
 
-    // request action
-    SynchronizedData<GripkitAction>* shm_action_sync = shm_action_.getData();
-    if (shm_action_sync)
-    {
-        shm_action_sync->set(action);
-    }
-    else
+    // get request number, notify other processes of a new request (interrupt running blocking calls) and request action
+    ActionChannel channel{ shm_action_.getData(), shm_request_id_.getData(), shm_status_.getData(), shm_stroke_.getData() };
+    uint64_t request_number = submitAction(channel, action);
+    if (request_number == 0)
     {
-        LOG_ERR("shm_action_sync not initialized");
+        LOG_ERR("shm_request_id_sync or shm_action_sync not initialized");
         CBUN_PCALL_RET_EXCEPTION(-1, "Internal error");
     }
     
     // wait for finish if blocking
     if (blocking)
     {
-        int error_count = 0;
-        while (true)
+        ActionWaitInfo info;
+        switch (waitForAction(channel, action, request_number, US_SLEEP_GRIP_RELEASE, info))
         {
-            // stop blocking call if a new request came from another process
-            if (request_number != shm_request_id_sync->get())
-                CBUN_PCALL_RET_OK;
-
-            // keep checking status until the move is finished
-            SynchronizedData<GripkitCrEasyStatus>* shm_status_sync = shm_status_.getData();
-            if (!shm_status_sync)
-            {
+            case ActionOutcome::DONE:
+            case ActionOutcome::INTERRUPTED:
+                if (final_status)
+                    *final_status = info.status_;
+                break;
+            case ActionOutcome::NOT_INITIALIZED:
                 LOG_ERR("shm_status_sync not initialized.");
                 CBUN_PCALL_RET_EXCEPTION(-1, "Bad status");
-            }
-            else
-            {
-                GripkitCrEasyStatus status = shm_status_sync->get();
-                if (action == GripkitAction::GRIP && (status == GripkitCrEasyStatus::HOLDING || status == GripkitCrEasyStatus::NO_PART))
-                {
-                    CBUN_PCALL_RET_OK;
-                }
-                else if (action == GripkitAction::RELEASE && status == GripkitCrEasyStatus::RELEASED)
-                {
-                    CBUN_PCALL_RET_OK;
-                }
-                else if (status == GripkitCrEasyStatus::IDLE_OR_ERROR || status == GripkitCrEasyStatus::STATUS_ERROR)
-                {
-                    // return exception only if the error status repeats several times
-                    // gripper sometimes returns error for a few short moments when switching from RELEASED to NO_PART
-                    ++error_count;
-                    LOG_INFO("Status error on grip, count: " << error_count);
-                    if (error_count >= MIN_CONTINUOUS_ERROR_COUNT)
-                    {
-                        LOG_ERR("Status error on grip, repeated too many times")
-                        CBUN_PCALL_RET_EXCEPTION(-1, "Bad status");
-                    }
-                }
-                else
-                {
-                    error_count = 0;
-                }
-            }
-            usleep(US_SLEEP_GRIP_RELEASE);
+            case ActionOutcome::STROKE_TIMEOUT:
+                LOG_ERR("Stroke not finished within adaptive deadline of " << info.deadline_ms_ << " ms");
+                CBUN_PCALL_RET_EXCEPTION(-1, "Stroke timeout");
+            case ActionOutcome::STALE:
+                LOG_ERR("Status monitor not running, status age: " << info.status_age_ns_ / 1000000 << " ms");
+                CBUN_PCALL_RET_EXCEPTION(-1, "Status monitor not running");
+            case ActionOutcome::BAD_STATUS:
+                LOG_ERR("Status error on " << toString(action) << ", repeated " << info.error_count_ << " times")
+                CBUN_PCALL_RET_EXCEPTION(-1, "Bad status");
         }
     }
 
@@ -518,81 +1265,423 @@ CBUN_PCALL GripkitCrEasy::release(bool blocking)
     return performActionCommon(GripkitAction::RELEASE, blocking, NO_LOAD);
 }
 
-GripkitCrEasyStatus GripkitCrEasy::getStatus()
+CBUN_PCALL GripkitCrEasy::registerPayload(kr2_program_api::Number slot, kr2_program_api::Load payload)
+{
+    int slot_id = PAYLOAD_SLOT_NONE;
+    if (!toInteger(slot.d(), 1, PAYLOAD_SLOT_COUNT, slot_id))
+    {
+        LOG_ERR("Invalid payload slot " << slot.d());
+        CBUN_PCALL_RET_ERROR(-1, "Invalid payload slot.");
+    }
+
+    PayloadTable* payload_table = shm_payload_.getData();
+    if (!payload_table)
+    {
+        LOG_ERR("shm_payload not initialized");
+        CBUN_PCALL_RET_EXCEPTION(-1, "Internal error");
+    }
+
+    payload_table->define(slot_id, payload.valid() ? LoadData(payload) : LoadData(NO_LOAD));
+
+    CBUN_PCALL_RET_OK;
+}
+
+CBUN_PCALL GripkitCrEasy::gripPayload(bool blocking, kr2_program_api::Number slot)
 {
-    int gripped = -1;
-    int no_error = -1;
+    PayloadTable* payload_table = shm_payload_.getData();
+    if (!payload_table)
+    {
+        LOG_ERR("shm_payload not initialized");
+        CBUN_PCALL_RET_EXCEPTION(-1, "Internal error");
+    }
+
+    int slot_id = PAYLOAD_SLOT_NONE;
+    if (!toInteger(slot.d(), PAYLOAD_SLOT_NONE, PAYLOAD_SLOT_COUNT, slot_id) || !payload_table->isDefined(slot_id))
+    {
+        LOG_ERR("Payload slot " << slot.d() << " not registered");
+        CBUN_PCALL_RET_ERROR(-1, "Payload slot not registered.");
+    }
 
+    return performActionCommon(GripkitAction::GRIP, blocking, boost::none, slot_id);
+}
+
+GripkitCrEasyStatus GripkitCrEasy::getStatus()
+{
     // prepare values to be read
-    api_->rc_api_->spin();
+    {
+        PROFILE_SCOPE(shm_profile_.getData(), ProfileStage::SPIN)
+        api_->rc_api_->spin();
+    }
 
     // read values
-    int gpio_float_count = api_->rc_api_->iob_data_->read_N_GPIOFloat();
-    for (int i = 0; i < gpio_float_count; ++i)
+    last_sample_.timestamp_ns_ = FlightRecorder::now();
+    last_sample_.monotonic_ns_ = monotonicNowNs();
     {
-        const kr2rc_api::IOData::GPIOFloat* data = api_->rc_api_->iob_data_->read_GPIOFloat(i);
-        
-        if (data)
+        PROFILE_SCOPE(shm_profile_.getData(), ProfileStage::READ_INPUTS)
+        readSample(*api_->rc_api_->iob_data_, gpio_setup_.duid_in_gripped_, gpio_setup_.duid_in_no_error_, last_sample_);
+    }
+
+    // if values not found, return error
+    GripkitCrEasyStatus status = decodeStatus(last_sample_);
+    if (status == GripkitCrEasyStatus::STATUS_ERROR)
+    {
+        LOG_ERR("Invalid status, gripped: " << last_sample_.gripped_voltage_ << " no_error: " << last_sample_.no_error_voltage_)
+    }
+
+    return status;
+}
+
+void GripkitCrEasy::handleControlRequest(const ControlRequest& request, ControlMessage& response)
+{
+    ControlCommand command = static_cast<ControlCommand>(request.command);
+    if (command == ControlCommand::GRIP || command == ControlCommand::RELEASE)
+    {
+        if (!activated_)
+        {
+            response.result = static_cast<uint8_t>(ControlResult::NOT_ACTIVATED);
+            return;
+        }
+
+        GripkitAction action = (command == ControlCommand::GRIP) ? GripkitAction::GRIP : GripkitAction::RELEASE;
+        CBUN_PCALL result = performActionCommon(action, false, NO_LOAD, PAYLOAD_SLOT_INLINE, NULL, true);
+        if (result.result_ != kr2_program_api::CmdResult<>::OK)
+        {
+            response.result = static_cast<uint8_t>(ControlResult::FAILED);
+            return;
+        }
+    }
+
+    // answer every accepted request with the current status
+    StatusQuery query = queryStatusSharedMemory();
+    response.status = static_cast<uint8_t>(query.status_);
+    response.sequence = query.sequence_;
+    if (query.ok())
+        response.result = static_cast<uint8_t>(ControlResult::OK);
+    else if (query.error_ == StatusQuery::Error::STALE)
+        response.result = static_cast<uint8_t>(ControlResult::STALE);
+    else
+        response.result = static_cast<uint8_t>(ControlResult::FAILED);
+}
+
+uint64_t GripkitCrEasy::probeIOFrame()
+{
+    api_->rc_api_->spin();
+
+    GripkitSample sample;
+    readSample(*api_->rc_api_->iob_data_, gpio_setup_.duid_in_gripped_, gpio_setup_.duid_in_no_error_, sample);
+
+    // raw bits; steady inputs that do not change every cycle make acquisition fail, CycleSync then stops retrying
+    uint32_t gripped_bits, no_error_bits;
+    std::memcpy(&gripped_bits, &sample.gripped_voltage_, sizeof(gripped_bits));
+    std::memcpy(&no_error_bits, &sample.no_error_voltage_, sizeof(no_error_bits));
+    return (static_cast<uint64_t>(gripped_bits) << 32) | no_error_bits;
+}
+
+StatusQuery GripkitCrEasy::queryStatusSharedMemory()
+{
+    return queryStatus(shm_status_.getData(), monotonicNowNs());
+}
+
+GripkitCrEasyStatus GripkitCrEasy::getStatusSharedMemory()
+{
+    StatusQuery query = queryStatusSharedMemory();
+    checkStatusAvailable(query);
+    if (query.error_ == StatusQuery::Error::READ_ERROR)
+    {
+        LOG_ERR("Status could not be read.")
+        throw GripkitException("Internal error.");
+    }
+    return query.status_;
+}
+
+void GripkitCrEasy::checkStatusAvailable(const StatusQuery& query)
+{
+    if (query.error_ == StatusQuery::Error::NOT_INITIALIZED)
+    {
+        LOG_ERR("shm_status_sync not initialized.");
+        throw GripkitException("Internal error.");
+    }
+    else if (query.error_ == StatusQuery::Error::STALE)
+    {
+        LOG_ERR("Status monitor not running, status age: " << query.age_ns_ / 1000000 << " ms");
+        throw GripkitException("Status monitor not running.");
+    }
+}
+
+CBUN_PCALL GripkitCrEasy::runMacro(kr2_program_api::Number macro, kr2_program_api::Number payload)
+{
+    // check activation
+    if (!activated_)
+    {
+        LOG_ERR("CBun not activated.");
+        CBUN_PCALL_RET_ERROR(-1, "CBun not activated. Activate CBun.");
+    }
+
+    MacroShared* macro_shared = shm_macro_.getData();
+    PayloadTable* payload_table = shm_payload_.getData();
+    SynchronizedIncrement* shm_request_id_sync = shm_request_id_.getData();
+    if (!macro_shared || !payload_table || !shm_request_id_sync)
+    {
+        LOG_ERR("shm_macro, shm_payload or shm_request_id_sync not initialized");
+        CBUN_PCALL_RET_EXCEPTION(-1, "Internal error");
+    }
+
+    int macro_slot = 0;
+    MacroProgram program;
+    if (!toInteger(macro.d(), 1, MACRO_SLOT_COUNT, macro_slot) || !macro_shared->get(macro_slot, program))
+    {
+        LOG_ERR("Macro slot " << macro.d() << " not defined");
+        CBUN_PCALL_RET_ERROR(-1, "Macro not defined.");
+    }
+
+    int payload_slot = PAYLOAD_SLOT_NONE;
+    if (!toInteger(payload.d(), PAYLOAD_SLOT_NONE, PAYLOAD_SLOT_COUNT, payload_slot) || !payload_table->isDefined(payload_slot))
+    {
+        LOG_ERR("Payload slot " << payload.d() << " not registered");
+        CBUN_PCALL_RET_ERROR(-1, "Payload slot not registered.");
+    }
+
+    if (!admitRequest(false))
+    {
+        CBUN_PCALL_RET_ERROR(-1, "Gripper leased by another sequence.");
+    }
+
+    // interrupt blocking calls of other processes and request the run
+    payload_table->select(payload_slot);
+    uint64_t request_number = shm_request_id_sync->increment();
+    macro_shared->request_.set(MacroRequest{ request_number, macro_slot });
+
+    // the monitor executes the steps, wait for the result
+    while (true)
+    {
+        // stop waiting if a new request came from another process, the monitor interrupts the macro
+        if (request_number != shm_request_id_sync->get())
+        {
+            CBUN_PCALL_RET_OK;
+        }
+
+        MacroResult result = macro_shared->result_.get();
+        if (result.run_ == request_number)
         {
-            if (data->gpio_id_ == gpio_setup_.duid_in_gripped_)
+            switch (result.state_)
             {
-                gripped = (data->value_ > INPUT_HIGH_VOLTAGE) ? 1 : 0;
+                case MacroState::DONE:
+                case MacroState::INTERRUPTED:
+                    CBUN_PCALL_RET_OK;
+                case MacroState::TIMEOUT:
+                    LOG_ERR("Macro " << macro_slot << " timed out in step " << static_cast<int>(result.step_) << " after " << result.ticks_ << " ticks");
+                    CBUN_PCALL_RET_EXCEPTION(-1, "Macro timeout");
+                default:
+                    LOG_ERR("Macro " << macro_slot << " failed in step " << static_cast<int>(result.step_) << ": " << toString(result.state_));
+                    CBUN_PCALL_RET_EXCEPTION(-1, "Bad status");
             }
+        }
+
+        StatusQuery query = queryStatusSharedMemory();
+        if (query.error_ == StatusQuery::Error::STALE || query.error_ == StatusQuery::Error::NOT_INITIALIZED)
+        {
+            LOG_ERR("Status monitor not running, status age: " << query.age_ns_ / 1000000 << " ms");
+            CBUN_PCALL_RET_EXCEPTION(-1, "Status monitor not running");
+        }
+
+        usleep(US_SLEEP_GRIP_RELEASE);
+    }
+}
+
+CBUN_PCALL GripkitCrEasy::acquireGripper(kr2_program_api::Number priority, kr2_program_api::Number timeout_ms)
+{
+    GripperLease* lease = shm_lease_.getData();
+    if (!lease)
+    {
+        LOG_ERR("shm_lease not initialized");
+        CBUN_PCALL_RET_EXCEPTION(-1, "Internal error");
+    }
+
+    int lease_priority = 0;
+    uint32_t timeout = 0;
+    if (!toInteger(priority.d(), std::numeric_limits<int>::min(), std::numeric_limits<int>::max(), lease_priority) ||
+        !toInteger(timeout_ms.d(), static_cast<uint32_t>(0), static_cast<uint32_t>(LEASE_MAX_TIMEOUT_MS), timeout))
+    {
+        LOG_ERR("Invalid gripper lease priority " << priority.d() << " or timeout " << timeout_ms.d() << " ms");
+        CBUN_PCALL_RET_ERROR(-1, "Invalid lease priority or timeout.");
+    }
+
+    LeaseResult result = lease->acquire(getpid(), lease_priority, LEASE_DURATION_MS, timeout);
+    if (result != LeaseResult::GRANTED)
+    {
+        LeaseHolder holder = lease->holder();
+        LOG_ERR("Gripper lease " << toString(result) << ", held by process " << holder.owner_pid_ << " with priority " << holder.priority_
+            << ", " << holder.waiters_ << " waiting");
+        CBUN_PCALL_RET_ERROR(-1, "Gripper leased by another sequence.");
+    }
+
+    startLeaseKeeper();
 
-            if (data->gpio_id_ == gpio_setup_.duid_in_no_error_)
+    CBUN_PCALL_RET_OK;
+}
+
+CBUN_PCALL GripkitCrEasy::releaseGripper()
+{
+    stopLeaseKeeper();
+
+    GripperLease* lease = shm_lease_.getData();
+    if (lease)
+        lease->release(getpid());
+
+    CBUN_PCALL_RET_OK;
+}
+
+void GripkitCrEasy::startLeaseKeeper()
+{
+    // a keeper that stopped after losing the lease is joined and replaced
+    stopLeaseKeeper();
+
+    {
+        std::lock_guard<std::mutex> lock(lease_keeper_mutex_);
+        lease_keeper_running_ = true;
+    }
+
+    lease_keeper_thread_ = std::thread([this]() {
+        std::unique_lock<std::mutex> lock(lease_keeper_mutex_);
+        while (!lease_keeper_cv_.wait_for(lock, std::chrono::milliseconds(LEASE_RENEW_MS), [this]() { return !lease_keeper_running_; }))
+        {
+            GripperLease* lease = shm_lease_.getData();
+            if (!lease || !lease->renew(getpid(), LEASE_DURATION_MS))
             {
-                no_error = (data->value_ > INPUT_HIGH_VOLTAGE) ? 1 : 0;
+                LOG_ERR("Gripper lease lost");
+                lease_keeper_running_ = false;
             }
         }
-    }
+    });
+}
 
-    // if values not found, return error
-    if (gripped == -1 || no_error == -1)
+void GripkitCrEasy::stopLeaseKeeper()
+{
     {
-        LOG_ERR("Invalid status, gripped: " << gripped << " no_error: " << no_error)
-        return GripkitCrEasyStatus::STATUS_ERROR;
+        std::lock_guard<std::mutex> lock(lease_keeper_mutex_);
+        lease_keeper_running_ = false;
     }
+    lease_keeper_cv_.notify_all();
 
-    // return status
-    if (gripped == 1)
+    if (lease_keeper_thread_.joinable())
+        lease_keeper_thread_.join();
+}
+
+bool GripkitCrEasy::admitRequest(bool operator_request)
+{
+    GripperLease* lease = shm_lease_.getData();
+    if (!lease || lease->admit(getpid(), LEASE_DURATION_MS, operator_request))
+        return true;
+
+    LOG_ERR("Gripper leased by process " << lease->holder().owner_pid_);
+    return false;
+}
+
+kr2_program_api::Number GripkitCrEasy::actionAndGetStatus(GripkitAction action, boost::optional<kr2_program_api::Load> payload)
+{
+    if (!activated_)
     {
-        if (no_error == 1)
-            return GripkitCrEasyStatus::HOLDING;
-        else
-            return GripkitCrEasyStatus::NO_PART;
+        LOG_ERR("CBun not activated.");
+        return static_cast<long>(GripkitCrEasyStatus::IDLE_OR_ERROR);
     }
-    else
+
+    // a refused or failed action must not look like a valid grip, performActionCommon logged the reason
+    GripkitCrEasyStatus status = GripkitCrEasyStatus::STATUS_ERROR;
+    CBUN_PCALL result = performActionCommon(action, true, payload, PAYLOAD_SLOT_INLINE, &status);
+    if (result.result_ != kr2_program_api::CmdResult<>::OK)
+        return static_cast<long>(GripkitCrEasyStatus::STATUS_ERROR);
+
+    // the final status comes from the wait, the shared memory is read again only if the wait saw none
+    if (status == GripkitCrEasyStatus::STATUS_ERROR)
     {
-        if (no_error == 1)
-            return GripkitCrEasyStatus::RELEASED;
-        else
-            return GripkitCrEasyStatus::IDLE_OR_ERROR;
+        StatusQuery query = queryStatusSharedMemory();
+        status = query.ok() ? query.status_ : GripkitCrEasyStatus::STATUS_ERROR;
     }
+
+    return static_cast<long>(status);
 }
 
-GripkitCrEasyStatus GripkitCrEasy::getStatusSharedMemory()
+kr2_program_api::Number GripkitCrEasy::gripAndGetStatus(boost::optional<kr2_program_api::Load> payload)
 {
-    SynchronizedData<GripkitCrEasyStatus>* shm_status_sync = shm_status_.getData();
-    if (!shm_status_sync)
+    return actionAndGetStatus(GripkitAction::GRIP, payload);
+}
+
+kr2_program_api::Number GripkitCrEasy::releaseAndGetStatus()
+{
+    return actionAndGetStatus(GripkitAction::RELEASE, NO_LOAD);
+}
+
+kr2_program_api::Number GripkitCrEasy::getState()
+{
+    StatusQuery query = queryStatusSharedMemory();
+    GripkitCrEasyStatus status = query.ok() ? query.status_ : GripkitCrEasyStatus::STATUS_ERROR;
+    bool activated = activated_;
+
+    long state = static_cast<long>(status) & STATE_STATUS_MASK;
+    if (activated)
+        state |= STATE_ACTIVATED;
+    if (mounted_)
+        state |= STATE_MOUNTED;
+    if (query.error_ == StatusQuery::Error::STALE || query.error_ == StatusQuery::Error::NOT_INITIALIZED)
+        state |= STATE_STALE;
+    if (activated && (status == GripkitCrEasyStatus::IDLE_OR_ERROR || status == GripkitCrEasyStatus::STATUS_ERROR))
+        state |= STATE_FAULT;
+
+    return state;
+}
+
+kr2_program_api::Number GripkitCrEasy::waitForStatus(kr2_program_api::Number status_mask, kr2_program_api::Number timeout_ms)
+{
+    unsigned int mask = 0;
+    unsigned int timeout = 0;
+    if (!toInteger(status_mask.d(), 1U, static_cast<unsigned int>(WAIT_STATUS_MASK_ALL), mask) ||
+        !toInteger(timeout_ms.d(), 0U, static_cast<unsigned int>(WAIT_STATUS_MAX_TIMEOUT_MS), timeout))
     {
-        LOG_ERR("shm_status_sync not initialized.");
-        throw GripkitException("Internal error.");
+        LOG_ERR("Invalid status mask " << status_mask.d() << " or timeout " << timeout_ms.d() << " ms");
+        throw GripkitException("Invalid status mask or timeout.");
     }
-    else
+    uint64_t deadline_ns = monotonicNowNs() + timeout * 1000000ULL;
+
+    SharedEventCount* status_event = shm_status_event_.getData();
+    while (true)
     {
-        GripkitCrEasyStatus status = shm_status_sync->get();
-        if (status == GripkitCrEasyStatus::STATUS_ERROR)
+        // read the generation before the status, a transition published after the check then ends the wait at once
+        uint64_t generation = status_event ? status_event->generation() : 0;
+        StatusQuery query = queryStatusSharedMemory();
+        if (query.error_ == StatusQuery::Error::STALE || query.error_ == StatusQuery::Error::NOT_INITIALIZED)
         {
-            LOG_ERR("Status could not be read.")
-            throw GripkitException("Internal error.");
+            LOG_ERR("Status monitor not running, status age: " << query.age_ns_ / 1000000 << " ms");
+            return static_cast<long>(WAIT_STATUS_UNAVAILABLE);
+        }
+
+        GripkitCrEasyStatus status = query.ok() ? query.status_ : GripkitCrEasyStatus::STATUS_ERROR;
+        if (mask & (1U << static_cast<unsigned int>(status)))
+            return static_cast<long>(status);
+
+        uint64_t now_ns = monotonicNowNs();
+        if (now_ns >= deadline_ns)
+            return static_cast<long>(WAIT_STATUS_TIMEOUT);
+
+        // sleep until the monitor reports a transition, wake up periodically to notice a stopped monitor
+        int wait_ms = static_cast<int>(std::min<uint64_t>((deadline_ns - now_ns + 999999) / 1000000, WAIT_STATUS_CHECK_MS));
+        if (status_event)
+        {
+            status_event->waitChange(generation, wait_ms);
+        }
+        else
+        {
+            LOG_ERR("shm_status_event not initialized, polling status.");
+            usleep(std::min(wait_ms, MONITOR_PERIOD_MS) * 1000);
         }
-        return status;
     }
 }
 
 kr2_program_api::Number GripkitCrEasy::isCommon(GripkitCrEasyStatus checkedStatus)
 {
-    return (getStatusSharedMemory() == checkedStatus) ? 1L : 0L;
+    // tight polling loops stay off the exception path for status read glitches
+    StatusQuery query = queryStatusSharedMemory();
+    checkStatusAvailable(query);
+    return statusMatches(query, checkedStatus);
 }
 
 kr2_program_api::Number GripkitCrEasy::isReleased()
@@ -619,14 +1708,20 @@ bool GripkitCrEasy::processActivationParams(const boost::property_tree::ptree &t
 {
     kr2_bundle_api::ArgProviderXml arg_provider(tree);
 
-    const int EXPECTED_PARAMS = 1;
-    if (arg_provider.getArgCount() != EXPECTED_PARAMS) {
+    // keep_powered is optional, activations stored before it was added have only the robot generation
+    const int EXPECTED_PARAMS = 2;
+    if (arg_provider.getArgCount() != EXPECTED_PARAMS && arg_provider.getArgCount() != EXPECTED_PARAMS - 1) {
         LOG_ERR("Unexpected param count: actual=" << arg_provider.getArgCount() << ", expected=" << EXPECTED_PARAMS);
         return false;
     }
     
     int robot_generation = arg_provider.getInt(0);
-    return setupGPIO(robot_generation);
+    if (!setupGPIO(robot_generation))
+        return false;
+
+    robot_generation_ = robot_generation;
+    keep_powered_ = (arg_provider.getArgCount() == EXPECTED_PARAMS) && (arg_provider.getInt(1) != 0);
+    return true;
 }
 
 bool GripkitCrEasy::setupGPIO(int robot_generation)
@@ -0,0 +1,237 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2023, KR Soft s.r.o.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the Kassow Robots nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#include "weiss_gripkit/gripper_daemon.h"
+#include "weiss_gripkit/flight_recorder.h"
+#include "weiss_gripkit/metrics.h"
+
+#include <cstring>
+#include <pthread.h>
+#include <sched.h>
+#include <signal.h>
+#include <unistd.h>
+
+using namespace kswx_weiss_gripkit;
+
+
+SimulatedGripperIO::SimulatedGripperIO(const SimulatedGripper::Config& config) :
+gripper_(config), io_data_(DAEMON_SIMULATED_DUID_GRIPPED, DAEMON_SIMULATED_DUID_NO_ERROR), start_ns_(monotonicNowNs()) {}
+
+void SimulatedGripperIO::read(GripkitSample& sample)
+{
+    float gripped_voltage, no_error_voltage;
+    gripper_.sample((monotonicNowNs() - start_ns_) * 1e-9, gripped_voltage, no_error_voltage);
+    io_data_.setInputs(gripped_voltage, no_error_voltage);
+    readSample(io_data_, DAEMON_SIMULATED_DUID_GRIPPED, DAEMON_SIMULATED_DUID_NO_ERROR, sample);
+}
+
+bool SimulatedGripperIO::setGrip(bool grip)
+{
+    gripper_.setGrip(grip, (monotonicNowNs() - start_ns_) * 1e-9);
+    return true;
+}
+
+
+GripperDaemon::GripperDaemon(const DaemonConfig& config, GripperIO* io) :
+config_(config),
+io_(io),
+shm_status_(config.prefix + ".status"),
+shm_status_event_(config.prefix + ".status_event"),
+shm_action_(config.prefix + ".action"),
+shm_request_id_(config.prefix + ".request_increment"),
+shm_stroke_(config.prefix + ".stroke"),
+shm_signal_(config.prefix + ".signal"),
+shm_lease_(config.prefix + ".lease"),
+shm_daemon_(config.prefix + ".daemon"),
+thread_setup_done_(false),
+running_(false),
+monitor_(DaemonMonitorPolicy{ this }, DeadlineSleepWait(config.period_ms))
+{
+    std::memset(&state_, 0, sizeof(state_));
+}
+
+GripperDaemon::~GripperDaemon()
+{
+    stop();
+}
+
+bool GripperDaemon::start()
+{
+    if (running_)
+        return true;
+
+    // never take the segments over from a running daemon, the ones of a crashed daemon are replaced
+    {
+        SharedMemoryObject<SynchronizedData<DaemonState>> existing(config_.prefix + ".daemon");
+        if (existing.attach(0))
+        {
+            DaemonState other = existing.getData()->get();
+            if (other.pid_ > 0 && other.pid_ != getpid() && kill(other.pid_, 0) == 0)
+                return false;
+        }
+    }
+
+    shm_status_.create();
+    shm_status_event_.create();
+    shm_action_.create();
+    shm_request_id_.create();
+    shm_stroke_.create();
+    shm_signal_.create();
+    shm_lease_.create();
+    shm_daemon_.create();
+    shm_action_.getData()->set(GripkitAction::NONE);
+
+    // share the deadlines learned before restart
+    if (!config_.stroke_model_file.empty() && monitor_tick_.strokeModel().load(config_.stroke_model_file))
+        shm_stroke_.getData()->set(monitor_tick_.strokeModel().deadlines());
+
+    // known output state, like a cold activation of the CBun
+    io_->setGrip(false);
+
+    std::memset(&state_, 0, sizeof(state_));
+    state_.pid_ = getpid();
+    state_.started_ns_ = monotonicNowNs();
+    state_.last_action_ = GripkitAction::NONE;
+    monitor_tick_.reset();
+    thread_setup_done_ = false;
+
+    running_ = monitor_.start(500);
+    if (!running_)
+        stop();
+    return running_;
+}
+
+void GripperDaemon::stop()
+{
+    if (running_ && !monitor_.stop(500))
+        return;
+    running_ = false;
+
+    SynchronizedData<DaemonState>* daemon = shm_daemon_.getData();
+    if (!daemon)
+        return;
+
+    // mark status stale, so that readers fail fast instead of waiting for the heartbeat to age
+    SynchronizedData<PublishedStatus>* status = shm_status_.getData();
+    PublishedStatus published = status->get();
+    published.heartbeat_ns_ = 0;
+    status->set(published);
+    state_.pid_ = 0;
+    state_.heartbeat_ns_ = 0;
+    daemon->set(state_);
+    shm_status_event_.getData()->notify();
+
+    if (!config_.stroke_model_file.empty())
+        monitor_tick_.strokeModel().save(config_.stroke_model_file);
+
+    shm_status_.destroy();
+    shm_status_event_.destroy();
+    shm_action_.destroy();
+    shm_request_id_.destroy();
+    shm_stroke_.destroy();
+    shm_signal_.destroy();
+    shm_lease_.destroy();
+    shm_daemon_.destroy();
+}
+
+DaemonState GripperDaemon::state()
+{
+    SynchronizedData<DaemonState>* daemon = shm_daemon_.getData();
+    return daemon ? daemon->get() : state_;
+}
+
+void GripperDaemon::setupThread()
+{
+    if (config_.cpu >= 0)
+    {
+        cpu_set_t cpus;
+        CPU_ZERO(&cpus);
+        CPU_SET(config_.cpu, &cpus);
+        pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+    }
+
+    if (config_.fifo_priority > 0)
+    {
+        struct sched_param param;
+        std::memset(&param, 0, sizeof(param));
+        param.sched_priority = config_.fifo_priority;
+        state_.realtime_ = (pthread_setschedparam(pthread_self(), SCHED_FIFO, &param) == 0) ? 1 : 0;
+    }
+}
+
+GripkitCrEasyStatus GripperDaemon::getStatus()
+{
+    if (!thread_setup_done_)
+    {
+        setupThread();
+        thread_setup_done_ = true;
+    }
+
+    state_.sample_.timestamp_ns_ = FlightRecorder::now();
+    state_.sample_.monotonic_ns_ = monotonicNowNs();
+    io_->read(state_.sample_);
+    return decodeStatus(state_.sample_);
+}
+
+void GripperDaemon::onStatusChange(GripkitCrEasyStatus)
+{
+    // onTick already published this sample
+    shm_status_event_.getData()->notify();
+}
+
+void GripperDaemon::onTick(GripkitCrEasyStatus status)
+{
+    // a tick sampled much later than one period after the previous one missed its deadline
+    uint64_t previous_sample_ns = (state_.ticks_ > 0) ? state_.heartbeat_ns_ : 0;
+    if (previous_sample_ns > 0 && state_.sample_.monotonic_ns_ - previous_sample_ns > METRICS_OVERRUN_FACTOR * config_.period_ms * 1e6)
+        ++state_.overruns_;
+    ++state_.ticks_;
+
+    MonitorSegments segments = { shm_status_.getData(), shm_action_.getData(), shm_stroke_.getData(), shm_signal_.getData(), NULL };
+    DaemonTickPolicy policy{ this };
+    GripkitAction action;
+    monitor_tick_.run(status, state_.sample_, segments, status_events_, policy, action);
+
+    state_.status_ = status;
+    state_.sequence_ = monitor_tick_.sequence();
+    state_.heartbeat_ns_ = state_.sample_.monotonic_ns_;
+    shm_daemon_.getData()->set(state_);
+}
+
+void GripperDaemon::applyAction(GripkitAction action)
+{
+    io_->setGrip(action == GripkitAction::GRIP);
+    state_.last_action_ = action;
+    ++state_.action_count_;
+}
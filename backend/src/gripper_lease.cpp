@@ -0,0 +1,252 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2023, KR Soft s.r.o.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the Kassow Robots nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#include "weiss_gripkit/gripper_lease.h"
+#include "weiss_gripkit/gripkit_logic.h"
+
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <boost/interprocess/sync/scoped_lock.hpp>
+#include <algorithm>
+#include <cerrno>
+#include <signal.h>
+#include <unistd.h>
+
+using namespace kswx_weiss_gripkit;
+
+typedef boost::interprocess::scoped_lock<boost::interprocess::interprocess_mutex> LeaseLock;
+
+
+const double kswx_weiss_gripkit::LEASE_WAIT_BOUNDS_S[LEASE_WAIT_BUCKETS] =
+    { 0.001, 0.01, 0.05, 0.1, 0.25, 0.5, 1.0, 2.0, 5.0, 10.0 };
+
+const char* kswx_weiss_gripkit::toString(LeaseResult result)
+{
+    switch (result)
+    {
+        case LeaseResult::GRANTED: return "GRANTED";
+        case LeaseResult::REJECTED: return "REJECTED";
+        case LeaseResult::TIMEOUT: return "TIMEOUT";
+        case LeaseResult::FULL: return "FULL";
+    }
+    return "UNKNOWN";
+}
+
+static bool processExited(pid_t pid)
+{
+    return kill(pid, 0) != 0 && errno == ESRCH;
+}
+
+GripperLease::GripperLease() :
+owner_pid_(0),
+owner_priority_(0),
+expires_ns_(0),
+waiters_(),
+waiter_count_(0),
+stats_()
+{}
+
+LeaseResult GripperLease::acquire(pid_t pid, int priority, uint32_t duration_ms, uint32_t timeout_ms)
+{
+    uint64_t start_ns = monotonicNowNs();
+    uint64_t deadline_ns = start_ns + timeout_ms * 1000000ULL;
+    bool waiting = false;
+
+    LeaseLock lock(mutex_);
+    while (true)
+    {
+        uint64_t now_ns = monotonicNowNs();
+        reclaimLocked(now_ns);
+
+        // renew, or take a free lease unless a waiter comes first
+        int next = nextWaiterLocked();
+        bool first = (next < 0) || (waiters_[next].pid_ == pid) ||
+            (!waiting && (priority > waiters_[next].priority_));
+        if (owner_pid_ == pid || (owner_pid_ == 0 && first))
+        {
+            if (owner_pid_ != pid)
+            {
+                uint64_t wait_ns = now_ns - start_ns;
+                ++stats_.granted_;
+                if (!waiting)
+                    ++stats_.immediate_;
+                stats_.wait_.add(wait_ns * 1e-9, LEASE_WAIT_BOUNDS_S);
+                if (wait_ns > stats_.max_wait_ns_)
+                    stats_.max_wait_ns_ = wait_ns;
+            }
+            removeWaiterLocked(pid);
+            owner_pid_ = pid;
+            owner_priority_ = priority;
+            expires_ns_ = now_ns + duration_ms * 1000000ULL;
+            return LeaseResult::GRANTED;
+        }
+
+        if (timeout_ms == 0)
+            return LeaseResult::REJECTED;
+
+        if (now_ns >= deadline_ns)
+        {
+            removeWaiterLocked(pid);
+            ++stats_.timeouts_;
+            return LeaseResult::TIMEOUT;
+        }
+
+        if (!waiting)
+        {
+            if (waiter_count_ >= LEASE_MAX_WAITERS)
+            {
+                ++stats_.full_;
+                return LeaseResult::FULL;
+            }
+            waiters_[waiter_count_++] = Waiter{ pid, priority, now_ns };
+            waiting = true;
+        }
+
+        // woken by release and queue changes; expiry and exited processes are noticed at the latest LEASE_CHECK_MS later
+        uint64_t wake_ns = std::min<uint64_t>(deadline_ns, now_ns + LEASE_CHECK_MS * 1000000ULL);
+        if (owner_pid_ != 0)
+            wake_ns = std::min<uint64_t>(wake_ns, expires_ns_);
+        boost::posix_time::ptime wake = boost::posix_time::microsec_clock::universal_time() +
+            boost::posix_time::microseconds(static_cast<int64_t>((wake_ns - now_ns) / 1000));
+        changed_.timed_wait(lock, wake);
+    }
+}
+
+bool GripperLease::renew(pid_t pid, uint32_t duration_ms)
+{
+    LeaseLock lock(mutex_);
+    uint64_t now_ns = monotonicNowNs();
+    reclaimLocked(now_ns);
+
+    if (owner_pid_ != pid)
+        return false;
+
+    expires_ns_ = now_ns + duration_ms * 1000000ULL;
+    return true;
+}
+
+bool GripperLease::release(pid_t pid)
+{
+    LeaseLock lock(mutex_);
+    if (owner_pid_ != pid)
+        return false;
+
+    freeLocked();
+    return true;
+}
+
+bool GripperLease::admit(pid_t pid, uint32_t duration_ms, bool operator_override)
+{
+    LeaseLock lock(mutex_);
+    uint64_t now_ns = monotonicNowNs();
+    reclaimLocked(now_ns);
+
+    if (owner_pid_ == 0)
+        return true;
+
+    if (owner_pid_ == pid)
+    {
+        expires_ns_ = now_ns + duration_ms * 1000000ULL;
+        return true;
+    }
+
+    if (operator_override)
+    {
+        ++stats_.overrides_;
+        return true;
+    }
+
+    ++stats_.rejected_;
+    return false;
+}
+
+LeaseHolder GripperLease::holder()
+{
+    LeaseLock lock(mutex_);
+    uint64_t now_ns = monotonicNowNs();
+    reclaimLocked(now_ns);
+    return LeaseHolder{ owner_pid_, owner_priority_, (owner_pid_ != 0) ? expires_ns_ - now_ns : 0, waiter_count_ };
+}
+
+LeaseStats GripperLease::stats()
+{
+    LeaseLock lock(mutex_);
+    return stats_;
+}
+
+void GripperLease::reclaimLocked(uint64_t now_ns)
+{
+    if (owner_pid_ != 0 && (now_ns >= expires_ns_ || processExited(owner_pid_)))
+    {
+        freeLocked();
+        ++stats_.expired_;
+    }
+
+    for (int i = waiter_count_ - 1; i >= 0; --i)
+    {
+        if (processExited(waiters_[i].pid_))
+            removeWaiterLocked(waiters_[i].pid_);
+    }
+}
+
+void GripperLease::freeLocked()
+{
+    owner_pid_ = 0;
+    expires_ns_ = 0;
+    changed_.notify_all();
+}
+
+int GripperLease::nextWaiterLocked() const
+{
+    int next = -1;
+    for (int i = 0; i < waiter_count_; ++i)
+    {
+        if (next < 0 || waiters_[i].priority_ > waiters_[next].priority_ ||
+            (waiters_[i].priority_ == waiters_[next].priority_ && waiters_[i].since_ns_ < waiters_[next].since_ns_))
+            next = i;
+    }
+    return next;
+}
+
+void GripperLease::removeWaiterLocked(pid_t pid)
+{
+    for (int i = 0; i < waiter_count_; ++i)
+    {
+        if (waiters_[i].pid_ == pid)
+        {
+            waiters_[i] = waiters_[--waiter_count_];
+            changed_.notify_all();
+            return;
+        }
+    }
+}
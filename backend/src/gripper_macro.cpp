@@ -0,0 +1,329 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2023, KR Soft s.r.o.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the Kassow Robots nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#include "weiss_gripkit/gripper_macro.h"
+#include "weiss_gripkit/gripkit_logic.h"
+
+#include <cstdlib>
+#include <sstream>
+#include <vector>
+
+using namespace kswx_weiss_gripkit;
+
+
+static std::vector<std::string> split(const std::string& text, char separator)
+{
+    std::vector<std::string> parts;
+    std::stringstream stream(text);
+    std::string part;
+    while (std::getline(stream, part, separator))
+        parts.push_back(part);
+    return parts;
+}
+
+static bool parseNumber(const std::string& text, unsigned long max, unsigned long& value)
+{
+    if (text.empty() || text.find_first_not_of("0123456789") != std::string::npos)
+        return false;
+    value = std::strtoul(text.c_str(), NULL, 10);
+    return value <= max;
+}
+
+static bool parseStatusMask(const std::string& text, uint8_t& mask)
+{
+    const GripkitCrEasyStatus statuses[] = { GripkitCrEasyStatus::IDLE_OR_ERROR, GripkitCrEasyStatus::RELEASED,
+        GripkitCrEasyStatus::NO_PART, GripkitCrEasyStatus::HOLDING, GripkitCrEasyStatus::STATUS_ERROR };
+
+    mask = 0;
+    for (const std::string& name : split(text, '|'))
+    {
+        uint8_t bit = 0;
+        for (GripkitCrEasyStatus status : statuses)
+        {
+            if (name == toString(status))
+                bit = statusBit(status);
+        }
+        if (!bit)
+            return false;
+        mask |= bit;
+    }
+    return mask != 0;
+}
+
+static std::string formatStatusMask(uint8_t mask)
+{
+    std::string text;
+    for (unsigned int i = 0; i <= static_cast<unsigned int>(GripkitCrEasyStatus::STATUS_ERROR); ++i)
+    {
+        if (mask & (1u << i))
+            text += (text.empty() ? "" : "|") + std::string(toString(static_cast<GripkitCrEasyStatus>(i)));
+    }
+    return text;
+}
+
+bool kswx_weiss_gripkit::parseMacro(const std::string& text, MacroProgram& program, std::string& error)
+{
+    program = MacroProgram();
+    std::stringstream stream(text);
+    std::string token;
+    while (stream >> token)
+    {
+        if (program.step_count_ >= MACRO_MAX_STEPS)
+        {
+            error = "more than " + std::to_string(MACRO_MAX_STEPS) + " steps";
+            return false;
+        }
+
+        int index = program.step_count_;
+        MacroStep step = MacroStep();
+        std::vector<std::string> fields = split(token, ':');
+        unsigned long value = 0;
+        bool valid = false;
+
+        if (fields[0] == "grip" || fields[0] == "release")
+        {
+            step.op_ = MacroOp::ACTION;
+            step.action_ = (fields[0] == "grip") ? GripkitAction::GRIP : GripkitAction::RELEASE;
+            valid = fields.size() == 1;
+        }
+        else if (fields[0] == "wait")
+        {
+            step.op_ = MacroOp::WAIT_STATUS;
+            valid = (fields.size() == 2 || fields.size() == 3) && parseStatusMask(fields[1], step.status_mask_);
+            if (valid && fields.size() == 3)
+            {
+                valid = parseNumber(fields[2], UINT16_MAX, value);
+                step.time_ms_ = static_cast<uint16_t>(value);
+            }
+        }
+        else if (fields[0] == "dwell")
+        {
+            step.op_ = MacroOp::DWELL;
+            valid = fields.size() == 2 && parseNumber(fields[1], UINT16_MAX, value);
+            step.time_ms_ = static_cast<uint16_t>(value);
+        }
+        else if (fields[0] == "retry")
+        {
+            unsigned long count = 0;
+            step.op_ = MacroOp::RETRY_IF_STATUS;
+            valid = fields.size() == 4 && parseStatusMask(fields[1], step.status_mask_)
+                && parseNumber(fields[2], MACRO_MAX_STEPS - 1, value) && parseNumber(fields[3], UINT16_MAX, count);
+            step.target_ = static_cast<uint8_t>(value);
+            step.count_ = static_cast<uint16_t>(count);
+        }
+
+        if (!valid)
+        {
+            error = "invalid step " + std::to_string(index) + " '" + token + "'";
+            return false;
+        }
+
+        program.steps_[program.step_count_++] = step;
+    }
+
+    if (program.step_count_ == 0)
+    {
+        error = "no steps";
+        return false;
+    }
+
+    for (int i = 0; i < program.step_count_; ++i)
+    {
+        if (program.steps_[i].op_ == MacroOp::RETRY_IF_STATUS && program.steps_[i].target_ >= program.step_count_)
+        {
+            error = "step " + std::to_string(i) + " jumps past the last step";
+            return false;
+        }
+    }
+
+    error.clear();
+    return true;
+}
+
+std::string kswx_weiss_gripkit::formatMacro(const MacroProgram& program)
+{
+    std::string text;
+    for (int i = 0; i < program.step_count_ && i < MACRO_MAX_STEPS; ++i)
+    {
+        const MacroStep& step = program.steps_[i];
+        if (!text.empty())
+            text += " ";
+
+        switch (step.op_)
+        {
+            case MacroOp::ACTION:
+                text += (step.action_ == GripkitAction::GRIP) ? "grip" : "release";
+                break;
+            case MacroOp::WAIT_STATUS:
+                text += "wait:" + formatStatusMask(step.status_mask_);
+                if (step.time_ms_ > 0)
+                    text += ":" + std::to_string(step.time_ms_);
+                break;
+            case MacroOp::DWELL:
+                text += "dwell:" + std::to_string(step.time_ms_);
+                break;
+            case MacroOp::RETRY_IF_STATUS:
+                text += "retry:" + formatStatusMask(step.status_mask_) + ":" + std::to_string(step.target_) + ":" + std::to_string(step.count_);
+                break;
+        }
+    }
+    return text;
+}
+
+const char* kswx_weiss_gripkit::toString(MacroState state)
+{
+    switch (state)
+    {
+        case MacroState::IDLE:          return "IDLE";
+        case MacroState::RUNNING:       return "RUNNING";
+        case MacroState::DONE:          return "DONE";
+        case MacroState::FAILED:        return "FAILED";
+        case MacroState::TIMEOUT:       return "TIMEOUT";
+        case MacroState::INTERRUPTED:   return "INTERRUPTED";
+    }
+    return "UNKNOWN";
+}
+
+MacroRunner::MacroRunner() :
+program_(),
+state_(MacroState::IDLE),
+run_(0),
+step_(0),
+ticks_(0),
+step_start_ns_(0),
+action_tick_(false),
+error_ticks_(0),
+jumps_(0)
+{}
+
+void MacroRunner::start(const MacroProgram& program, uint64_t run, uint64_t now_ns)
+{
+    program_ = program;
+    state_ = MacroState::RUNNING;
+    run_ = run;
+    ticks_ = 0;
+    action_tick_ = false;
+    for (uint16_t& retries : retries_)
+        retries = 0;
+    enterStep(0, now_ns);
+}
+
+void MacroRunner::interrupt()
+{
+    if (state_ == MacroState::RUNNING)
+        state_ = MacroState::INTERRUPTED;
+}
+
+void MacroRunner::enterStep(int step, uint64_t now_ns)
+{
+    step_ = step;
+    step_start_ns_ = now_ns;
+    error_ticks_ = 0;
+}
+
+MacroState MacroRunner::tick(GripkitCrEasyStatus status, uint64_t now_ns, GripkitAction& action)
+{
+    action = GripkitAction::NONE;
+    if (state_ != MacroState::RUNNING)
+        return state_;
+
+    ++ticks_;
+
+    // the status of the tick that changed the output does not reflect the action yet
+    bool fresh = !action_tick_;
+    action_tick_ = false;
+
+    bool error_status = (status == GripkitCrEasyStatus::IDLE_OR_ERROR || status == GripkitCrEasyStatus::STATUS_ERROR);
+    uint64_t elapsed_ms = 0;
+
+    // chain steps completed within this tick, bounded so that a retry loop cannot stall the monitor
+    for (jumps_ = 0; jumps_ <= MACRO_MAX_JUMPS; ++jumps_)
+    {
+        if (step_ >= program_.step_count_)
+        {
+            state_ = MacroState::DONE;
+            return state_;
+        }
+
+        const MacroStep& step = program_.steps_[step_];
+        elapsed_ms = (now_ns - step_start_ns_) / 1000000;
+        switch (step.op_)
+        {
+            case MacroOp::ACTION:
+                action = step.action_;
+                action_tick_ = true;
+                enterStep(step_ + 1, now_ns);
+                return state_;
+
+            case MacroOp::WAIT_STATUS:
+                if (fresh && (step.status_mask_ & statusBit(status)))
+                {
+                    enterStep(step_ + 1, now_ns);
+                    continue;
+                }
+
+                // errors are tolerated for a few ticks, the gripper reports them shortly when switching from RELEASED to NO_PART
+                if (fresh && error_status && ++error_ticks_ >= MIN_CONTINUOUS_ERROR_COUNT)
+                    state_ = MacroState::FAILED;
+                else if (fresh && !error_status)
+                    error_ticks_ = 0;
+
+                if (state_ == MacroState::RUNNING && step.time_ms_ > 0 && elapsed_ms >= step.time_ms_)
+                    state_ = MacroState::TIMEOUT;
+                return state_;
+
+            case MacroOp::DWELL:
+                if (elapsed_ms < step.time_ms_)
+                    return state_;
+                enterStep(step_ + 1, now_ns);
+                continue;
+
+            case MacroOp::RETRY_IF_STATUS:
+                if (!fresh)
+                    return state_;
+                if ((step.status_mask_ & statusBit(status)) && retries_[step_] < step.count_)
+                {
+                    ++retries_[step_];
+                    enterStep(step.target_, now_ns);
+                }
+                else
+                {
+                    enterStep(step_ + 1, now_ns);
+                }
+                continue;
+        }
+    }
+
+    return state_;
+}
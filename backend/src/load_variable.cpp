@@ -0,0 +1,100 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2023, KR Soft s.r.o.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the Kassow Robots nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#include "weiss_gripkit/load_variable.h"
+
+using namespace kswx_weiss_gripkit;
+
+
+LoadVariableWriter::LoadVariableWriter(int coalesce_ticks)
+:   coalesce_ticks_(coalesce_ticks),
+    ticks_since_commit_(coalesce_ticks),
+    committed_valid_(false),
+    writes_(0),
+    skipped_(0),
+    coalesced_(0)
+{}
+
+void LoadVariableWriter::setVariable(boost::shared_ptr<kr2_program_api::Load> variable)
+{
+    variable_ = variable;
+    committed_valid_ = false;
+}
+
+void LoadVariableWriter::write(const LoadData& load)
+{
+    commit(PreparedLoad(load));
+}
+
+void LoadVariableWriter::request(const LoadData& load)
+{
+    request(PreparedLoad(load));
+}
+
+void LoadVariableWriter::request(const PreparedLoad& load)
+{
+    // a different load is never delayed, a program may move right after the status that requested it
+    if (ticks_since_commit_ < coalesce_ticks_ && committed_valid_ && committed_ == load.data_ && variable_ && LoadData(*variable_) == load.data_)
+    {
+        ++coalesced_;
+        return;
+    }
+
+    commit(load);
+}
+
+void LoadVariableWriter::tick()
+{
+    if (ticks_since_commit_ < coalesce_ticks_)
+        ++ticks_since_commit_;
+}
+
+void LoadVariableWriter::commit(const PreparedLoad& load)
+{
+    if (!variable_)
+        return;
+
+    // the variable is checked as well, programs may assign the system load on their own
+    if (committed_valid_ && committed_ == load.data_ && LoadData(*variable_) == load.data_)
+    {
+        ++skipped_;
+        return;
+    }
+
+    *variable_ = load.value_;
+    committed_ = load.data_;
+    committed_valid_ = true;
+    ticks_since_commit_ = 0;
+    ++writes_;
+}
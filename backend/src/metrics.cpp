@@ -0,0 +1,317 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2023, KR Soft s.r.o.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the Kassow Robots nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#include "weiss_gripkit/metrics.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <poll.h>
+#include <sstream>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+using namespace kswx_weiss_gripkit;
+
+
+const double kswx_weiss_gripkit::METRICS_TICK_BOUNDS_S[METRICS_TICK_BUCKETS] =
+    { 10e-6, 20e-6, 50e-6, 100e-6, 200e-6, 500e-6, 1e-3, 2e-3, 5e-3, 10e-3 };
+
+const double kswx_weiss_gripkit::METRICS_ACTION_BOUNDS_S[METRICS_ACTION_BUCKETS] =
+    { 0.02, 0.05, 0.1, 0.15, 0.2, 0.3, 0.5, 1.0, 2.0, 5.0 };
+
+
+static void counter(std::ostringstream& out, const char* name, const char* help, uint64_t value)
+{
+    out << "# TYPE weiss_gripkit_" << name << " counter\n";
+    out << "# HELP weiss_gripkit_" << name << " " << help << "\n";
+    out << "weiss_gripkit_" << name << "_total " << value << "\n";
+}
+
+static void gauge(std::ostringstream& out, const char* name, const char* help, double value)
+{
+    out << "# TYPE weiss_gripkit_" << name << " gauge\n";
+    out << "# HELP weiss_gripkit_" << name << " " << help << "\n";
+    out << "weiss_gripkit_" << name << " " << value << "\n";
+}
+
+template <int bucket_count>
+static void histogram(std::ostringstream& out, const char* name, const char* help, const MetricsHistogram<bucket_count>& values, const double* bounds)
+{
+    out << "# TYPE weiss_gripkit_" << name << " histogram\n";
+    out << "# UNIT weiss_gripkit_" << name << " seconds\n";
+    out << "# HELP weiss_gripkit_" << name << " " << help << "\n";
+
+    // OpenMetrics buckets are cumulative
+    uint64_t cumulative = 0;
+    for (int i = 0; i < bucket_count; ++i)
+    {
+        cumulative += values.buckets_[i];
+        out << "weiss_gripkit_" << name << "_bucket{le=\"" << bounds[i] << "\"} " << cumulative << "\n";
+    }
+    out << "weiss_gripkit_" << name << "_bucket{le=\"+Inf\"} " << values.count_ << "\n";
+    out << "weiss_gripkit_" << name << "_count " << values.count_ << "\n";
+    out << "weiss_gripkit_" << name << "_sum " << values.sum_ << "\n";
+}
+
+std::string kswx_weiss_gripkit::formatOpenMetrics(const MetricsSnapshot& snapshot)
+{
+    std::ostringstream out;
+    out.precision(9);
+
+    gauge(out, "activated", "1 if the gripper is activated.", snapshot.activated_);
+    gauge(out, "status", "Gripper status, 0 IDLE_OR_ERROR, 1 RELEASED, 2 NO_PART, 3 HOLDING, 4 STATUS_ERROR.", snapshot.status_);
+
+    counter(out, "monitor_ticks", "Status monitor ticks.", snapshot.ticks_);
+    counter(out, "monitor_overruns", "Status monitor ticks started later than 1.5 periods after the previous one.", snapshot.monitor_overruns_);
+
+    out << "# TYPE weiss_gripkit_actions counter\n";
+    out << "# HELP weiss_gripkit_actions Grip/release actions picked up by the status monitor.\n";
+    out << "weiss_gripkit_actions_total{action=\"grip\"} " << snapshot.grip_actions_ << "\n";
+    out << "weiss_gripkit_actions_total{action=\"release\"} " << snapshot.release_actions_ << "\n";
+
+    out << "# TYPE weiss_gripkit_action_results counter\n";
+    out << "# HELP weiss_gripkit_action_results Outcome of picked up actions.\n";
+    out << "weiss_gripkit_action_results_total{result=\"done\"} " << snapshot.actions_done_ << "\n";
+    out << "weiss_gripkit_action_results_total{result=\"failed\"} " << snapshot.actions_failed_ << "\n";
+    out << "weiss_gripkit_action_results_total{result=\"interrupted\"} " << snapshot.actions_interrupted_ << "\n";
+
+    counter(out, "holding", "Transitions to HOLDING.", snapshot.holding_);
+    counter(out, "no_part", "Transitions to NO_PART.", snapshot.no_part_);
+    counter(out, "error_ticks", "Ticks with IDLE_OR_ERROR or STATUS_ERROR status, tolerated until they persist.", snapshot.error_ticks_);
+    counter(out, "faults", "Error status persisted.", snapshot.faults_);
+    counter(out, "stroke_deadline_misses", "Strokes longer than the adaptive deadline of blocking calls.", snapshot.stroke_deadline_misses_);
+    counter(out, "payload_writes", "Payload variable updates.", snapshot.payload_writes_);
+    counter(out, "payload_skipped", "Payload variable updates skipped, value unchanged.", snapshot.payload_skipped_);
+    counter(out, "payload_coalesced", "Payload requests for the committed value dropped shortly after an update.", snapshot.payload_coalesced_);
+    counter(out, "event_drops", "Status events dropped by slow in-process observers.", snapshot.event_drops_);
+
+    histogram(out, "monitor_tick_duration_seconds", "Processing time of a status monitor tick.", snapshot.tick_duration_, METRICS_TICK_BOUNDS_S);
+    histogram(out, "grip_latency_seconds", "Time from pick up of a grip to HOLDING or NO_PART.", snapshot.grip_latency_, METRICS_ACTION_BOUNDS_S);
+    histogram(out, "release_latency_seconds", "Time from pick up of a release to RELEASED.", snapshot.release_latency_, METRICS_ACTION_BOUNDS_S);
+
+    out << "# EOF\n";
+    return out.str();
+}
+
+MetricsBuffer::MetricsBuffer() :
+buffers_(),
+front_(0),
+published_(false),
+skipped_(0)
+{
+    readers_[0] = 0;
+    readers_[1] = 0;
+}
+
+bool MetricsBuffer::publish(const MetricsSnapshot& snapshot)
+{
+    int back = 1 - front_.load();
+
+    // the reader may still copy the back buffer, published before the last flip
+    if (readers_[back].load() > 0)
+    {
+        skipped_.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    buffers_[back] = snapshot;
+    front_.store(back);
+    published_.store(true);
+    return true;
+}
+
+bool MetricsBuffer::read(MetricsSnapshot& snapshot)
+{
+    if (!published_.load())
+        return false;
+
+    // register on the front buffer, retry if it was flipped before the registration became visible to the writer
+    int front;
+    while (true)
+    {
+        front = front_.load();
+        readers_[front].fetch_add(1);
+        if (front_.load() == front)
+            break;
+        readers_[front].fetch_sub(1);
+    }
+
+    snapshot = buffers_[front];
+    readers_[front].fetch_sub(1);
+    return true;
+}
+
+MetricsExporter::MetricsExporter() :
+buffer_(NULL),
+listen_fd_(-1),
+wake_fd_(-1),
+running_(false),
+stopping_(false)
+{}
+
+MetricsExporter::~MetricsExporter()
+{
+    stop();
+}
+
+bool MetricsExporter::start(MetricsBuffer* buffer, const std::string& textfile_path, const std::string& socket_path)
+{
+    stop();
+
+    wake_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (!buffer || wake_fd_ < 0)
+    {
+        stop();
+        return false;
+    }
+
+    if (!socket_path.empty())
+    {
+        struct sockaddr_un address;
+        std::memset(&address, 0, sizeof(address));
+        address.sun_family = AF_UNIX;
+        if (socket_path.size() >= sizeof(address.sun_path))
+        {
+            stop();
+            return false;
+        }
+        std::strncpy(address.sun_path, socket_path.c_str(), sizeof(address.sun_path) - 1);
+
+        // replace the socket file left behind by a previous instance
+        listen_fd_ = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        unlink(socket_path.c_str());
+        if (listen_fd_ < 0 || bind(listen_fd_, reinterpret_cast<struct sockaddr*>(&address), sizeof(address)) != 0 || listen(listen_fd_, 4) != 0)
+        {
+            stop();
+            return false;
+        }
+        socket_path_ = socket_path;
+    }
+
+    buffer_ = buffer;
+    textfile_path_ = textfile_path;
+    stopping_ = false;
+    running_ = true;
+    thread_ = std::thread(&MetricsExporter::run, this);
+    return true;
+}
+
+void MetricsExporter::stop()
+{
+    if (thread_.joinable())
+    {
+        stopping_ = true;
+        uint64_t value = 1;
+        if (write(wake_fd_, &value, sizeof(value)) < 0)
+        {
+            // eventfd counter saturated, the thread is woken anyway
+        }
+        thread_.join();
+    }
+    running_ = false;
+
+    if (listen_fd_ >= 0)
+        ::close(listen_fd_);
+    if (wake_fd_ >= 0)
+        ::close(wake_fd_);
+    listen_fd_ = wake_fd_ = -1;
+
+    if (!socket_path_.empty())
+        unlink(socket_path_.c_str());
+    socket_path_.clear();
+}
+
+void MetricsExporter::run()
+{
+    struct pollfd fds[2];
+    fds[0].fd = wake_fd_;
+    fds[0].events = POLLIN;
+    fds[1].fd = listen_fd_;
+    fds[1].events = POLLIN;
+    int fd_count = (listen_fd_ >= 0) ? 2 : 1;
+
+    MetricsSnapshot snapshot;
+    auto next_export = std::chrono::steady_clock::now();
+    while (!stopping_)
+    {
+        auto now = std::chrono::steady_clock::now();
+        if (now >= next_export)
+        {
+            if (!textfile_path_.empty() && buffer_->read(snapshot))
+                writeTextfile(formatOpenMetrics(snapshot));
+            next_export = now + std::chrono::milliseconds(METRICS_EXPORT_INTERVAL_MS);
+        }
+
+        int timeout_ms = static_cast<int>(std::chrono::duration_cast<std::chrono::milliseconds>(next_export - now).count());
+        int count = poll(fds, fd_count, std::max(timeout_ms, 1));
+        if (count < 0 && errno != EINTR)
+            break;
+
+        if (count > 0 && fd_count > 1 && (fds[1].revents & POLLIN))
+        {
+            // one scrape per connection, the text is small enough for the socket buffer
+            int fd = accept4(listen_fd_, NULL, NULL, SOCK_CLOEXEC);
+            if (fd >= 0)
+            {
+                std::string text = buffer_->read(snapshot) ? formatOpenMetrics(snapshot) : std::string("# EOF\n");
+                if (send(fd, text.data(), text.size(), MSG_NOSIGNAL) < 0)
+                {
+                    // scraper went away
+                }
+                ::close(fd);
+            }
+        }
+    }
+
+    running_ = false;
+}
+
+void MetricsExporter::writeTextfile(const std::string& text)
+{
+    // write a temporary file and rename it, so that collectors never read a partial file
+    std::string temporary_path = textfile_path_ + ".tmp";
+    FILE* file = fopen(temporary_path.c_str(), "w");
+    if (!file)
+        return;
+
+    bool written = fwrite(text.data(), 1, text.size(), file) == text.size();
+    written = (fclose(file) == 0) && written;
+    if (!written || rename(temporary_path.c_str(), textfile_path_.c_str()) != 0)
+        unlink(temporary_path.c_str());
+}
@@ -0,0 +1,76 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2023, KR Soft s.r.o.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the Kassow Robots nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+
+#include "weiss_gripkit/monitor_tick.h"
+
+using namespace kswx_weiss_gripkit;
+
+
+void MonitorTick::reset()
+{
+    event_source_.reset();
+    signal_health_ = SignalHealth();
+}
+
+uint64_t MonitorTick::publish(SynchronizedData<PublishedStatus>* status, GripkitCrEasyStatus value, uint64_t sample_time_ns)
+{
+    ++sequence_;
+    if (status)
+    {
+        PublishedStatus published;
+        published.status_ = value;
+        published.sequence_ = sequence_;
+        published.sample_time_ns_ = sample_time_ns;
+        published.heartbeat_ns_ = monotonicNowNs();
+        status->set(published);
+    }
+    return sequence_;
+}
+
+unsigned int MonitorTick::learn(GripkitCrEasyStatus status, GripkitAction action, const GripkitSample& sample, const MonitorSegments& segments,
+    StatusEventHub& hub)
+{
+    // push status transitions, action completions and faults to in-process observers
+    unsigned int events = event_source_.update(hub, status, action, sequence_, sample.monotonic_ns_);
+
+    // learn stroke time from the same completion the events and metrics see, share updated deadlines
+    if ((events & static_cast<unsigned int>(StatusEventType::ACTION_COMPLETED)) && stroke_model_.learn(event_source_.lastCompletion()) &&
+        segments.stroke_)
+    {
+        segments.stroke_->set(stroke_model_.deadlines());
+    }
+
+    return events;
+}
@@ -34,52 +34,10 @@
 
 #include "weiss_gripkit/periodic_thread.h"
 
-#include <unistd.h>
-
 using namespace kswx_weiss_gripkit;
 
 
-PeriodicThread::PeriodicThread(std::function<void()> init_method, std::function<void()> cycle_method, int sleep_ms) : 
-init_method_(init_method), cycle_method_(cycle_method), sleep_ms_(sleep_ms), stop_request_(true), initialized_(false) {}
-
-
-bool PeriodicThread::start(int timeout_ms)
-{
-    initialized_ = false;
-    stop_request_ = false;
-
-    periodic_thread_ = std::thread([this]() {
-        init_method_();
-        initialized_ = true;
-        while (!stop_request_)
-        {
-            cycle_method_();
-            usleep(1000 * sleep_ms_);
-        }
-        initialized_ = false;
-    });
+template class kswx_weiss_gripkit::BasicPeriodicThread<std::function<void()>, std::function<void()>>;
 
-    for (int i = 0; i < timeout_ms && !initialized_; ++i)
-        usleep(1000);
-
-    return initialized_;
-}
-
-bool PeriodicThread::stop(int timeout_ms)
-{
-    stop_request_ = true;
-    for (int i = 0; i < timeout_ms && initialized_; ++i)
-        usleep(1000);
-    
-    if (initialized_)
-    {
-        return false;
-    }
-    else
-    {
-        if (periodic_thread_.joinable())
-            periodic_thread_.join();
-
-        return true;
-    }
-}
\ No newline at end of file
+PeriodicThread::PeriodicThread(std::function<void()> init_method, std::function<void()> cycle_method, int sleep_ms) : 
+BasicPeriodicThread(init_method, cycle_method, sleep_ms) {}
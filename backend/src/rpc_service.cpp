@@ -0,0 +1,152 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2023, KR Soft s.r.o.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the Kassow Robots nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#include "weiss_gripkit/rpc_service.h"
+
+#include <time.h>
+
+using namespace kswx_weiss_gripkit;
+
+
+const double kswx_weiss_gripkit::RPC_LATENCY_BOUNDS_S[RPC_LATENCY_BUCKETS] =
+    { 50e-6, 100e-6, 250e-6, 500e-6, 1e-3, 2.5e-3, 10e-3, 50e-3, 250e-3, 1.0 };
+
+static uint64_t monotonicNs()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000000ULL + static_cast<uint64_t>(ts.tv_nsec);
+}
+
+const char* kswx_weiss_gripkit::toString(RpcOutcome outcome)
+{
+    switch (outcome)
+    {
+        case RpcOutcome::OK: return "ok";
+        case RpcOutcome::FAILED: return "failed";
+        case RpcOutcome::BUSY: return "busy";
+    }
+    return "unknown";
+}
+
+double RpcMethodStats::percentileS(double p) const
+{
+    if (latency_.count_ == 0)
+        return 0.0;
+
+    uint64_t rank = static_cast<uint64_t>(p / 100.0 * (latency_.count_ - 1)) + 1;
+    uint64_t seen = 0;
+    for (int i = 0; i < RPC_LATENCY_BUCKETS; ++i)
+    {
+        seen += latency_.buckets_[i];
+        if (seen >= rank)
+            return RPC_LATENCY_BOUNDS_S[i];
+    }
+    return max_s_;
+}
+
+RpcService::RpcService() :
+long_running_(0)
+{}
+
+int RpcService::addMethod(const std::string& name)
+{
+    std::lock_guard<std::mutex> lock(stats_mutex_);
+    RpcMethodStats stats = RpcMethodStats();
+    stats.name_ = name;
+    stats_.push_back(stats);
+    return static_cast<int>(stats_.size()) - 1;
+}
+
+std::vector<RpcMethodStats> RpcService::stats() const
+{
+    std::lock_guard<std::mutex> lock(stats_mutex_);
+    return stats_;
+}
+
+RpcOutcome RpcService::execute(int method, const std::function<void()>& work, bool long_running)
+{
+    uint64_t start_ns = monotonicNs();
+
+    if (long_running)
+    {
+        std::lock_guard<std::mutex> lock(stats_mutex_);
+        if (long_running_ >= RPC_LONG_RUNNING_CALLS)
+        {
+            if (method >= 0 && method < static_cast<int>(stats_.size()))
+            {
+                ++stats_[method].calls_;
+                ++stats_[method].busy_;
+            }
+            return RpcOutcome::BUSY;
+        }
+        ++long_running_;
+    }
+
+    RpcOutcome outcome = RpcOutcome::OK;
+    try
+    {
+        work();
+    }
+    catch (...)
+    {
+        outcome = RpcOutcome::FAILED;
+    }
+
+    if (long_running)
+    {
+        std::lock_guard<std::mutex> lock(stats_mutex_);
+        --long_running_;
+    }
+
+    record(method, outcome, start_ns);
+    return outcome;
+}
+
+void RpcService::record(int method, RpcOutcome outcome, uint64_t start_ns)
+{
+    double latency_s = (monotonicNs() - start_ns) * 1e-9;
+
+    std::lock_guard<std::mutex> lock(stats_mutex_);
+    if (method < 0 || method >= static_cast<int>(stats_.size()))
+        return;
+
+    RpcMethodStats& stats = stats_[method];
+    ++stats.calls_;
+    if (outcome == RpcOutcome::FAILED)
+        ++stats.failures_;
+    stats.latency_.add(latency_s, RPC_LATENCY_BOUNDS_S);
+    if (latency_s > stats.max_s_)
+        stats.max_s_ = latency_s;
+}
@@ -0,0 +1,225 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2023, KR Soft s.r.o.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the Kassow Robots nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#include "weiss_gripkit/status_events.h"
+
+#include <cerrno>
+
+using namespace kswx_weiss_gripkit;
+
+
+StatusSubscription::StatusSubscription(StatusObserver* observer, unsigned int event_mask) :
+observer_(observer),
+event_mask_(event_mask),
+running_(true),
+dropped_events_(0)
+{
+    sem_init(&wake_, 0, 0);
+    thread_ = std::thread(&StatusSubscription::run, this);
+}
+
+StatusSubscription::~StatusSubscription()
+{
+    running_ = false;
+    sem_post(&wake_);
+    if (thread_.joinable())
+        thread_.join();
+    sem_destroy(&wake_);
+}
+
+bool StatusSubscription::post(const StatusEvent& event)
+{
+    if (!(event_mask_ & static_cast<unsigned int>(event.type_)))
+        return true;
+
+    if (!queue_.push(event))
+    {
+        dropped_events_.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    // sem_post only enters the kernel if the executor sleeps
+    sem_post(&wake_);
+    return true;
+}
+
+void StatusSubscription::run()
+{
+    while (true)
+    {
+        if (sem_wait(&wake_) != 0 && errno == EINTR)
+            continue;
+
+        if (!running_)
+            break;
+
+        // one post per event, but drain everything available to keep the latency of bursts low
+        StatusEvent event;
+        while (queue_.pop(event))
+        {
+            switch (event.type_)
+            {
+                case StatusEventType::STATUS_CHANGED:   observer_->onStatusChanged(event.transition_); break;
+                case StatusEventType::ACTION_COMPLETED: observer_->onActionCompleted(event.completion_); break;
+                case StatusEventType::FAULT:            observer_->onFault(event.fault_); break;
+            }
+        }
+    }
+}
+
+StatusEventHub::StatusEventHub() :
+subscribers_(0),
+publishing_(false),
+dropped_events_(0)
+{
+    for (auto& slot : slots_)
+        slot.store(nullptr);
+}
+
+StatusEventHub::~StatusEventHub()
+{
+    for (int i = 0; i < STATUS_EVENT_MAX_SUBSCRIBERS; ++i)
+        unsubscribe(i);
+}
+
+int StatusEventHub::subscribe(StatusObserver* observer, unsigned int event_mask)
+{
+    if (!observer || !(event_mask & STATUS_EVENT_ALL))
+        return -1;
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (int i = 0; i < STATUS_EVENT_MAX_SUBSCRIBERS; ++i)
+    {
+        if (!owned_[i])
+        {
+            owned_[i].reset(new StatusSubscription(observer, event_mask));
+            slots_[i].store(owned_[i].get());
+            ++subscribers_;
+            return i;
+        }
+    }
+    return -1;
+}
+
+bool StatusEventHub::unsubscribe(int subscription_id)
+{
+    if (subscription_id < 0 || subscription_id >= STATUS_EVENT_MAX_SUBSCRIBERS)
+        return false;
+
+    std::unique_ptr<StatusSubscription> subscription;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!owned_[subscription_id])
+            return false;
+
+        // hide the slot, then wait until a publish() that may have loaded it has finished
+        slots_[subscription_id].store(nullptr);
+        while (publishing_.load())
+            std::this_thread::yield();
+
+        subscription = std::move(owned_[subscription_id]);
+        --subscribers_;
+    }
+
+    // joins the executor thread, outside of the lock so that other subscriptions are not held up by a slow observer
+    subscription.reset();
+    return true;
+}
+
+void StatusEventHub::publish(const StatusEvent& event)
+{
+    publishing_.store(true);
+    for (auto& slot : slots_)
+    {
+        StatusSubscription* subscription = slot.load();
+        if (subscription && !subscription->post(event))
+            dropped_events_.fetch_add(1, std::memory_order_relaxed);
+    }
+    publishing_.store(false);
+}
+
+unsigned int StatusEventSource::update(StatusEventHub& hub, GripkitCrEasyStatus status, GripkitAction picked_action, uint64_t sequence, uint64_t sample_time_ns)
+{
+    bool publish = hub.hasSubscribers();
+    unsigned int events = 0;
+    StatusEvent event;
+
+    // status transition, the first status after reset is reported as a transition to itself
+    if (!initialized_ || status != status_)
+    {
+        events |= static_cast<unsigned int>(StatusEventType::STATUS_CHANGED);
+        if (publish)
+        {
+            event.type_ = StatusEventType::STATUS_CHANGED;
+            event.transition_ = StatusTransition{ status, initialized_ ? status_ : status, sequence, sample_time_ns };
+            hub.publish(event);
+        }
+        initialized_ = true;
+        status_ = status;
+    }
+
+    // fault once the error status persists, the gripper reports short errors when switching from RELEASED to NO_PART
+    if (status == GripkitCrEasyStatus::IDLE_OR_ERROR || status == GripkitCrEasyStatus::STATUS_ERROR)
+    {
+        if (++error_ticks_ == MIN_CONTINUOUS_ERROR_COUNT)
+        {
+            events |= static_cast<unsigned int>(StatusEventType::FAULT);
+            if (publish)
+            {
+                event.type_ = StatusEventType::FAULT;
+                event.fault_ = GripperFault{ status, healthy_status_, sequence, sample_time_ns };
+                hub.publish(event);
+            }
+        }
+    }
+    else
+    {
+        error_ticks_ = 0;
+        healthy_status_ = status;
+    }
+
+    // grip/release action finished in this tick
+    if (tracker_.update(status, picked_action, sequence, sample_time_ns))
+    {
+        events |= static_cast<unsigned int>(StatusEventType::ACTION_COMPLETED);
+        if (publish)
+        {
+            event.type_ = StatusEventType::ACTION_COMPLETED;
+            event.completion_ = tracker_.completion();
+            hub.publish(event);
+        }
+    }
+
+    return events;
+}
@@ -0,0 +1,169 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2023, KR Soft s.r.o.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the Kassow Robots nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#include "weiss_gripkit/stroke_model.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+#define STROKE_MODEL_MAGIC 0x53544b47
+#define STROKE_MODEL_VERSION 2
+
+using namespace kswx_weiss_gripkit;
+
+
+void StrokeStats::add(double stroke_ms)
+{
+    ++count_;
+    double delta = stroke_ms - mean_ms_;
+    mean_ms_ += delta / count_;
+    m2_ += delta * (stroke_ms - mean_ms_);
+
+    int bin = static_cast<int>(stroke_ms / STROKE_HISTOGRAM_BIN_MS);
+    ++histogram_[std::max(0, std::min(bin, STROKE_HISTOGRAM_BINS - 1))];
+}
+
+double StrokeStats::percentile(double p) const
+{
+    if (count_ == 0)
+        return 0.0;
+
+    uint64_t rank = static_cast<uint64_t>(std::ceil(p / 100.0 * count_));
+    uint64_t cumulative = 0;
+    for (int bin = 0; bin < STROKE_HISTOGRAM_BINS; ++bin)
+    {
+        cumulative += histogram_[bin];
+        if (cumulative >= rank && cumulative > 0)
+            return (bin + 1) * STROKE_HISTOGRAM_BIN_MS;
+    }
+    return STROKE_HISTOGRAM_BINS * STROKE_HISTOGRAM_BIN_MS;
+}
+
+uint32_t StrokeStats::deadlineMs() const
+{
+    if (count_ < STROKE_MIN_SAMPLES)
+        return 0;
+
+    double deadline_ms = percentile(99) * STROKE_DEADLINE_MARGIN + STROKE_DEADLINE_SLACK_MS;
+    return static_cast<uint32_t>(std::max(deadline_ms, static_cast<double>(STROKE_DEADLINE_MIN_MS)));
+}
+
+StrokeModel::StrokeModel()
+:   grip_holding_(),
+    grip_no_part_(),
+    release_()
+{}
+
+bool StrokeModel::learn(const ActionCompletion& completion)
+{
+    if (completion.result_ != ActionResult::DONE || !completion.moved_)
+        return false;
+
+    double stroke_ms = completion.duration_ns_ * 1e-6;
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (completion.action_ == GripkitAction::RELEASE)
+        release_.add(stroke_ms);
+    else
+        (completion.status_ == GripkitCrEasyStatus::NO_PART ? grip_no_part_ : grip_holding_).add(stroke_ms);
+    return true;
+}
+
+StrokeStats StrokeModel::stats(GripkitAction action, GripkitCrEasyStatus final_status) const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (action != GripkitAction::GRIP)
+        return release_;
+    return (final_status == GripkitCrEasyStatus::NO_PART) ? grip_no_part_ : grip_holding_;
+}
+
+StrokeDeadlines StrokeModel::deadlines() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    // a grip may end either way, an outcome not learned yet is covered by a wide margin on the learned one
+    uint32_t holding_ms = grip_holding_.deadlineMs();
+    uint32_t no_part_ms = grip_no_part_.deadlineMs();
+    uint32_t grip_ms = std::max(holding_ms, no_part_ms);
+    if (grip_ms > 0 && (holding_ms == 0 || no_part_ms == 0))
+        grip_ms = static_cast<uint32_t>(grip_ms * STROKE_UNLEARNED_GRIP_FACTOR);
+
+    return StrokeDeadlines{ grip_ms, release_.deadlineMs() };
+}
+
+bool StrokeModel::load(const std::string& path)
+{
+    FILE* file = fopen(path.c_str(), "rb");
+    if (!file)
+        return false;
+
+    uint32_t header[2] = { 0, 0 };
+    StrokeStats grip_holding;
+    StrokeStats grip_no_part;
+    StrokeStats release;
+    bool ok = fread(header, sizeof(header), 1, file) == 1 && header[0] == STROKE_MODEL_MAGIC && header[1] == STROKE_MODEL_VERSION
+        && fread(&grip_holding, sizeof(grip_holding), 1, file) == 1 && fread(&grip_no_part, sizeof(grip_no_part), 1, file) == 1
+        && fread(&release, sizeof(release), 1, file) == 1;
+    fclose(file);
+
+    if (ok)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        grip_holding_ = grip_holding;
+        grip_no_part_ = grip_no_part;
+        release_ = release;
+    }
+    return ok;
+}
+
+bool StrokeModel::save(const std::string& path) const
+{
+    StrokeStats grip_holding = stats(GripkitAction::GRIP, GripkitCrEasyStatus::HOLDING);
+    StrokeStats grip_no_part = stats(GripkitAction::GRIP, GripkitCrEasyStatus::NO_PART);
+    StrokeStats release = stats(GripkitAction::RELEASE);
+
+    // write to temporary file and rename, so that a crash never leaves a truncated file
+    std::string temporary_path = path + ".tmp";
+    FILE* file = fopen(temporary_path.c_str(), "wb");
+    if (!file)
+        return false;
+
+    uint32_t header[2] = { STROKE_MODEL_MAGIC, STROKE_MODEL_VERSION };
+    bool ok = fwrite(header, sizeof(header), 1, file) == 1 && fwrite(&grip_holding, sizeof(grip_holding), 1, file) == 1
+        && fwrite(&grip_no_part, sizeof(grip_no_part), 1, file) == 1 && fwrite(&release, sizeof(release), 1, file) == 1;
+    ok = (fclose(file) == 0) && ok;
+
+    return ok && rename(temporary_path.c_str(), path.c_str()) == 0;
+}
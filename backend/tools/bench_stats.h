@@ -0,0 +1,117 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2023, KR Soft s.r.o.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the Kassow Robots nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#ifndef KR2_CBUN_TOOLS_BENCH_STATS
+#define KR2_CBUN_TOOLS_BENCH_STATS
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+#include <time.h>
+
+namespace kswx_weiss_gripkit {
+
+    /// @brief Collects samples and reports mean, percentiles and max. For host-side tools only.
+    class SampleStats
+    {
+    public:
+        inline void add(double value) { values_.push_back(value); sorted_ = false; }
+
+        inline size_t count() const { return values_.size(); }
+
+        inline double mean() const
+        {
+            if (values_.empty())
+                return 0.0;
+            double sum = 0.0;
+            for (double value : values_)
+                sum += value;
+            return sum / values_.size();
+        }
+
+        /// @brief Get percentile by nearest rank.
+        /// @param p percentile in range 0-100
+        inline double percentile(double p)
+        {
+            if (values_.empty())
+                return 0.0;
+            sort();
+            size_t rank = static_cast<size_t>(p / 100.0 * (values_.size() - 1) + 0.5);
+            return values_[std::min(rank, values_.size() - 1)];
+        }
+
+        inline double max()
+        {
+            return values_.empty() ? 0.0 : (sort(), values_.back());
+        }
+
+        /// @brief Print one line: label, count, mean, p50, p90, p99, max.
+        inline void print(const char* label, const char* unit)
+        {
+            printf("%-28s n=%-8zu mean=%-10.3f p50=%-10.3f p90=%-10.3f p99=%-10.3f max=%-10.3f [%s]\n",
+                label, count(), mean(), percentile(50), percentile(90), percentile(99), max(), unit);
+        }
+
+    private:
+        inline void sort()
+        {
+            if (!sorted_)
+                std::sort(values_.begin(), values_.end());
+            sorted_ = true;
+        }
+
+        std::vector<double> values_;
+        bool sorted_ = true;
+    };
+
+    /// @brief CLOCK_MONOTONIC in nanoseconds.
+    inline uint64_t monotonicNs()
+    {
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return static_cast<uint64_t>(ts.tv_sec) * 1000000000ULL + static_cast<uint64_t>(ts.tv_nsec);
+    }
+
+    /// @brief CPU time of the whole process in nanoseconds.
+    inline uint64_t processCpuNs()
+    {
+        struct timespec ts;
+        clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+        return static_cast<uint64_t>(ts.tv_sec) * 1000000000ULL + static_cast<uint64_t>(ts.tv_nsec);
+    }
+
+} // namespace kswx_weiss_gripkit
+
+#endif // KR2_CBUN_TOOLS_BENCH_STATS
@@ -0,0 +1,320 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2023, KR Soft s.r.o.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the Kassow Robots nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+// Benchmark of the binary control channel against XML-RPC. Measures round trip latency and throughput of STATUS requests,
+// acknowledge latency of GRIP/RELEASE requests and the latency from a request to the status change event of a subscriber.
+// With --simulate the tool serves the control channel itself from a simulated gripper, so that it runs without a robot.
+// With --xmlrpc the same number of getStatus calls is sent to the CBun XML-RPC server for comparison, one HTTP connection
+// per call.
+//
+// usage: weiss_gripkit_control_bench [--socket PATH] [--simulate] [--count N] [--actions N] [--xmlrpc HOST:PORT]
+
+#include "weiss_gripkit/control_channel.h"
+#include "weiss_gripkit/gripkit_logic.h"
+#include "weiss_gripkit/periodic_thread.h"
+#include "weiss_gripkit/simulated_io.h"
+#include "bench_stats.h"
+
+#include <arpa/inet.h>
+#include <cstdlib>
+#include <cstring>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <string>
+#include <sys/socket.h>
+#include <unistd.h>
+
+// CONTROL_SOCKET_FILE of the CBun
+#define DEFAULT_CONTROL_SOCKET "/var/tmp/kswx_weiss_gripkit.gkeasy.sock"
+#define SIMULATED_DUID_GRIPPED 1
+#define SIMULATED_DUID_NO_ERROR 2
+
+using namespace kswx_weiss_gripkit;
+
+
+/// @brief Control channel server backed by a simulated gripper, ticking every 10 ms like the CBun status monitor.
+class SimulatedControlServer
+{
+public:
+    SimulatedControlServer() :
+    gripper_(SimulatedGripper::Config()),
+    io_data_(SIMULATED_DUID_GRIPPED, SIMULATED_DUID_NO_ERROR),
+    requested_(static_cast<int>(GripkitAction::NONE)),
+    status_(static_cast<int>(GripkitCrEasyStatus::IDLE_OR_ERROR)),
+    sequence_(0),
+    last_status_(GripkitCrEasyStatus::IDLE_OR_ERROR),
+    start_ns_(monotonicNs()),
+    thread_([] {}, [this] { tick(); }, 10)
+    {}
+
+    bool start(const std::string& path)
+    {
+        bool started = server_.start(path, [this](const ControlRequest& request, ControlMessage& response) { handle(request, response); });
+        return started && thread_.start(500);
+    }
+
+    void stop()
+    {
+        thread_.stop(500);
+        server_.stop();
+    }
+
+private:
+    void handle(const ControlRequest& request, ControlMessage& response)
+    {
+        if (request.command == static_cast<uint8_t>(ControlCommand::GRIP))
+            requested_ = static_cast<int>(GripkitAction::GRIP);
+        else if (request.command == static_cast<uint8_t>(ControlCommand::RELEASE))
+            requested_ = static_cast<int>(GripkitAction::RELEASE);
+
+        response.result = static_cast<uint8_t>(ControlResult::OK);
+        response.status = static_cast<uint8_t>(status_.load());
+        response.sequence = sequence_.load();
+    }
+
+    void tick()
+    {
+        double time_s = (monotonicNs() - start_ns_) * 1e-9;
+
+        GripkitAction action = static_cast<GripkitAction>(requested_.exchange(static_cast<int>(GripkitAction::NONE)));
+        if (action != GripkitAction::NONE)
+            gripper_.setGrip(action == GripkitAction::GRIP, time_s);
+
+        float gripped_voltage, no_error_voltage;
+        gripper_.sample(time_s, gripped_voltage, no_error_voltage);
+        io_data_.setInputs(gripped_voltage, no_error_voltage);
+
+        GripkitSample sample;
+        sample.timestamp_ns_ = 0;
+        sample.monotonic_ns_ = monotonicNs();
+        readSample(io_data_, SIMULATED_DUID_GRIPPED, SIMULATED_DUID_NO_ERROR, sample);
+        GripkitCrEasyStatus status = decodeStatus(sample);
+
+        status_ = static_cast<int>(status);
+        uint64_t sequence = ++sequence_;
+        if (status != last_status_)
+            server_.publish(static_cast<uint8_t>(status), sequence, sample.monotonic_ns_);
+        last_status_ = status;
+    }
+
+    SimulatedGripper gripper_;
+    SimulatedIOData io_data_;
+    std::atomic<int> requested_;
+    std::atomic<int> status_;
+    std::atomic<uint64_t> sequence_;
+    GripkitCrEasyStatus last_status_;
+    uint64_t start_ns_;
+    ControlServer server_;
+    PeriodicThread thread_;
+};
+
+static void benchStatus(const std::string& path, int count)
+{
+    ControlClient client;
+    if (!client.connect(path))
+    {
+        fprintf(stderr, "Unable to connect to %s\n", path.c_str());
+        return;
+    }
+
+    SampleStats latency;
+    ControlMessage response;
+    uint64_t start_ns = monotonicNs();
+    for (int i = 0; i < count; ++i)
+    {
+        uint64_t call_ns = monotonicNs();
+        if (!client.call(ControlCommand::STATUS, response))
+        {
+            fprintf(stderr, "Control channel call failed\n");
+            return;
+        }
+        latency.add((monotonicNs() - call_ns) * 1e-3);
+    }
+    double elapsed_s = (monotonicNs() - start_ns) * 1e-9;
+
+    latency.print("control STATUS round trip", "us");
+    printf("%-28s %.0f [calls/s]\n", "control STATUS throughput", count / elapsed_s);
+}
+
+static void benchActions(const std::string& path, int count)
+{
+    ControlClient client, subscriber;
+    ControlMessage response;
+    if (!client.connect(path) || !subscriber.connect(path) || !subscriber.call(ControlCommand::SUBSCRIBE, response))
+    {
+        fprintf(stderr, "Unable to connect to %s\n", path.c_str());
+        return;
+    }
+
+    SampleStats acknowledge, completion;
+    int lost = 0;
+    for (int i = 0; i < count; ++i)
+    {
+        bool grip = (i % 2 == 0);
+        uint64_t call_ns = monotonicNs();
+        if (!client.call(grip ? ControlCommand::GRIP : ControlCommand::RELEASE, response) ||
+            response.result != static_cast<uint8_t>(ControlResult::OK))
+        {
+            fprintf(stderr, "%s request failed, result %d\n", grip ? "GRIP" : "RELEASE", response.result);
+            return;
+        }
+        acknowledge.add((monotonicNs() - call_ns) * 1e-3);
+
+        // wait for the final status of the stroke, intermediate statuses (IDLE_OR_ERROR) are skipped
+        ControlMessage event;
+        bool done = false;
+        while (!done && subscriber.waitEvent(event, 2000))
+        {
+            GripkitCrEasyStatus status = static_cast<GripkitCrEasyStatus>(event.status);
+            done = grip ? (status == GripkitCrEasyStatus::HOLDING || status == GripkitCrEasyStatus::NO_PART)
+                        : (status == GripkitCrEasyStatus::RELEASED);
+        }
+        if (done)
+            completion.add((monotonicNs() - call_ns) * 1e-6);
+        else
+            ++lost;
+    }
+
+    acknowledge.print("control action acknowledge", "us");
+    completion.print("control action to event", "ms");
+    printf("%-28s %d\n", "control actions w/o event", lost);
+}
+
+/// @brief One XML-RPC getStatus call over a new TCP connection.
+static bool callXmlRpc(const struct sockaddr_in& address, const std::string& request)
+{
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0)
+        return false;
+
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+    bool ok = (connect(fd, reinterpret_cast<const struct sockaddr*>(&address), sizeof(address)) == 0) &&
+              (send(fd, request.data(), request.size(), MSG_NOSIGNAL) == static_cast<ssize_t>(request.size()));
+
+    // read until the server closes the connection (HTTP/1.0)
+    char buffer[4096];
+    ssize_t received = 0;
+    while (ok && (received = recv(fd, buffer, sizeof(buffer), 0)) > 0) {}
+    ::close(fd);
+
+    return ok && received == 0;
+}
+
+static void benchXmlRpc(const std::string& host_port, int count)
+{
+    size_t colon = host_port.find(':');
+    struct sockaddr_in address;
+    std::memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    if (colon == std::string::npos || inet_pton(AF_INET, host_port.substr(0, colon).c_str(), &address.sin_addr) != 1)
+    {
+        fprintf(stderr, "Invalid XML-RPC address %s, expected IPV4:PORT\n", host_port.c_str());
+        return;
+    }
+    address.sin_port = htons(static_cast<uint16_t>(atoi(host_port.substr(colon + 1).c_str())));
+
+    std::string body = "<?xml version=\"1.0\"?><methodCall><methodName>getStatus</methodName><params></params></methodCall>";
+    std::string request = "POST /RPC2 HTTP/1.0\r\nContent-Type: text/xml\r\nContent-Length: " + std::to_string(body.size()) + "\r\n\r\n" + body;
+
+    SampleStats latency;
+    uint64_t start_ns = monotonicNs();
+    for (int i = 0; i < count; ++i)
+    {
+        uint64_t call_ns = monotonicNs();
+        if (!callXmlRpc(address, request))
+        {
+            fprintf(stderr, "XML-RPC call failed\n");
+            return;
+        }
+        latency.add((monotonicNs() - call_ns) * 1e-3);
+    }
+    double elapsed_s = (monotonicNs() - start_ns) * 1e-9;
+
+    latency.print("xmlrpc getStatus round trip", "us");
+    printf("%-28s %.0f [calls/s]\n", "xmlrpc getStatus throughput", count / elapsed_s);
+}
+
+int main(int argc, char** argv)
+{
+    std::string path = DEFAULT_CONTROL_SOCKET;
+    std::string xmlrpc;
+    bool simulate = false;
+    int count = 10000;
+    int actions = 20;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        if (arg == "--socket" && i + 1 < argc)
+            path = argv[++i];
+        else if (arg == "--simulate")
+            simulate = true;
+        else if (arg == "--count" && i + 1 < argc)
+            count = atoi(argv[++i]);
+        else if (arg == "--actions" && i + 1 < argc)
+            actions = atoi(argv[++i]);
+        else if (arg == "--xmlrpc" && i + 1 < argc)
+            xmlrpc = argv[++i];
+        else
+        {
+            fprintf(stderr, "usage: %s [--socket PATH] [--simulate] [--count N] [--actions N] [--xmlrpc HOST:PORT]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    SimulatedControlServer server;
+    if (simulate)
+    {
+        path = "/tmp/weiss_gripkit_control_bench." + std::to_string(getpid()) + ".sock";
+        if (!server.start(path))
+        {
+            fprintf(stderr, "Unable to start simulated control channel on %s\n", path.c_str());
+            return 1;
+        }
+    }
+
+    if (count > 0)
+        benchStatus(path, count);
+    if (actions > 0)
+        benchActions(path, actions);
+    if (!xmlrpc.empty() && count > 0)
+        benchXmlRpc(xmlrpc, count);
+
+    if (simulate)
+        server.stop();
+
+    return 0;
+}
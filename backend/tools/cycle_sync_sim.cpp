@@ -0,0 +1,122 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2023, KR Soft s.r.o.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the Kassow Robots nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+// Simulation of cycle synchronized sampling against a simulated controller clock. Runs the status monitor wait free running
+// and synchronized to the controller I/O cycle and reports the age of the sampled I/O data, the monitor period and the number
+// of extra I/O reads spent on phase acquisition.
+//
+// --cycle-us sets the simulated controller cycle, --nominal-us the cycle CycleSync expects (default same).
+//
+// usage: weiss_gripkit_cycle_sync_sim [--ticks N] [--period-ms MS] [--cycle-us US] [--nominal-us US] [--drift-ppm PPM] [--jitter-us US] [--seed N]
+
+#include "weiss_gripkit/cycle_sync.h"
+#include "weiss_gripkit/simulated_io.h"
+#include "bench_stats.h"
+
+#include <cstdlib>
+#include <string>
+
+using namespace kswx_weiss_gripkit;
+
+
+static void run(const char* label, bool synchronized, const SimulatedControllerClock::Config& config, int period_ms, int nominal_cycle_us, int ticks)
+{
+    SimulatedControllerClock clock(config);
+    CycleSync<SimulatedClockSource, SimulatedIOProbe> sync(SimulatedClockSource{ &clock }, SimulatedIOProbe{ &clock }, period_ms, nominal_cycle_us);
+    sync.setEnabled(synchronized);
+
+    SampleStats age, period;
+    uint64_t last_sample_ns = 0;
+    for (int i = 0; i < ticks; ++i)
+    {
+        // the monitor cycle: read the I/O data, process it, wait
+        clock.read();
+        age.add((clock.nowNs() - clock.lastUpdateNs()) * 1e-3);
+        if (last_sample_ns > 0)
+            period.add((clock.nowNs() - last_sample_ns) * 1e-3);
+        last_sample_ns = clock.nowNs();
+
+        clock.advanceNs(20000);
+        sync.wait();
+    }
+
+    CycleSyncStats stats = sync.stats();
+    printf("%s\n", label);
+    age.print("  sample age", "us");
+    period.print("  monitor period", "us");
+    printf("  locked=%d stopped=%d measured cycle=%.1f us acquisitions=%llu failures=%llu extra reads per tick=%.3f\n",
+        stats.locked_ ? 1 : 0, stats.stopped_ ? 1 : 0, stats.measured_cycle_ns_ * 1e-3,
+        static_cast<unsigned long long>(stats.acquisitions_), static_cast<unsigned long long>(stats.failures_),
+        static_cast<double>(stats.probes_) / ticks);
+}
+
+int main(int argc, char** argv)
+{
+    SimulatedControllerClock::Config config;
+    int ticks = 10000;
+    int period_ms = 10;
+    int nominal_cycle_us = 0;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        if (arg == "--ticks" && i + 1 < argc)
+            ticks = atoi(argv[++i]);
+        else if (arg == "--period-ms" && i + 1 < argc)
+            period_ms = atoi(argv[++i]);
+        else if (arg == "--cycle-us" && i + 1 < argc)
+            config.cycle_us = atof(argv[++i]);
+        else if (arg == "--nominal-us" && i + 1 < argc)
+            nominal_cycle_us = atoi(argv[++i]);
+        else if (arg == "--drift-ppm" && i + 1 < argc)
+            config.drift_ppm = atof(argv[++i]);
+        else if (arg == "--jitter-us" && i + 1 < argc)
+            config.wake_jitter_us = atof(argv[++i]);
+        else if (arg == "--seed" && i + 1 < argc)
+            config.seed = static_cast<unsigned int>(atoi(argv[++i]));
+        else
+        {
+            fprintf(stderr, "usage: %s [--ticks N] [--period-ms MS] [--cycle-us US] [--nominal-us US] [--drift-ppm PPM] [--jitter-us US] [--seed N]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    if (nominal_cycle_us <= 0)
+        nominal_cycle_us = static_cast<int>(config.cycle_us);
+
+    run("free running", false, config, period_ms, nominal_cycle_us, ticks);
+    run("cycle synchronized", true, config, period_ms, nominal_cycle_us, ticks);
+
+    return 0;
+}
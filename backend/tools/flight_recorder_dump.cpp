@@ -0,0 +1,119 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2023, KR Soft s.r.o.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the Kassow Robots nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+// Convert a flight recorder ring file to CSV.
+//
+// usage: weiss_gripkit_flight_dump <file> [--from UNIX_S] [--to UNIX_S] [--last SECONDS]
+
+#include "weiss_gripkit/flight_recorder.h"
+#include "weiss_gripkit/gripkit_types.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+using namespace kswx_weiss_gripkit;
+
+
+static void printUsage(const char* name)
+{
+    std::cerr << "usage: " << name << " <file> [--from UNIX_S] [--to UNIX_S] [--last SECONDS]" << std::endl
+              << "  --from UNIX_S    first timestamp to dump, seconds since epoch" << std::endl
+              << "  --to UNIX_S      last timestamp to dump, seconds since epoch" << std::endl
+              << "  --last SECONDS   dump only the last SECONDS before the newest record" << std::endl;
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 2)
+    {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    std::string path = argv[1];
+    double from_s = -1.0;
+    double to_s = -1.0;
+    double last_s = -1.0;
+
+    for (int i = 2; i < argc; ++i)
+    {
+        if (i + 1 < argc && strcmp(argv[i], "--from") == 0)
+            from_s = atof(argv[++i]);
+        else if (i + 1 < argc && strcmp(argv[i], "--to") == 0)
+            to_s = atof(argv[++i]);
+        else if (i + 1 < argc && strcmp(argv[i], "--last") == 0)
+            last_s = atof(argv[++i]);
+        else
+        {
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+
+    std::vector<FlightRecord> records;
+    if (!FlightRecorder::read(path, records))
+    {
+        std::cerr << "Unable to read flight recorder file " << path << std::endl;
+        return 1;
+    }
+
+    uint64_t from_ns = (from_s >= 0.0) ? static_cast<uint64_t>(from_s * 1e9) : 0;
+    uint64_t to_ns = (to_s >= 0.0) ? static_cast<uint64_t>(to_s * 1e9) : UINT64_MAX;
+    if (last_s >= 0.0 && !records.empty())
+    {
+        uint64_t newest_ns = records.back().timestamp_ns;
+        uint64_t last_ns = static_cast<uint64_t>(last_s * 1e9);
+        from_ns = (newest_ns > last_ns) ? newest_ns - last_ns : 0;
+    }
+
+    printf("time_s,request_id,gripped_voltage,no_error_voltage,status,action\n");
+    for (const FlightRecord& record : records)
+    {
+        if (record.timestamp_ns < from_ns || record.timestamp_ns > to_ns)
+            continue;
+
+        printf("%llu.%09llu,%llu,%.3f,%.3f,%s,%s\n",
+            static_cast<unsigned long long>(record.timestamp_ns / 1000000000ULL),
+            static_cast<unsigned long long>(record.timestamp_ns % 1000000000ULL),
+            static_cast<unsigned long long>(record.request_id),
+            record.gripped_voltage,
+            record.no_error_voltage,
+            toString(static_cast<GripkitCrEasyStatus>(record.status)),
+            toString(static_cast<GripkitAction>(record.action)));
+    }
+
+    return 0;
+}
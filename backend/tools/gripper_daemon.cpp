@@ -0,0 +1,162 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2023, KR Soft s.r.o.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the Kassow Robots nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+// Standalone gripper daemon: runs the status monitor of the CBun (sampling, status publishing, request execution, stroke learning,
+// signal health) in its own process with its own scheduling class, on the shared memory segments the CBun would create.
+// Sequences use it unchanged. The I/O backend of this build is the simulated gripper,
+// so the daemon refuses to serve the CBun's segments (the default --prefix) unless --simulate confirms that a simulated gripper
+// may stand in for the real one; other prefixes are served for tests and benchmarks.
+//
+// --fifo runs the monitor thread with SCHED_FIFO at the given priority (needs CAP_SYS_NICE) and locks the process memory, --cpu pins
+// it to one CPU. --seconds 0 runs until SIGINT or SIGTERM. A status line is printed every --report-ms, 0 disables it.
+//
+// usage: weiss_gripkit_daemon [--prefix ID] [--simulate] [--period-ms MS] [--fifo PRIO] [--cpu N] [--seconds S] [--report-ms MS]
+//                             [--stroke-file PATH] [--sim-stroke-ms MS] [--sim-no-part P] [--sim-noise V] [--seed N]
+
+#include "weiss_gripkit/gripper_daemon.h"
+
+#include <atomic>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <sys/mman.h>
+#include <unistd.h>
+
+using namespace kswx_weiss_gripkit;
+
+
+static std::atomic<int> stop_requested(0);
+
+static void onSignal(int)
+{
+    stop_requested = 1;
+}
+
+int main(int argc, char** argv)
+{
+    DaemonConfig config;
+    SimulatedGripper::Config gripper_config;
+    gripper_config.seed = static_cast<unsigned int>(getpid());
+    double seconds = 0.0;
+    int report_ms = 1000;
+    bool simulate = false;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        if (arg == "--prefix" && i + 1 < argc)
+            config.prefix = argv[++i];
+        else if (arg == "--simulate")
+            simulate = true;
+        else if (arg == "--period-ms" && i + 1 < argc)
+            config.period_ms = atoi(argv[++i]);
+        else if (arg == "--fifo" && i + 1 < argc)
+            config.fifo_priority = atoi(argv[++i]);
+        else if (arg == "--cpu" && i + 1 < argc)
+            config.cpu = atoi(argv[++i]);
+        else if (arg == "--seconds" && i + 1 < argc)
+            seconds = atof(argv[++i]);
+        else if (arg == "--report-ms" && i + 1 < argc)
+            report_ms = atoi(argv[++i]);
+        else if (arg == "--stroke-file" && i + 1 < argc)
+            config.stroke_model_file = argv[++i];
+        else if (arg == "--sim-stroke-ms" && i + 1 < argc)
+            gripper_config.stroke_s = atof(argv[++i]) * 1e-3;
+        else if (arg == "--sim-no-part" && i + 1 < argc)
+            gripper_config.no_part_probability = atof(argv[++i]);
+        else if (arg == "--sim-noise" && i + 1 < argc)
+            gripper_config.noise_v = atof(argv[++i]);
+        else if (arg == "--seed" && i + 1 < argc)
+            gripper_config.seed = static_cast<unsigned int>(atoi(argv[++i]));
+        else
+        {
+            fprintf(stderr, "usage: %s [--prefix ID] [--simulate] [--period-ms MS] [--fifo PRIO] [--cpu N] [--seconds S] [--report-ms MS] [--stroke-file PATH] "
+                "[--sim-stroke-ms MS] [--sim-no-part P] [--sim-noise V] [--seed N]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    if (config.period_ms <= 0)
+        config.period_ms = DAEMON_PERIOD_MS;
+
+    // the CBun would report the simulated state as the real gripper and never drive its pins
+    if (config.prefix == DAEMON_SHM_PREFIX && !simulate)
+    {
+        fprintf(stderr, "The I/O backend of this build is the simulated gripper, pass --simulate to serve it as the gripper of %s\n",
+            config.prefix.c_str());
+        return 1;
+    }
+
+    // no page faults in the monitor thread once it runs with a realtime priority
+    if (config.fifo_priority > 0 && mlockall(MCL_CURRENT | MCL_FUTURE) != 0)
+        fprintf(stderr, "mlockall failed, continuing without locked memory\n");
+
+    struct sigaction action;
+    action.sa_handler = onSignal;
+    sigemptyset(&action.sa_mask);
+    action.sa_flags = 0;
+    sigaction(SIGINT, &action, NULL);
+    sigaction(SIGTERM, &action, NULL);
+
+    SimulatedGripperIO io(gripper_config);
+    GripperDaemon daemon(config, &io);
+    if (!daemon.start())
+    {
+        fprintf(stderr, "Unable to start, is another daemon serving %s?\n", config.prefix.c_str());
+        return 1;
+    }
+
+    printf("serving %s, %s I/O, period %d ms\n", config.prefix.c_str(), io.name(), config.period_ms);
+    fflush(stdout);
+
+    uint64_t start_ns = monotonicNowNs();
+    uint64_t next_report_ns = start_ns + static_cast<uint64_t>(report_ms) * 1000000ULL;
+    while (!stop_requested.load() && (seconds <= 0.0 || (monotonicNowNs() - start_ns) * 1e-9 < seconds))
+    {
+        usleep(10000);
+        if (report_ms > 0 && monotonicNowNs() >= next_report_ns)
+        {
+            next_report_ns += static_cast<uint64_t>(report_ms) * 1000000ULL;
+            DaemonState state = daemon.state();
+            printf("status %-13s ticks %8llu overruns %5llu actions %6llu%s\n", toString(state.status_),
+                static_cast<unsigned long long>(state.ticks_), static_cast<unsigned long long>(state.overruns_),
+                static_cast<unsigned long long>(state.action_count_), state.realtime_ ? " fifo" : "");
+            fflush(stdout);
+        }
+    }
+
+    daemon.stop();
+    return 0;
+}
@@ -0,0 +1,385 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2023, KR Soft s.r.o.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the Kassow Robots nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+// Benchmark of the status monitor timing: runs BasicValueMonitor with a trivial cycle at several periods, waiting with
+// FixedSleepWait (sleep after each cycle) and with CycleSync (synchronized to a 1 ms I/O cycle derived from CLOCK_MONOTONIC,
+// as the CBun does), while other threads generate CPU, memory bandwidth or syscall load. Reports per configuration:
+//
+//   jitter       |sample interval - period|
+//   latency      wake-up later than the time the wait asked for
+//   overruns     sample intervals longer than METRICS_OVERRUN_FACTOR periods, as counted by the CBun metrics
+//
+// --threads sets the number of load threads per load kind (default number of CPUs), --fifo runs the monitor thread with
+// SCHED_FIFO at the given priority (needs CAP_SYS_NICE).
+//
+// usage: weiss_gripkit_jitter_bench [--periods MS,MS] [--loads none,cpu,mem,syscall,all] [--waits sleep,sync] [--seconds S]
+//                                   [--threads N] [--fifo PRIO]
+
+#include "weiss_gripkit/value_monitor.h"
+#include "weiss_gripkit/cycle_sync.h"
+#include "weiss_gripkit/metrics.h"
+#include "bench_stats.h"
+
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/syscall.h>
+
+#define JITTER_IO_CYCLE_US 1000
+#define JITTER_WARMUP_TICKS 3
+#define JITTER_MEMORY_BYTES (32 * 1024 * 1024)
+
+using namespace kswx_weiss_gripkit;
+
+
+/// @brief Sample and wake-up times of one run, preallocated so that the monitor thread does not allocate.
+struct JitterRecorder
+{
+    inline explicit JitterRecorder(size_t capacity) : count_(0), fifo_priority_(0), fifo_failed_(false)
+    {
+        sample_ns_.resize(capacity);
+        latency_ns_.resize(capacity);
+    }
+
+    inline void sample()
+    {
+        if (count_ < sample_ns_.size())
+            sample_ns_[count_++] = monotonicNs();
+    }
+
+    /// @brief Called after each wait with the time the wait asked for.
+    inline void woke(uint64_t target_ns)
+    {
+        uint64_t now_ns = monotonicNs();
+        if (count_ < latency_ns_.size())
+            latency_ns_[count_] = (now_ns > target_ns) ? now_ns - target_ns : 0;
+    }
+
+    std::vector<uint64_t> sample_ns_;
+    std::vector<uint64_t> latency_ns_;
+    size_t count_;
+    int fifo_priority_;
+    bool fifo_failed_;
+};
+
+/// @brief Trivial monitor cycle, records the sample time.
+struct JitterPolicy
+{
+    inline int getValue() { recorder_->sample(); return 0; }
+    inline void onValueChanged(int) {}
+    inline void onTick(int) {}
+
+    JitterRecorder* recorder_;
+};
+
+/// @brief FixedSleepWait of the monitor, recording the wake-up latency.
+struct RecordingSleepWait
+{
+    inline void operator()()
+    {
+        uint64_t target_ns = monotonicNs() + wait_.sleep_ms_ * 1000000ULL;
+        wait_();
+        recorder_->woke(target_ns);
+    }
+
+    FixedSleepWait wait_;
+    JitterRecorder* recorder_;
+};
+
+/// @brief MonotonicClockSource remembering the last sleep target.
+struct RecordingClockSource
+{
+    inline uint64_t nowNs() { return clock_.nowNs(); }
+    inline void sleepUntilNs(uint64_t time_ns) { *target_ns_ = time_ns; clock_.sleepUntilNs(time_ns); }
+
+    MonotonicClockSource clock_;
+    uint64_t* target_ns_;
+};
+
+/// @brief I/O data that changes every JITTER_IO_CYCLE_US of CLOCK_MONOTONIC, stands in for the controller I/O.
+struct MonotonicIOProbe
+{
+    inline uint64_t operator()() { return monotonicNs() / (JITTER_IO_CYCLE_US * 1000ULL); }
+};
+
+typedef CycleSync<RecordingClockSource, MonotonicIOProbe> JitterCycleSync;
+
+/// @brief CycleSync wait of the monitor, recording the wake-up latency.
+struct RecordingSyncWait
+{
+    inline void operator()()
+    {
+        sync_->wait();
+        recorder_->woke(*target_ns_);
+    }
+
+    JitterCycleSync* sync_;
+    uint64_t* target_ns_;
+    JitterRecorder* recorder_;
+};
+
+/// @brief Policy setting SCHED_FIFO on the monitor thread during init.
+struct FifoJitterPolicy : JitterPolicy
+{
+    inline int getValue()
+    {
+        if (recorder_->fifo_priority_ > 0 && recorder_->count_ == 0)
+        {
+            struct sched_param param;
+            memset(&param, 0, sizeof(param));
+            param.sched_priority = recorder_->fifo_priority_;
+            recorder_->fifo_failed_ = (pthread_setschedparam(pthread_self(), SCHED_FIFO, &param) != 0);
+        }
+        return JitterPolicy::getValue();
+    }
+};
+
+/// @brief Load threads of one kind.
+class LoadThreads
+{
+public:
+    inline LoadThreads() : stop_(false) {}
+
+    inline ~LoadThreads() { stop(); }
+
+    /// @param kind "none", "cpu", "mem", "syscall" or "all" (threads of each kind)
+    void start(const std::string& kind, int threads)
+    {
+        stop_ = false;
+        for (int i = 0; i < threads; ++i)
+        {
+            if (kind == "cpu" || kind == "all")
+                threads_.emplace_back([this]() { cpuLoad(); });
+            if (kind == "mem" || kind == "all")
+                threads_.emplace_back([this]() { memoryLoad(); });
+            if (kind == "syscall" || kind == "all")
+                threads_.emplace_back([this]() { syscallLoad(); });
+        }
+    }
+
+    void stop()
+    {
+        stop_ = true;
+        for (std::thread& thread : threads_)
+            thread.join();
+        threads_.clear();
+    }
+
+private:
+    void cpuLoad()
+    {
+        volatile double value = 1.0;
+        while (!stop_)
+        {
+            for (int i = 0; i < 10000; ++i)
+                value = std::sqrt(value * 1.000001 + 1.0);
+        }
+    }
+
+    void memoryLoad()
+    {
+        std::vector<char> source(JITTER_MEMORY_BYTES, 1);
+        std::vector<char> destination(JITTER_MEMORY_BYTES, 0);
+        while (!stop_)
+        {
+            memcpy(destination.data(), source.data(), JITTER_MEMORY_BYTES);
+            source[destination[JITTER_MEMORY_BYTES / 2] & 0xff] ^= 1;
+        }
+    }
+
+    void syscallLoad()
+    {
+        while (!stop_)
+        {
+            for (int i = 0; i < 100; ++i)
+                syscall(SYS_getppid);
+            sched_yield();
+        }
+    }
+
+    std::atomic<bool> stop_;
+    std::vector<std::thread> threads_;
+};
+
+template <typename monitor_t>
+static bool runMonitor(monitor_t& monitor, int seconds)
+{
+    if (!monitor.start(1000))
+        return false;
+    usleep(seconds * 1000000);
+    return monitor.stop(1000);
+}
+
+static void report(const std::string& wait, int period_ms, const std::string& load, const JitterRecorder& recorder)
+{
+    SampleStats jitter, latency;
+    double period_us = period_ms * 1000.0;
+    double min_interval_us = 0.0, max_interval_us = 0.0;
+    uint64_t overruns = 0;
+    for (size_t i = JITTER_WARMUP_TICKS + 1; i < recorder.count_; ++i)
+    {
+        double interval_us = (recorder.sample_ns_[i] - recorder.sample_ns_[i - 1]) * 1e-3;
+        jitter.add(std::fabs(interval_us - period_us));
+        latency.add(recorder.latency_ns_[i - 1] * 1e-3);
+        if (interval_us > METRICS_OVERRUN_FACTOR * period_us)
+            ++overruns;
+        if (min_interval_us == 0.0 || interval_us < min_interval_us)
+            min_interval_us = interval_us;
+        max_interval_us = std::max(max_interval_us, interval_us);
+    }
+
+    printf("wait=%s period=%d ms load=%s%s\n", wait.c_str(), period_ms, load.c_str(), recorder.fifo_failed_ ? " (SCHED_FIFO failed)" : "");
+    jitter.print("  jitter", "us");
+    latency.print("  wake-up latency", "us");
+    printf("  interval min=%.3f max=%.3f [us] overruns=%llu\n", min_interval_us, max_interval_us, static_cast<unsigned long long>(overruns));
+}
+
+static std::vector<std::string> splitList(const std::string& list)
+{
+    std::vector<std::string> items;
+    std::istringstream stream(list);
+    std::string item;
+    while (std::getline(stream, item, ','))
+    {
+        if (!item.empty())
+            items.push_back(item);
+    }
+    return items;
+}
+
+int main(int argc, char** argv)
+{
+    std::string periods = "1,5,10";
+    std::string loads = "none,cpu,mem,syscall,all";
+    std::string waits = "sleep,sync";
+    int seconds = 5;
+    int threads = static_cast<int>(std::thread::hardware_concurrency());
+    int fifo_priority = 0;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        if (arg == "--periods" && i + 1 < argc)
+            periods = argv[++i];
+        else if (arg == "--loads" && i + 1 < argc)
+            loads = argv[++i];
+        else if (arg == "--waits" && i + 1 < argc)
+            waits = argv[++i];
+        else if (arg == "--seconds" && i + 1 < argc)
+            seconds = atoi(argv[++i]);
+        else if (arg == "--threads" && i + 1 < argc)
+            threads = atoi(argv[++i]);
+        else if (arg == "--fifo" && i + 1 < argc)
+            fifo_priority = atoi(argv[++i]);
+        else
+        {
+            fprintf(stderr, "usage: %s [--periods MS,MS] [--loads none,cpu,mem,syscall,all] [--waits sleep,sync] [--seconds S] [--threads N] [--fifo PRIO]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    if (seconds <= 0)
+        seconds = 5;
+    if (threads <= 0)
+        threads = 1;
+
+    printf("load threads per kind %d, %d s per configuration\n", threads, seconds);
+
+    for (const std::string& load : splitList(loads))
+    {
+        if (load != "none" && load != "cpu" && load != "mem" && load != "syscall" && load != "all")
+        {
+            fprintf(stderr, "unknown load %s\n", load.c_str());
+            return 1;
+        }
+
+        LoadThreads load_threads;
+        load_threads.start(load, threads);
+
+        for (const std::string& period : splitList(periods))
+        {
+            int period_ms = atoi(period.c_str());
+            if (period_ms <= 0)
+                continue;
+
+            // twice the nominal number of samples, the monitor never allocates
+            size_t capacity = static_cast<size_t>(seconds) * 1000 / period_ms * 2 + 16;
+
+            for (const std::string& wait : splitList(waits))
+            {
+                JitterRecorder recorder(capacity);
+                recorder.fifo_priority_ = fifo_priority;
+                FifoJitterPolicy policy;
+                policy.recorder_ = &recorder;
+                bool stopped = false;
+
+                if (wait == "sleep")
+                {
+                    BasicValueMonitor<int, FifoJitterPolicy, RecordingSleepWait> monitor(policy, RecordingSleepWait{ FixedSleepWait{ period_ms }, &recorder });
+                    stopped = runMonitor(monitor, seconds);
+                }
+                else if (wait == "sync")
+                {
+                    uint64_t target_ns = 0;
+                    JitterCycleSync sync(RecordingClockSource{ MonotonicClockSource(), &target_ns }, MonotonicIOProbe(), period_ms, JITTER_IO_CYCLE_US);
+                    BasicValueMonitor<int, FifoJitterPolicy, RecordingSyncWait> monitor(policy, RecordingSyncWait{ &sync, &target_ns, &recorder });
+                    stopped = runMonitor(monitor, seconds);
+                }
+                else
+                {
+                    fprintf(stderr, "unknown wait %s\n", wait.c_str());
+                    return 1;
+                }
+
+                if (!stopped)
+                {
+                    fprintf(stderr, "monitor did not start or stop, wait=%s period=%d ms load=%s\n", wait.c_str(), period_ms, load.c_str());
+                    return 1;
+                }
+
+                report(wait, period_ms, load, recorder);
+            }
+        }
+
+        load_threads.stop();
+    }
+
+    return 0;
+}
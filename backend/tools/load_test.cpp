@@ -0,0 +1,387 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2023, KR Soft s.r.o.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the Kassow Robots nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+// Multi-process load test of the gripper request protocol. Forks N simulated sequence processes issuing randomized blocking and
+// non-blocking grip/release requests through the same submitAction/waitForAction code as GripkitCrEasy, against real
+// SharedMemoryObject segments served by a simulated status monitor and gripper in the parent process. Reports throughput,
+// interruption rate, requests overwritten before the monitor picked them up and blocking latency percentiles per N.
+// With --lease K each process takes the GripperLease for K requests (a pick), reports lease waits and timeouts.
+// With --daemon ID the processes use the segments of a running weiss_gripkit_daemon instead of the simulated monitor; --stroke-ms
+// then has no effect and the lease columns accumulate over the runs.
+//
+// usage: weiss_gripkit_load_test [--procs N[,N...]] [--seconds S] [--stroke-ms MS] [--think-ms MS] [--blocking P] [--lease K] [--seed N]
+//                                [--daemon ID]
+
+#include "weiss_gripkit/action_request.h"
+#include "weiss_gripkit/gripper_daemon.h"
+#include "weiss_gripkit/gripper_lease.h"
+#include "weiss_gripkit/simulated_io.h"
+#include "weiss_gripkit/value_monitor.h"
+#include "bench_stats.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <random>
+#include <sstream>
+#include <string>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <vector>
+
+#define LOAD_TEST_MAX_PROCS 64
+#define LOAD_TEST_LATENCY_BINS 5000
+#define LOAD_TEST_DUID_GRIPPED 1
+#define LOAD_TEST_DUID_NO_ERROR 2
+#define LOAD_TEST_LEASE_TIMEOUT_MS 200
+
+using namespace kswx_weiss_gripkit;
+
+
+/// @brief Counters of one sequence process, in memory shared with the parent.
+struct ProcessResult
+{
+    uint64_t requests;
+    uint64_t blocking;
+    uint64_t done;
+    uint64_t interrupted;
+    uint64_t failed;
+
+    /// @brief blocking latency histogram, 1 ms bins, longer latencies count to the last bin
+    uint32_t latency_ms[LOAD_TEST_LATENCY_BINS];
+};
+
+/// @brief Run control and results, in memory shared with the parent.
+struct LoadTestRun
+{
+    std::atomic<int> start;
+    std::atomic<int> stop;
+    ProcessResult results[LOAD_TEST_MAX_PROCS];
+};
+
+struct LoadTestConfig
+{
+    double seconds = 2.0;
+    double stroke_ms = 50.0;
+    int think_ms = 20;
+    double blocking_probability = 0.5;
+    int lease_requests = 0;
+    unsigned int seed = 1;
+
+    /// @brief segment prefix of a running daemon, empty to simulate the monitor
+    std::string daemon_prefix;
+};
+
+/// @brief Shared memory segments of one run, same layout as GripkitCrEasy uses.
+struct LoadTestSegments
+{
+    explicit LoadTestSegments(const std::string& prefix) :
+    action_(prefix + ".action"), request_id_(prefix + ".request_increment"), status_(prefix + ".status"), stroke_(prefix + ".stroke"),
+    lease_(prefix + ".lease") {}
+
+    void create() { action_.create(); request_id_.create(); status_.create(); stroke_.create(); lease_.create(); action_.getData()->set(GripkitAction::NONE); }
+    bool attach() { return action_.attach() && request_id_.attach() && status_.attach() && stroke_.attach() && lease_.attach(); }
+    void destroy() { action_.destroy(); request_id_.destroy(); status_.destroy(); stroke_.destroy(); lease_.destroy(); }
+
+    ActionChannel channel() { return ActionChannel{ action_.getData(), request_id_.getData(), status_.getData(), stroke_.getData() }; }
+
+    SharedMemoryObject<SynchronizedData<GripkitAction>> action_;
+    SharedMemoryObject<SynchronizedIncrement> request_id_;
+    SharedMemoryObject<SynchronizedData<PublishedStatus>> status_;
+    SharedMemoryObject<SynchronizedData<StrokeDeadlines>> stroke_;
+    SharedMemoryObject<GripperLease> lease_;
+};
+
+/// @brief Body of a forked sequence process.
+static void runSequence(const std::string& prefix, LoadTestRun* run, int index, const LoadTestConfig& config)
+{
+    LoadTestSegments segments(prefix);
+    if (!segments.attach())
+    {
+        fprintf(stderr, "sequence %d: unable to attach to %s\n", index, prefix.c_str());
+        _exit(1);
+    }
+    ActionChannel channel = segments.channel();
+    ProcessResult& result = run->results[index];
+
+    std::mt19937 random(config.seed * 1000 + index);
+    std::uniform_real_distribution<double> uniform(0.0, 1.0);
+
+    while (!run->start.load())
+        usleep(100);
+
+    GripperLease* lease = segments.lease_.getData();
+    int leased_requests = 0;
+
+    while (!run->stop.load())
+    {
+        // take the lease for a pick of lease_requests requests, the way a sequence would around its grip/release calls
+        if (config.lease_requests > 0 && leased_requests == 0)
+        {
+            if (lease->acquire(getpid(), 0, LEASE_DURATION_MS, LOAD_TEST_LEASE_TIMEOUT_MS) != LeaseResult::GRANTED)
+                continue;
+            leased_requests = config.lease_requests;
+        }
+
+        GripkitAction action = (uniform(random) < 0.5) ? GripkitAction::GRIP : GripkitAction::RELEASE;
+        bool blocking = uniform(random) < config.blocking_probability;
+
+        uint64_t start_ns = monotonicNowNs();
+        uint64_t request_number = submitAction(channel, action);
+        ++result.requests;
+
+        if (blocking)
+        {
+            ++result.blocking;
+            ActionWaitInfo info;
+            ActionOutcome outcome = waitForAction(channel, action, request_number, 1000, info);
+            if (outcome == ActionOutcome::DONE)
+                ++result.done;
+            else if (outcome == ActionOutcome::INTERRUPTED)
+                ++result.interrupted;
+            else
+                ++result.failed;
+
+            uint64_t latency_ms = (monotonicNowNs() - start_ns) / 1000000;
+            ++result.latency_ms[std::min<uint64_t>(latency_ms, LOAD_TEST_LATENCY_BINS - 1)];
+        }
+
+        if (config.lease_requests > 0 && --leased_requests == 0)
+            lease->release(getpid());
+
+        if (config.think_ms > 0)
+            usleep(static_cast<useconds_t>(uniform(random) * config.think_ms * 1000));
+    }
+
+    if (leased_requests > 0)
+        lease->release(getpid());
+}
+
+/// @brief Latency percentile from the merged histogram in ms.
+static double percentile(const std::vector<uint64_t>& histogram, uint64_t total, double p)
+{
+    uint64_t rank = static_cast<uint64_t>(p / 100.0 * total + 0.5);
+    uint64_t seen = 0;
+    for (size_t i = 0; i < histogram.size(); ++i)
+    {
+        seen += histogram[i];
+        if (seen >= rank && seen > 0)
+            return static_cast<double>(i + 1);
+    }
+    return 0.0;
+}
+
+static bool runLoad(int procs, const LoadTestConfig& config)
+{
+    bool daemon_mode = !config.daemon_prefix.empty();
+    std::string prefix = daemon_mode ? config.daemon_prefix : "weiss_gripkit_load." + std::to_string(getpid()) + "." + std::to_string(procs);
+    LoadTestSegments segments(prefix);
+    SharedMemoryObject<SynchronizedData<DaemonState>> daemon(prefix + ".daemon");
+    if (daemon_mode)
+    {
+        if (!segments.attach() || !daemon.attach())
+            return false;
+    }
+    else
+    {
+        segments.create();
+    }
+
+    void* address = mmap(NULL, sizeof(LoadTestRun), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (address == MAP_FAILED)
+    {
+        if (!daemon_mode)
+            segments.destroy();
+        return false;
+    }
+    LoadTestRun* run = new (address) LoadTestRun();
+    run->start = 0;
+    run->stop = 0;
+
+    // fork before the monitor thread exists, so that children never inherit a lock held by it
+    std::vector<pid_t> children;
+    for (int i = 0; i < procs; ++i)
+    {
+        pid_t pid = fork();
+        if (pid == 0)
+        {
+            runSequence(prefix, run, i, config);
+            _exit(0);
+        }
+        if (pid > 0)
+            children.push_back(pid);
+    }
+
+    // simulated master instance: status monitor publishing status and executing requests like GripkitCrEasy::onTick
+    SimulatedGripper::Config gripper_config;
+    gripper_config.stroke_s = config.stroke_ms * 1e-3;
+    gripper_config.seed = config.seed;
+    SimulatedGripper gripper(gripper_config);
+    SimulatedIOData io_data(LOAD_TEST_DUID_GRIPPED, LOAD_TEST_DUID_NO_ERROR);
+    ActionChannel channel = segments.channel();
+    uint64_t start_ns = monotonicNowNs();
+    uint64_t sequence = 0;
+    uint64_t picked = 0;
+
+    auto policy = makeMonitorPolicy<GripkitCrEasyStatus>(
+        [&]() {
+            GripkitSample sample;
+            sample.timestamp_ns_ = 0;
+            sample.monotonic_ns_ = monotonicNowNs();
+            float gripped_voltage, no_error_voltage;
+            gripper.sample((sample.monotonic_ns_ - start_ns) * 1e-9, gripped_voltage, no_error_voltage);
+            io_data.setInputs(gripped_voltage, no_error_voltage);
+            readSample(io_data, LOAD_TEST_DUID_GRIPPED, LOAD_TEST_DUID_NO_ERROR, sample);
+            return decodeStatus(sample);
+        },
+        [](GripkitCrEasyStatus) {},
+        [&](GripkitCrEasyStatus status) {
+            uint64_t now_ns = monotonicNowNs();
+            channel.status_->set(PublishedStatus{ status, ++sequence, now_ns, now_ns });
+            GripkitAction action = channel.action_->exchange(GripkitAction::NONE);
+            if (action != GripkitAction::NONE)
+            {
+                ++picked;
+                gripper.setGrip(action == GripkitAction::GRIP, (now_ns - start_ns) * 1e-9);
+            }
+        });
+    BasicValueMonitor<GripkitCrEasyStatus, decltype(policy)> monitor(policy, 10);
+    uint64_t daemon_actions = 0;
+    if (daemon_mode)
+        daemon_actions = daemon.getData()->get().action_count_;
+    else
+        monitor.start(500);
+
+    run->start = 1;
+    usleep(static_cast<useconds_t>(config.seconds * 1e6));
+    run->stop = 1;
+
+    for (pid_t pid : children)
+        waitpid(pid, NULL, 0);
+    double elapsed_s = (monotonicNowNs() - start_ns) * 1e-9;
+    if (daemon_mode)
+        picked = daemon.getData()->get().action_count_ - daemon_actions;
+    else
+        monitor.stop(500);
+
+    // aggregate
+    ProcessResult total;
+    std::memset(&total, 0, sizeof(total));
+    std::vector<uint64_t> histogram(LOAD_TEST_LATENCY_BINS, 0);
+    uint64_t max_ms = 0;
+    for (int i = 0; i < procs; ++i)
+    {
+        const ProcessResult& result = run->results[i];
+        total.requests += result.requests;
+        total.blocking += result.blocking;
+        total.done += result.done;
+        total.interrupted += result.interrupted;
+        total.failed += result.failed;
+        for (int bin = 0; bin < LOAD_TEST_LATENCY_BINS; ++bin)
+        {
+            histogram[bin] += result.latency_ms[bin];
+            if (result.latency_ms[bin] > 0)
+                max_ms = std::max<uint64_t>(max_ms, bin + 1);
+        }
+    }
+
+    uint64_t lost = (total.requests > picked) ? total.requests - picked : 0;
+    LeaseStats lease = segments.lease_.getData()->stats();
+    printf("%5d %10.1f %10llu %10.1f %10.1f %8llu %8.1f %8.1f %8.1f %8llu %10.1f %10.1f %8llu\n", procs,
+        total.requests / elapsed_s,
+        static_cast<unsigned long long>(total.requests),
+        total.blocking ? 100.0 * total.interrupted / total.blocking : 0.0,
+        total.requests ? 100.0 * lost / total.requests : 0.0,
+        static_cast<unsigned long long>(total.failed),
+        percentile(histogram, total.blocking, 50), percentile(histogram, total.blocking, 90), percentile(histogram, total.blocking, 99),
+        static_cast<unsigned long long>(max_ms),
+        lease.wait_.count_ ? lease.wait_.sum_ / lease.wait_.count_ * 1e3 : 0.0, lease.max_wait_ns_ * 1e-6,
+        static_cast<unsigned long long>(lease.timeouts_));
+
+    munmap(address, sizeof(LoadTestRun));
+    if (!daemon_mode)
+        segments.destroy();
+    return true;
+}
+
+int main(int argc, char** argv)
+{
+    LoadTestConfig config;
+    std::vector<int> procs = { 1, 2, 4, 8, 16, 32, 64 };
+
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        if (arg == "--procs" && i + 1 < argc)
+        {
+            procs.clear();
+            std::stringstream list(argv[++i]);
+            std::string item;
+            while (std::getline(list, item, ','))
+                procs.push_back(std::max(1, std::min(LOAD_TEST_MAX_PROCS, atoi(item.c_str()))));
+        }
+        else if (arg == "--seconds" && i + 1 < argc)
+            config.seconds = atof(argv[++i]);
+        else if (arg == "--stroke-ms" && i + 1 < argc)
+            config.stroke_ms = atof(argv[++i]);
+        else if (arg == "--think-ms" && i + 1 < argc)
+            config.think_ms = atoi(argv[++i]);
+        else if (arg == "--blocking" && i + 1 < argc)
+            config.blocking_probability = atof(argv[++i]);
+        else if (arg == "--lease" && i + 1 < argc)
+            config.lease_requests = std::max(0, atoi(argv[++i]));
+        else if (arg == "--seed" && i + 1 < argc)
+            config.seed = static_cast<unsigned int>(atoi(argv[++i]));
+        else if (arg == "--daemon" && i + 1 < argc)
+            config.daemon_prefix = argv[++i];
+        else
+        {
+            fprintf(stderr, "usage: %s [--procs N[,N...]] [--seconds S] [--stroke-ms MS] [--think-ms MS] [--blocking P] [--lease K] [--seed N] "
+                "[--daemon ID]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    printf("%5s %10s %10s %10s %10s %8s %8s %8s %8s %8s %10s %10s %8s\n", "procs", "req/s", "requests", "interr_%", "lost_%", "failed",
+        "p50_ms", "p90_ms", "p99_ms", "max_ms", "lease_ms", "lease_max", "lease_to");
+    for (int n : procs)
+    {
+        if (!runLoad(n, config))
+        {
+            fprintf(stderr, "Unable to set up run with %d processes\n", n);
+            return 1;
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,145 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2023, KR Soft s.r.o.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the Kassow Robots nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+// Offline check of a gripper macro. Parses the macro like the defineMacro XML-RPC method and runs it repeatedly with MacroRunner
+// against a simulated gripper in simulated time, one status monitor tick per --period-ms. Reports the outcome of the runs and
+// their duration in monitor ticks, --trace prints step, status and action of every tick of the first run.
+//
+// usage: weiss_gripkit_macro_sim "MACRO" [--runs N] [--period-ms MS] [--stroke-ms MS] [--no-part P] [--seed N] [--trace]
+
+#include "weiss_gripkit/gripper_macro.h"
+#include "weiss_gripkit/gripkit_logic.h"
+#include "weiss_gripkit/simulated_io.h"
+#include "bench_stats.h"
+
+#include <cstdlib>
+#include <map>
+#include <string>
+
+#define SIM_DUID_GRIPPED 1
+#define SIM_DUID_NO_ERROR 2
+#define SIM_MAX_TICKS_PER_RUN 100000
+
+using namespace kswx_weiss_gripkit;
+
+
+int main(int argc, char** argv)
+{
+    std::string text;
+    int runs = 100;
+    int period_ms = 10;
+    bool trace = false;
+    SimulatedGripper::Config gripper_config;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        if (arg == "--runs" && i + 1 < argc)
+            runs = atoi(argv[++i]);
+        else if (arg == "--period-ms" && i + 1 < argc)
+            period_ms = std::max(1, atoi(argv[++i]));
+        else if (arg == "--stroke-ms" && i + 1 < argc)
+            gripper_config.stroke_s = atof(argv[++i]) * 1e-3;
+        else if (arg == "--no-part" && i + 1 < argc)
+            gripper_config.no_part_probability = atof(argv[++i]);
+        else if (arg == "--seed" && i + 1 < argc)
+            gripper_config.seed = static_cast<unsigned int>(atoi(argv[++i]));
+        else if (arg == "--trace")
+            trace = true;
+        else if (text.empty() && arg.compare(0, 2, "--") != 0)
+            text = arg;
+        else
+            text.clear(), i = argc;
+    }
+
+    if (text.empty())
+    {
+        fprintf(stderr, "usage: %s \"MACRO\" [--runs N] [--period-ms MS] [--stroke-ms MS] [--no-part P] [--seed N] [--trace]\n", argv[0]);
+        return 1;
+    }
+
+    MacroProgram program;
+    std::string error;
+    if (!parseMacro(text, program, error))
+    {
+        fprintf(stderr, "Invalid macro: %s\n", error.c_str());
+        return 1;
+    }
+    printf("macro: %s (%d steps)\n", formatMacro(program).c_str(), program.step_count_);
+
+    SimulatedGripper gripper(gripper_config);
+    SimulatedIOData io_data(SIM_DUID_GRIPPED, SIM_DUID_NO_ERROR);
+    MacroRunner runner;
+    SampleStats ticks;
+    std::map<std::string, int> outcomes;
+    uint64_t now_ns = 1000000000ULL;
+
+    for (int run = 1; run <= runs; ++run)
+    {
+        runner.start(program, run, now_ns);
+        MacroState state = MacroState::RUNNING;
+        for (int tick = 0; tick < SIM_MAX_TICKS_PER_RUN && state == MacroState::RUNNING; ++tick)
+        {
+            // the monitor tick: sample, decode, run the macro, apply its action
+            GripkitSample sample;
+            float gripped_voltage, no_error_voltage;
+            gripper.sample(now_ns * 1e-9, gripped_voltage, no_error_voltage);
+            io_data.setInputs(gripped_voltage, no_error_voltage);
+            readSample(io_data, SIM_DUID_GRIPPED, SIM_DUID_NO_ERROR, sample);
+            GripkitCrEasyStatus status = decodeStatus(sample);
+
+            int step = runner.step();
+            GripkitAction action;
+            state = runner.tick(status, now_ns, action);
+            if (action != GripkitAction::NONE)
+                gripper.setGrip(action == GripkitAction::GRIP, now_ns * 1e-9);
+
+            if (trace && run == 1)
+                printf("  tick %4d step %2d %-14s %-8s %s\n", tick, step, toString(status), toString(action), toString(state));
+
+            now_ns += period_ms * 1000000ULL;
+        }
+
+        if (state == MacroState::RUNNING)
+            runner.interrupt();
+        ++outcomes[toString(runner.state())];
+        ticks.add(runner.ticks());
+    }
+
+    for (const auto& outcome : outcomes)
+        printf("%-12s %d\n", outcome.first.c_str(), outcome.second);
+    ticks.print("ticks per run", "ticks");
+    printf("mean duration per run %.1f ms\n", ticks.mean() * period_ms);
+    return 0;
+}
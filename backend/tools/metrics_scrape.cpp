@@ -0,0 +1,177 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2023, KR Soft s.r.o.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the Kassow Robots nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+// Scrape the OpenMetrics exporter of the master instance and print the text. --self-test runs an exporter in this process with a
+// writer publishing synthetic snapshots as fast as possible, scrapes it concurrently and checks every scrape for torn snapshots.
+//
+// usage: weiss_gripkit_metrics [--socket PATH] [--self-test SECONDS]
+
+#include "weiss_gripkit/metrics.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <thread>
+#include <unistd.h>
+
+#define METRICS_DEFAULT_SOCKET "/var/tmp/kswx_weiss_gripkit.gkeasy.metrics.sock"
+
+using namespace kswx_weiss_gripkit;
+
+
+static bool scrape(const std::string& path, std::string& text)
+{
+    struct sockaddr_un address;
+    std::memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    std::strncpy(address.sun_path, path.c_str(), sizeof(address.sun_path) - 1);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0 || connect(fd, reinterpret_cast<struct sockaddr*>(&address), sizeof(address)) != 0)
+    {
+        if (fd >= 0)
+            close(fd);
+        return false;
+    }
+
+    text.clear();
+    char buffer[4096];
+    ssize_t size;
+    while ((size = read(fd, buffer, sizeof(buffer))) > 0)
+        text.append(buffer, size);
+    close(fd);
+    return true;
+}
+
+/// @brief Value of a sample line "name value" in OpenMetrics text, -1 if not found.
+static double sampleValue(const std::string& text, const std::string& name)
+{
+    size_t position = text.find("\n" + name + " ");
+    if (position == std::string::npos)
+        return -1.0;
+    return atof(text.c_str() + position + name.size() + 2);
+}
+
+static int selfTest(double seconds)
+{
+    std::string socket_path = "/tmp/weiss_gripkit_metrics_test." + std::to_string(getpid()) + ".sock";
+    std::string textfile_path = "/tmp/weiss_gripkit_metrics_test." + std::to_string(getpid()) + ".prom";
+
+    MetricsBuffer buffer;
+    MetricsExporter exporter;
+    if (!exporter.start(&buffer, textfile_path, socket_path))
+    {
+        fprintf(stderr, "Unable to start exporter on %s\n", socket_path.c_str());
+        return 1;
+    }
+
+    // writer: every counter of a snapshot equals the tick count, a scrape mixing two snapshots shows different values
+    std::atomic<bool> stop(false);
+    std::atomic<uint64_t> published(0);
+    std::thread writer([&]() {
+        MetricsSnapshot snapshot = MetricsSnapshot();
+        while (!stop)
+        {
+            ++snapshot.ticks_;
+            snapshot.grip_actions_ = snapshot.ticks_;
+            snapshot.faults_ = snapshot.ticks_;
+            snapshot.tick_duration_.add(15e-6, METRICS_TICK_BOUNDS_S);
+            if (buffer.publish(snapshot))
+                ++published;
+        }
+    });
+
+    uint64_t scrapes = 0, torn = 0, failed = 0;
+    auto end = std::chrono::steady_clock::now() + std::chrono::milliseconds(static_cast<int>(seconds * 1000));
+    std::string text;
+    while (std::chrono::steady_clock::now() < end)
+    {
+        if (!scrape(socket_path, text))
+        {
+            ++failed;
+            continue;
+        }
+        ++scrapes;
+
+        double ticks = sampleValue(text, "weiss_gripkit_monitor_ticks_total");
+        if (ticks < 0)
+            continue;
+        if (sampleValue(text, "weiss_gripkit_faults_total") != ticks || sampleValue(text, "weiss_gripkit_monitor_tick_duration_seconds_count") != ticks)
+            ++torn;
+    }
+
+    stop = true;
+    writer.join();
+    exporter.stop();
+
+    bool textfile = (access(textfile_path.c_str(), R_OK) == 0);
+    unlink(textfile_path.c_str());
+
+    printf("scrapes=%llu torn=%llu failed=%llu published=%llu skipped=%llu textfile=%s\n",
+        static_cast<unsigned long long>(scrapes), static_cast<unsigned long long>(torn), static_cast<unsigned long long>(failed),
+        static_cast<unsigned long long>(published.load()), static_cast<unsigned long long>(buffer.skipped()), textfile ? "yes" : "no");
+    return (torn == 0 && scrapes > 0 && textfile) ? 0 : 1;
+}
+
+int main(int argc, char** argv)
+{
+    std::string socket_path = METRICS_DEFAULT_SOCKET;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        if (arg == "--socket" && i + 1 < argc)
+            socket_path = argv[++i];
+        else if (arg == "--self-test" && i + 1 < argc)
+            return selfTest(atof(argv[++i]));
+        else
+        {
+            fprintf(stderr, "usage: %s [--socket PATH] [--self-test SECONDS]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    std::string text;
+    if (!scrape(socket_path, text))
+    {
+        fprintf(stderr, "Unable to connect to %s\n", socket_path.c_str());
+        return 1;
+    }
+    fputs(text.c_str(), stdout);
+    return 0;
+}
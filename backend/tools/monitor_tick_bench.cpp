@@ -0,0 +1,142 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2023, KR Soft s.r.o.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the Kassow Robots nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+// Microbenchmark of the ValueMonitor tick cost: type-erased ValueMonitor (std::function callbacks) against BasicValueMonitor
+// with callables stored by value and with a policy class. Also counts heap allocations made by each construction.
+//
+// usage: weiss_gripkit_monitor_bench [ITERATIONS]
+
+#include "weiss_gripkit/value_monitor.h"
+#include "bench_stats.h"
+
+#include <cstdlib>
+#include <new>
+
+using namespace kswx_weiss_gripkit;
+
+
+static std::atomic<uint64_t> allocation_count(0);
+
+void* operator new(size_t size)
+{
+    ++allocation_count;
+    void* pointer = malloc(size);
+    if (!pointer)
+        throw std::bad_alloc();
+    return pointer;
+}
+
+void operator delete(void* pointer) noexcept
+{
+    free(pointer);
+}
+
+void operator delete(void* pointer, size_t) noexcept
+{
+    free(pointer);
+}
+
+/// @brief Trivial monitored object, value changes every 64 ticks.
+struct Counter
+{
+    inline int getValue() { return static_cast<int>(++ticks_ >> 6); }
+    inline void onValueChanged(int) { ++changes_; }
+    inline void onTick(int value) { sum_ += value; }
+
+    uint64_t ticks_ = 0;
+    uint64_t changes_ = 0;
+    uint64_t sum_ = 0;
+};
+
+/// @brief Policy calling Counter, the way GripkitCrEasy binds its monitor.
+struct CounterPolicy
+{
+    inline int getValue() { return counter_->getValue(); }
+    inline void onValueChanged(int value) { counter_->onValueChanged(value); }
+    inline void onTick(int value) { counter_->onTick(value); }
+
+    Counter* counter_;
+};
+
+template <typename monitor_t>
+static void benchTicks(const char* label, monitor_t& monitor, Counter& counter, uint64_t allocations, int iterations)
+{
+    monitor.init();
+    uint64_t start_ns = monotonicNs();
+    for (int i = 0; i < iterations; ++i)
+        monitor.cycle();
+    double tick_ns = static_cast<double>(monotonicNs() - start_ns) / iterations;
+
+    printf("%-28s %8.2f [ns/tick] %4llu [allocations on construction] (changes %llu)\n", label, tick_ns,
+        static_cast<unsigned long long>(allocations), static_cast<unsigned long long>(counter.changes_));
+}
+
+int main(int argc, char** argv)
+{
+    int iterations = (argc > 1) ? atoi(argv[1]) : 10000000;
+    if (iterations <= 0)
+        iterations = 10000000;
+
+    {
+        Counter counter;
+        Counter* counter_ptr = &counter;
+        uint64_t allocations_before = allocation_count;
+        ValueMonitor<int> monitor(
+            [counter_ptr]() { return counter_ptr->getValue(); },
+            [counter_ptr](int value) { counter_ptr->onValueChanged(value); },
+            [counter_ptr](int value) { counter_ptr->onTick(value); }, 10);
+        benchTicks("ValueMonitor (std::function)", monitor, counter, allocation_count - allocations_before, iterations);
+    }
+
+    {
+        Counter counter;
+        Counter* counter_ptr = &counter;
+        uint64_t allocations_before = allocation_count;
+        auto policy = makeMonitorPolicy<int>(
+            [counter_ptr]() { return counter_ptr->getValue(); },
+            [counter_ptr](int value) { counter_ptr->onValueChanged(value); },
+            [counter_ptr](int value) { counter_ptr->onTick(value); });
+        BasicValueMonitor<int, decltype(policy)> monitor(policy, 10);
+        benchTicks("BasicValueMonitor (lambdas)", monitor, counter, allocation_count - allocations_before, iterations);
+    }
+
+    {
+        Counter counter;
+        uint64_t allocations_before = allocation_count;
+        BasicValueMonitor<int, CounterPolicy> monitor(CounterPolicy{ &counter }, 10);
+        benchTicks("BasicValueMonitor (policy)", monitor, counter, allocation_count - allocations_before, iterations);
+    }
+
+    return 0;
+}
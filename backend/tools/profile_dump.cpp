@@ -0,0 +1,113 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2023, KR Soft s.r.o.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the Kassow Robots nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+// Print the hot-path stage histograms of a CBun built with WEISS_GRIPKIT_PROFILE.
+// --self-test profiles a loop of clock reads into a private histogram, to check the timer overhead on the target.
+//
+// usage: weiss_gripkit_profile_dump [--histogram] [--self-test]
+
+#include "weiss_gripkit/profiler.h"
+#include "weiss_gripkit/shared_memory.h"
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+// SHM_GLOBAL_ID of the CBun
+#define PROFILE_SHM_ID "kswx_weiss_gripkit.gkeasy.profile"
+
+using namespace kswx_weiss_gripkit;
+
+
+static void print(const ProfileData& profile, bool bins)
+{
+    printf("%-16s %10s %10s %10s %10s %10s\n", "stage", "count", "mean_us", "p50_us", "p99_us", "max_us");
+    for (int i = 0; i < static_cast<int>(ProfileStage::COUNT); ++i)
+    {
+        const StageHistogram& histogram = profile.stages_[i];
+        printf("%-16s %10llu %10.3f %10.3f %10.3f %10.3f\n", toString(static_cast<ProfileStage>(i)),
+            static_cast<unsigned long long>(histogram.count()), histogram.meanNs() * 1e-3,
+            histogram.percentileNs(50) * 1e-3, histogram.percentileNs(99) * 1e-3, histogram.maxNs() * 1e-3);
+
+        if (bins)
+        {
+            for (int bin = 0; bin < PROFILE_HISTOGRAM_BINS; ++bin)
+            {
+                uint64_t count = histogram.bins_[bin].load(std::memory_order_relaxed);
+                if (count > 0)
+                    printf("    < %12llu ns %10llu\n", 2ULL << bin, static_cast<unsigned long long>(count));
+            }
+        }
+    }
+}
+
+int main(int argc, char** argv)
+{
+    bool bins = false;
+    bool self_test = false;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (strcmp(argv[i], "--histogram") == 0)
+            bins = true;
+        else if (strcmp(argv[i], "--self-test") == 0)
+            self_test = true;
+        else
+        {
+            fprintf(stderr, "usage: %s [--histogram] [--self-test]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    if (self_test)
+    {
+        // empty scopes measure the cost of the timer itself
+        ProfileData profile;
+        for (int i = 0; i < 1000000; ++i)
+        {
+            ScopedStageTimer timer(&profile, ProfileStage::TICK);
+        }
+        print(profile, bins);
+        return 0;
+    }
+
+    SharedMemoryObject<ProfileData> shm_profile(PROFILE_SHM_ID);
+    if (!shm_profile.attach())
+    {
+        fprintf(stderr, "Unable to open %s, is the CBun built with WEISS_GRIPKIT_PROFILE and created?\n", PROFILE_SHM_ID);
+        return 1;
+    }
+    print(*shm_profile.getData(), bins);
+
+    return 0;
+}
@@ -0,0 +1,214 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2023, KR Soft s.r.o.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the Kassow Robots nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+// Benchmark of RpcService, the admission and statistics layer every XML-RPC handler of GripkitCrEasy runs through: N threads
+// call simulated getStatus, setGripper and setGripperBlocking handlers through RpcService::call, blocking calls hold their
+// thread for a simulated stroke. Reports per N the call rate, the getStatus latency including the RpcService overhead and
+// rejected calls (blocking calls beyond RPC_LONG_RUNNING_CALLS are rejected by design). The threads stand in for callers, not
+// for the SDK XML-RPC transport: the transport, its threading and the network are not part of the measurement, so the
+// results bound the service overhead and the long-running admission only, not the number of clients a controller sustains.
+//
+// usage: weiss_gripkit_rpc_bench [--clients N,N] [--seconds S] [--think-ms MS] [--stroke-ms MS] [--blocking P] [--commands P]
+//                                [--seed N]
+
+#include "weiss_gripkit/rpc_service.h"
+#include "bench_stats.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+using namespace kswx_weiss_gripkit;
+
+
+struct RpcBenchConfig
+{
+    double seconds = 2.0;
+    int think_ms = 10;
+    int stroke_ms = 100;
+    double blocking_probability = 0.02;
+    double command_probability = 0.1;
+    unsigned int seed = 1;
+};
+
+/// @brief Simulated device state behind the handlers.
+struct SimulatedDevice
+{
+    std::mutex mutex_;
+    int status_ = 0;
+    std::atomic<int> action_{ 0 };
+};
+
+/// @brief Counters of one client thread.
+struct ClientResult
+{
+    std::vector<double> status_ms_;
+    uint64_t calls_ = 0;
+    uint64_t busy_ = 0;
+    uint64_t blocking_busy_ = 0;
+};
+
+static void runClient(RpcService& service, SimulatedDevice& device, const int* methods, const RpcBenchConfig& config, int index,
+    std::atomic<bool>& stop, ClientResult& result)
+{
+    std::mt19937 random(config.seed * 1000 + index);
+    std::uniform_real_distribution<double> uniform(0.0, 1.0);
+    SimulatedDevice* simulated = &device;
+    int stroke_ms = config.stroke_ms;
+
+    while (!stop)
+    {
+        double pick = uniform(random);
+        int value = 0;
+        uint64_t start_ns = monotonicNs();
+        RpcOutcome outcome;
+        bool blocking = pick < config.blocking_probability;
+
+        if (blocking)
+        {
+            outcome = service.call<int>(methods[2], [simulated, stroke_ms]() { simulated->action_ = 1; usleep(stroke_ms * 1000); return 1; },
+                value, true);
+        }
+        else if (pick < config.blocking_probability + config.command_probability)
+        {
+            outcome = service.call<int>(methods[1], [simulated]() { simulated->action_ = 1; return 1; }, value, false);
+        }
+        else
+        {
+            outcome = service.call<int>(methods[0], [simulated]() { std::lock_guard<std::mutex> lock(simulated->mutex_); return simulated->status_; },
+                value, false);
+            if (outcome == RpcOutcome::OK)
+                result.status_ms_.push_back((monotonicNs() - start_ns) * 1e-6);
+        }
+
+        ++result.calls_;
+        if (outcome == RpcOutcome::BUSY)
+            ++(blocking ? result.blocking_busy_ : result.busy_);
+
+        if (config.think_ms > 0)
+            usleep(config.think_ms * 1000);
+    }
+}
+
+static void run(int clients, const RpcBenchConfig& config)
+{
+    RpcService service;
+    int methods[3] = { service.addMethod("getStatus"), service.addMethod("setGripper"), service.addMethod("setGripperBlocking") };
+
+    SimulatedDevice device;
+    std::atomic<bool> stop(false);
+    std::vector<ClientResult> results(clients);
+    std::vector<std::thread> threads;
+    for (int i = 0; i < clients; ++i)
+        threads.emplace_back(runClient, std::ref(service), std::ref(device), methods, std::cref(config), i, std::ref(stop), std::ref(results[i]));
+
+    usleep(static_cast<useconds_t>(config.seconds * 1e6));
+    stop = true;
+    for (std::thread& thread : threads)
+        thread.join();
+
+    SampleStats status_ms;
+    uint64_t calls = 0, busy = 0, blocking_busy = 0;
+    for (ClientResult& result : results)
+    {
+        for (double value : result.status_ms_)
+            status_ms.add(value);
+        calls += result.calls_;
+        busy += result.busy_;
+        blocking_busy += result.blocking_busy_;
+    }
+
+    printf("clients=%d calls/s=%.0f busy=%llu blocking busy=%llu\n", clients, calls / config.seconds,
+        static_cast<unsigned long long>(busy), static_cast<unsigned long long>(blocking_busy));
+    status_ms.print("  getStatus latency", "ms");
+    for (const RpcMethodStats& stats : service.stats())
+    {
+        printf("  %-26s calls=%-8llu busy=%-6llu p50<=%.3f p99<=%.3f max=%.3f [ms]\n", stats.name_.c_str(),
+            static_cast<unsigned long long>(stats.calls_), static_cast<unsigned long long>(stats.busy_),
+            stats.percentileS(50) * 1e3, stats.percentileS(99) * 1e3, stats.max_s_ * 1e3);
+    }
+}
+
+int main(int argc, char** argv)
+{
+    RpcBenchConfig config;
+    std::string clients_list = "1,2,4,8,16,32,64,128";
+
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        if (arg == "--clients" && i + 1 < argc)
+            clients_list = argv[++i];
+        else if (arg == "--seconds" && i + 1 < argc)
+            config.seconds = atof(argv[++i]);
+        else if (arg == "--think-ms" && i + 1 < argc)
+            config.think_ms = atoi(argv[++i]);
+        else if (arg == "--stroke-ms" && i + 1 < argc)
+            config.stroke_ms = atoi(argv[++i]);
+        else if (arg == "--blocking" && i + 1 < argc)
+            config.blocking_probability = atof(argv[++i]);
+        else if (arg == "--commands" && i + 1 < argc)
+            config.command_probability = atof(argv[++i]);
+        else if (arg == "--seed" && i + 1 < argc)
+            config.seed = static_cast<unsigned int>(atoi(argv[++i]));
+        else
+        {
+            fprintf(stderr, "usage: %s [--clients N,N] [--seconds S] [--think-ms MS] [--stroke-ms MS] [--blocking P] [--commands P] "
+                "[--seed N]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    if (config.seconds <= 0.0)
+        config.seconds = 2.0;
+
+    printf("think=%d ms stroke=%d ms blocking=%.3f commands=%.3f\n", config.think_ms, config.stroke_ms,
+        config.blocking_probability, config.command_probability);
+
+    std::istringstream stream(clients_list);
+    std::string item;
+    while (std::getline(stream, item, ','))
+    {
+        int clients = atoi(item.c_str());
+        if (clients > 0)
+            run(clients, config);
+    }
+
+    return 0;
+}
@@ -0,0 +1,174 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2023, KR Soft s.r.o.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the Kassow Robots nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+// Benchmark of the in-process status event API. A simulated status monitor ticks a simulated gripper in real time and
+// publishes through StatusEventSource/StatusEventHub like GripkitCrEasy::onTick, while observers measure delivery latency.
+// Reports the cost added to the monitor tick, per-observer delivery latency and dropped events; --slow-us makes the
+// last observer block in every callback to show that it does not delay the monitor or the other observers.
+//
+// usage: weiss_gripkit_status_events_bench [--ticks N] [--period-us US] [--subscribers N] [--slow-us US]
+
+#include "weiss_gripkit/status_events.h"
+#include "weiss_gripkit/simulated_io.h"
+#include "bench_stats.h"
+
+#include <cstdlib>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+#define BENCH_DUID_GRIPPED 1
+#define BENCH_DUID_NO_ERROR 2
+
+using namespace kswx_weiss_gripkit;
+
+
+/// @brief Observer recording delivery latency, sample_time_ns of the bench events is the publish time.
+class LatencyObserver : public StatusObserver
+{
+public:
+    explicit LatencyObserver(int slow_us) : slow_us_(slow_us), transitions_(0), completions_(0), faults_(0) {}
+
+    virtual void onStatusChanged(const StatusTransition& event) { ++transitions_; received(event.sample_time_ns_); }
+    virtual void onActionCompleted(const ActionCompletion& event) { ++completions_; received(event.sample_time_ns_); }
+    virtual void onFault(const GripperFault& event) { ++faults_; received(event.sample_time_ns_); }
+
+    SampleStats latency_us_;
+    int slow_us_;
+    uint64_t transitions_;
+    uint64_t completions_;
+    uint64_t faults_;
+
+private:
+    void received(uint64_t published_ns)
+    {
+        latency_us_.add((monotonicNs() - published_ns) * 1e-3);
+        if (slow_us_ > 0)
+            usleep(slow_us_);
+    }
+};
+
+int main(int argc, char** argv)
+{
+    int ticks = 20000;
+    int period_us = 1000;
+    int subscribers = 2;
+    int slow_us = 0;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        if (arg == "--ticks" && i + 1 < argc)
+            ticks = atoi(argv[++i]);
+        else if (arg == "--period-us" && i + 1 < argc)
+            period_us = atoi(argv[++i]);
+        else if (arg == "--subscribers" && i + 1 < argc)
+            subscribers = std::max(0, std::min(STATUS_EVENT_MAX_SUBSCRIBERS, atoi(argv[++i])));
+        else if (arg == "--slow-us" && i + 1 < argc)
+            slow_us = atoi(argv[++i]);
+        else
+        {
+            fprintf(stderr, "usage: %s [--ticks N] [--period-us US] [--subscribers N] [--slow-us US]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    StatusEventHub hub;
+    std::vector<std::unique_ptr<LatencyObserver>> observers;
+    for (int i = 0; i < subscribers; ++i)
+    {
+        observers.emplace_back(new LatencyObserver((i == subscribers - 1) ? slow_us : 0));
+        if (hub.subscribe(observers.back().get()) < 0)
+        {
+            fprintf(stderr, "Unable to subscribe observer %d\n", i);
+            return 1;
+        }
+    }
+
+    // short strokes, so that every kind of event occurs many times
+    SimulatedGripper::Config gripper_config;
+    gripper_config.stroke_s = 0.02;
+    gripper_config.no_part_probability = 0.3;
+    SimulatedGripper gripper(gripper_config);
+    SimulatedIOData io_data(BENCH_DUID_GRIPPED, BENCH_DUID_NO_ERROR);
+    StatusEventSource source;
+    SampleStats tick_cost_ns;
+
+    uint64_t start_ns = monotonicNs();
+    for (int tick = 0; tick < ticks; ++tick)
+    {
+        uint64_t now_ns = monotonicNs();
+        double time_s = (now_ns - start_ns) * 1e-9;
+
+        GripkitSample sample;
+        float gripped_voltage, no_error_voltage;
+        gripper.sample(time_s, gripped_voltage, no_error_voltage);
+        io_data.setInputs(gripped_voltage, no_error_voltage);
+        readSample(io_data, BENCH_DUID_GRIPPED, BENCH_DUID_NO_ERROR, sample);
+        GripkitCrEasyStatus status = decodeStatus(sample);
+
+        // toggle the grip every 30 ms, some actions interrupt a running stroke
+        GripkitAction action = GripkitAction::NONE;
+        if (tick % (30000 / std::max(1, period_us) + 1) == 0)
+            action = gripper.grip() ? GripkitAction::RELEASE : GripkitAction::GRIP;
+
+        uint64_t publish_ns = monotonicNs();
+        source.update(hub, status, action, tick + 1, publish_ns);
+        tick_cost_ns.add(static_cast<double>(monotonicNs() - publish_ns));
+
+        if (action != GripkitAction::NONE)
+            gripper.setGrip(action == GripkitAction::GRIP, time_s);
+
+        usleep(period_us);
+    }
+
+    uint64_t dropped = hub.droppedEvents();
+    for (int i = 0; i < subscribers; ++i)
+        hub.unsubscribe(i);
+
+    printf("ticks=%d period_us=%d subscribers=%d slow_us=%d dropped=%llu\n", ticks, period_us, subscribers, slow_us,
+        static_cast<unsigned long long>(dropped));
+    tick_cost_ns.print("monitor tick cost", "ns");
+    for (int i = 0; i < subscribers; ++i)
+    {
+        LatencyObserver& observer = *observers[i];
+        char label[64];
+        snprintf(label, sizeof(label), "observer %d%s", i, observer.slow_us_ > 0 ? " (slow)" : "");
+        observer.latency_us_.print(label, "us");
+        printf("    transitions=%llu completions=%llu faults=%llu\n", static_cast<unsigned long long>(observer.transitions_),
+            static_cast<unsigned long long>(observer.completions_), static_cast<unsigned long long>(observer.faults_));
+    }
+
+    return 0;
+}
@@ -0,0 +1,137 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2023, KR Soft s.r.o.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the Kassow Robots nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+// Microbenchmark of the per-call cost of the non-throwing status query (queryStatus), the throwing path used
+// at the program API boundary (getStatusSharedMemory) and the isHolding/isReleased/isNoPart/isError path (isCommon),
+// for a valid status and for a status read glitch (STATUS_ERROR). Logging of the throwing path is not included.
+//
+// usage: weiss_gripkit_status_bench [ITERATIONS]
+
+#include "weiss_gripkit/gripkit_logic.h"
+#include "bench_stats.h"
+
+#include <cstdlib>
+
+using namespace kswx_weiss_gripkit;
+
+
+/// @brief Same as GripkitCrEasy::getStatusSharedMemory without logging.
+static GripkitCrEasyStatus getStatusOrThrow(SynchronizedData<PublishedStatus>* shm_status_sync)
+{
+    StatusQuery query = queryStatus(shm_status_sync, monotonicNowNs());
+    if (!query.ok())
+        throw GripkitException("Internal error.");
+    return query.status_;
+}
+
+/// @brief Same as GripkitCrEasy::isCommon without logging.
+static long isCommon(SynchronizedData<PublishedStatus>* shm_status_sync, GripkitCrEasyStatus checked_status)
+{
+    StatusQuery query = queryStatus(shm_status_sync, monotonicNowNs());
+    if (query.error_ == StatusQuery::Error::NOT_INITIALIZED || query.error_ == StatusQuery::Error::STALE)
+        throw GripkitException("Status monitor not running.");
+    return statusMatches(query, checked_status);
+}
+
+static void benchIs(const char* label, SynchronizedData<PublishedStatus>* shm_status_sync, int iterations)
+{
+    volatile int matches = 0;
+    uint64_t start_ns = monotonicNs();
+    for (int i = 0; i < iterations; ++i)
+    {
+        try
+        {
+            matches = matches + static_cast<int>(isCommon(shm_status_sync, GripkitCrEasyStatus::HOLDING));
+        }
+        catch (const GripkitException&)
+        {
+        }
+    }
+    printf("%-36s %10.1f [ns/call]\n", label, static_cast<double>(monotonicNs() - start_ns) / iterations);
+}
+
+static void benchQuery(const char* label, SynchronizedData<PublishedStatus>* shm_status_sync, int iterations)
+{
+    volatile int matches = 0;
+    uint64_t start_ns = monotonicNs();
+    for (int i = 0; i < iterations; ++i)
+    {
+        StatusQuery query = queryStatus(shm_status_sync, monotonicNowNs());
+        if (query.ok() && query.status_ == GripkitCrEasyStatus::HOLDING)
+            matches = matches + 1;
+    }
+    printf("%-36s %10.1f [ns/call]\n", label, static_cast<double>(monotonicNs() - start_ns) / iterations);
+}
+
+static void benchThrowing(const char* label, SynchronizedData<PublishedStatus>* shm_status_sync, int iterations)
+{
+    volatile int matches = 0;
+    uint64_t start_ns = monotonicNs();
+    for (int i = 0; i < iterations; ++i)
+    {
+        try
+        {
+            if (getStatusOrThrow(shm_status_sync) == GripkitCrEasyStatus::HOLDING)
+                matches = matches + 1;
+        }
+        catch (const GripkitException&)
+        {
+        }
+    }
+    printf("%-36s %10.1f [ns/call]\n", label, static_cast<double>(monotonicNs() - start_ns) / iterations);
+}
+
+int main(int argc, char** argv)
+{
+    int iterations = (argc > 1) ? atoi(argv[1]) : 1000000;
+    if (iterations <= 0)
+        iterations = 1000000;
+
+    // heartbeat far in the future keeps the status fresh during the whole run
+    SynchronizedData<PublishedStatus> shm_status;
+    PublishedStatus published{ GripkitCrEasyStatus::HOLDING, 1, 0, UINT64_MAX / 2 };
+
+    shm_status.set(published);
+    benchQuery("query, valid status", &shm_status, iterations);
+    benchThrowing("throwing, valid status", &shm_status, iterations);
+    benchIs("isHolding, valid status", &shm_status, iterations);
+
+    published.status_ = GripkitCrEasyStatus::STATUS_ERROR;
+    shm_status.set(published);
+    benchQuery("query, STATUS_ERROR", &shm_status, iterations);
+    benchThrowing("throwing, STATUS_ERROR", &shm_status, iterations);
+    benchIs("isHolding, STATUS_ERROR", &shm_status, iterations);
+
+    return 0;
+}
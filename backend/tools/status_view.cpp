@@ -0,0 +1,184 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2023, KR Soft s.r.o.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the Kassow Robots nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+// Print the gripper status from the read-only status view, without locks and without the KR2 API.
+// --stress runs a private writer and reader against each other and reports read cost and torn snapshots (must be 0).
+//
+// usage: weiss_gripkit_status_view [--watch MS] [--stress SECONDS]
+
+#include "weiss_gripkit/status_view.h"
+#include "weiss_gripkit/gripkit_types.h"
+#include "bench_stats.h"
+
+#include <cstdlib>
+#include <string>
+#include <thread>
+
+using namespace kswx_weiss_gripkit;
+
+
+static const char* errorString(StatusViewReader::Error error)
+{
+    switch (error)
+    {
+        case StatusViewReader::Error::NONE: return "none";
+        case StatusViewReader::Error::NOT_FOUND: return "status view not found, is the CBun created?";
+        case StatusViewReader::Error::VERSION_MISMATCH: return "status view has an incompatible version";
+        case StatusViewReader::Error::BUSY: return "no consistent snapshot, writer busy";
+    }
+    return "unknown";
+}
+
+static void print(const StatusViewData& data)
+{
+    uint64_t now_ns = monotonicNs();
+    double age_ms = (data.heartbeat_ns == 0) ? -1.0 : (now_ns - data.heartbeat_ns) * 1e-6;
+    printf("sequence=%llu status=%s action=%s gripped=%.2fV no_error=%.2fV request=%llu grips=%llu releases=%llu changes=%llu heartbeat_age=%.1fms\n",
+        static_cast<unsigned long long>(data.sequence),
+        toString(static_cast<GripkitCrEasyStatus>(data.status)),
+        toString(static_cast<GripkitAction>(data.action)),
+        data.gripped_voltage, data.no_error_voltage,
+        static_cast<unsigned long long>(data.request_id),
+        static_cast<unsigned long long>(data.grip_count),
+        static_cast<unsigned long long>(data.release_count),
+        static_cast<unsigned long long>(data.status_changes),
+        age_ms);
+}
+
+static int stress(double seconds)
+{
+    std::string name = "/weiss_gripkit_status_view_stress." + std::to_string(getpid());
+    StatusViewWriter writer;
+    StatusViewReader reader;
+    if (!writer.create(name.c_str()) || reader.open(name.c_str()) != StatusViewReader::Error::NONE)
+    {
+        fprintf(stderr, "Unable to create status view %s\n", name.c_str());
+        return 1;
+    }
+
+    // every field of a snapshot carries the same counter, a mix of two snapshots is detected as torn
+    std::atomic<bool> running(true);
+    std::thread writer_thread([&] {
+        StatusViewData data;
+        std::memset(&data, 0, sizeof(data));
+        for (uint64_t i = 1; running; ++i)
+        {
+            data.sequence = data.sample_time_ns = data.timestamp_ns = data.heartbeat_ns = i;
+            data.request_id = data.grip_count = data.release_count = data.status_changes = i;
+            writer.write(data);
+        }
+    });
+
+    uint64_t reads = 0, busy = 0, torn = 0;
+    uint64_t start_ns = monotonicNs();
+    uint64_t end_ns = start_ns + static_cast<uint64_t>(seconds * 1e9);
+    StatusViewData data;
+    while (monotonicNs() < end_ns)
+    {
+        if (reader.read(data) != StatusViewReader::Error::NONE)
+        {
+            ++busy;
+            continue;
+        }
+        ++reads;
+        uint64_t i = data.sequence;
+        if (data.sample_time_ns != i || data.timestamp_ns != i || data.heartbeat_ns != i || data.request_id != i ||
+            data.grip_count != i || data.release_count != i || data.status_changes != i)
+            ++torn;
+    }
+    double elapsed_ns = static_cast<double>(monotonicNs() - start_ns);
+
+    running = false;
+    writer_thread.join();
+    writer.destroy(name.c_str());
+
+    printf("reads=%llu busy=%llu torn=%llu cost=%.1f [ns/read] under continuous writes\n",
+        static_cast<unsigned long long>(reads), static_cast<unsigned long long>(busy), static_cast<unsigned long long>(torn),
+        reads ? elapsed_ns / reads : 0.0);
+
+    return torn == 0 ? 0 : 1;
+}
+
+int main(int argc, char** argv)
+{
+    int watch_ms = 0;
+    double stress_s = 0.0;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        if (arg == "--watch" && i + 1 < argc)
+            watch_ms = atoi(argv[++i]);
+        else if (arg == "--stress" && i + 1 < argc)
+            stress_s = atof(argv[++i]);
+        else
+        {
+            fprintf(stderr, "usage: %s [--watch MS] [--stress SECONDS]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    if (stress_s > 0.0)
+        return stress(stress_s);
+
+    StatusViewReader reader;
+    StatusViewReader::Error error = reader.open();
+    if (error != StatusViewReader::Error::NONE)
+    {
+        fprintf(stderr, "%s\n", errorString(error));
+        return 1;
+    }
+
+    StatusViewData data;
+    do
+    {
+        // while watching, keep going over a CBun restart, the reader maps the recreated segment
+        error = reader.read(data);
+        if (error != StatusViewReader::Error::NONE)
+        {
+            fprintf(stderr, "%s\n", errorString(error));
+            if (watch_ms <= 0)
+                return 1;
+        }
+        else
+        {
+            print(data);
+        }
+        if (watch_ms > 0)
+            usleep(watch_ms * 1000);
+    }
+    while (watch_ms > 0);
+
+    return 0;
+}
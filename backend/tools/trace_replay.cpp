@@ -0,0 +1,388 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2023, KR Soft s.r.o.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the Kassow Robots nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+// Replay recorded or synthetic GPIO traces through the gripper status logic used by GripkitCrEasy (readSample/decodeStatus on a
+// simulated iob_data_, ValueMonitor, ActionWait of blocking calls) and report per-action detection latency, spurious status
+// transitions and cost per tick, so that changes can be compared on identical input.
+//
+// usage: weiss_gripkit_replay [--rec FILE | --csv FILE | --synthetic CYCLES] [options]
+
+#include "weiss_gripkit/flight_recorder.h"
+#include "weiss_gripkit/gripkit_logic.h"
+#include "weiss_gripkit/simulated_io.h"
+#include "weiss_gripkit/stroke_model.h"
+#include "weiss_gripkit/value_monitor.h"
+#include "bench_stats.h"
+
+#include <atomic>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace kswx_weiss_gripkit;
+
+#define REPLAY_DUID_GRIPPED 3152406
+#define REPLAY_DUID_NO_ERROR 3152407
+#define REPLAY_PERIOD_S 0.01
+
+
+/// @brief One monitor tick of the replayed trace.
+struct TraceSample
+{
+    double time_s;
+    float gripped_voltage;
+    float no_error_voltage;
+    GripkitAction action;
+};
+
+static bool loadRecording(const std::string& path, std::vector<TraceSample>& trace)
+{
+    std::vector<FlightRecord> records;
+    if (!FlightRecorder::read(path, records))
+        return false;
+
+    for (const FlightRecord& record : records)
+    {
+        trace.push_back(TraceSample{ record.timestamp_ns * 1e-9, record.gripped_voltage, record.no_error_voltage,
+            static_cast<GripkitAction>(record.action) });
+    }
+    return true;
+}
+
+static bool loadCsv(const std::string& path, std::vector<TraceSample>& trace)
+{
+    // format of weiss_gripkit_flight_dump: time_s,request_id,gripped_voltage,no_error_voltage,status,action
+    std::ifstream file(path);
+    if (!file)
+        return false;
+
+    std::string line;
+    std::getline(file, line);
+    while (std::getline(file, line))
+    {
+        std::vector<std::string> fields;
+        std::stringstream stream(line);
+        std::string field;
+        while (std::getline(stream, field, ','))
+            fields.push_back(field);
+
+        if (fields.size() < 6)
+            continue;
+
+        GripkitAction action = GripkitAction::NONE;
+        if (fields[5] == toString(GripkitAction::GRIP))
+            action = GripkitAction::GRIP;
+        else if (fields[5] == toString(GripkitAction::RELEASE))
+            action = GripkitAction::RELEASE;
+
+        trace.push_back(TraceSample{ atof(fields[0].c_str()), strtof(fields[2].c_str(), nullptr), strtof(fields[3].c_str(), nullptr), action });
+    }
+    return true;
+}
+
+static void generateSynthetic(int cycles, double dwell_s, const SimulatedGripper::Config& config, std::vector<TraceSample>& trace)
+{
+    SimulatedGripper gripper(config);
+    int dwell_ticks = std::max(1, static_cast<int>(dwell_s / REPLAY_PERIOD_S + 0.5));
+    int ticks = (2 * cycles + 1) * dwell_ticks;
+
+    for (int tick = 0; tick < ticks; ++tick)
+    {
+        double time_s = tick * REPLAY_PERIOD_S;
+
+        // inputs are sampled before the action is picked up in onTick
+        TraceSample sample;
+        sample.time_s = time_s;
+        gripper.sample(time_s, sample.gripped_voltage, sample.no_error_voltage);
+        sample.action = GripkitAction::NONE;
+
+        if (tick > 0 && tick % dwell_ticks == 0)
+        {
+            sample.action = gripper.grip() ? GripkitAction::RELEASE : GripkitAction::GRIP;
+            gripper.setGrip(sample.action == GripkitAction::GRIP, time_s);
+        }
+
+        trace.push_back(sample);
+    }
+}
+
+/// @brief Drives the monitor callbacks from the trace and collects results.
+class Replay
+{
+public:
+    Replay(const std::vector<TraceSample>& trace)
+    : trace_(trace), io_(REPLAY_DUID_GRIPPED, REPLAY_DUID_NO_ERROR), tick_(0), done_(false), tick_start_ns_(0),
+      wait_action_(GripkitAction::NONE), wait_start_s_(0.0), completed_this_tick_(false),
+      actions_(0), completed_(0), failed_(0), interrupted_(0), transitions_(0), spurious_(0) {}
+
+    GripkitCrEasyStatus getStatus()
+    {
+        tick_start_ns_ = monotonicNs();
+
+        const TraceSample& trace_sample = trace_[std::min(tick_, trace_.size() - 1)];
+        io_.setInputs(trace_sample.gripped_voltage, trace_sample.no_error_voltage);
+
+        GripkitSample sample;
+        sample.timestamp_ns_ = static_cast<uint64_t>(trace_sample.time_s * 1e9);
+        readSample(io_, REPLAY_DUID_GRIPPED, REPLAY_DUID_NO_ERROR, sample);
+        return decodeStatus(sample);
+    }
+
+    void onTick(GripkitCrEasyStatus status)
+    {
+        completed_this_tick_ = false;
+        if (done_)
+            return;
+
+        const TraceSample& sample = trace_[tick_];
+
+        // a new request interrupts the running blocking call
+        if (sample.action != GripkitAction::NONE)
+        {
+            if (wait_)
+                ++interrupted_;
+
+            ++actions_;
+            wait_.reset(new ActionWait(sample.action));
+            wait_action_ = sample.action;
+            wait_start_s_ = sample.time_s;
+        }
+        else if (wait_)
+        {
+            // the action is picked up in the tick after the request, status is checked from the next tick on
+            ActionWait::Result result = wait_->update(status);
+            if (result == ActionWait::Result::DONE)
+            {
+                double latency_ms = (sample.time_s - wait_start_s_) * 1000.0;
+                (wait_action_ == GripkitAction::GRIP ? grip_latency_ms_ : release_latency_ms_).add(latency_ms);
+                ++completed_;
+                completed_this_tick_ = true;
+                wait_.reset();
+            }
+            else if (result == ActionWait::Result::FAILED)
+            {
+                ++failed_;
+                wait_.reset();
+            }
+        }
+
+        if (action_tracker_.update(status, sample.action, tick_, static_cast<uint64_t>(sample.time_s * 1e9)))
+            stroke_model_.learn(action_tracker_.completion());
+
+        tick_cost_us_.add((monotonicNs() - tick_start_ns_) * 1e-3);
+
+        if (++tick_ >= trace_.size())
+            done_ = true;
+    }
+
+    void onStatusChange(GripkitCrEasyStatus)
+    {
+        if (done_ && !completed_this_tick_)
+            return;
+
+        ++transitions_;
+        if (!completed_this_tick_)
+            ++spurious_;
+    }
+
+    bool done() const { return done_; }
+
+    void report(double wall_s, double cpu_s)
+    {
+        printf("ticks                        %zu\n", trace_.size());
+        printf("actions                      %d (completed %d, failed %d, interrupted %d, unfinished %d)\n",
+            actions_, completed_, failed_, interrupted_, wait_ ? 1 : 0);
+        printf("status transitions           %d (spurious %d)\n", transitions_, spurious_);
+        grip_latency_ms_.print("grip detection latency", "ms");
+        release_latency_ms_.print("release detection latency", "ms");
+        tick_cost_us_.print("tick cost", "us");
+        printStroke("learned grip stroke", stroke_model_.stats(GripkitAction::GRIP, GripkitCrEasyStatus::HOLDING));
+        printStroke("learned grip stroke no part", stroke_model_.stats(GripkitAction::GRIP, GripkitCrEasyStatus::NO_PART));
+        printStroke("learned release stroke", stroke_model_.stats(GripkitAction::RELEASE));
+        StrokeDeadlines deadlines = stroke_model_.deadlines();
+        printf("stroke deadlines             grip=%u release=%u [ms]\n", deadlines.grip_ms_, deadlines.release_ms_);
+        printf("process cpu per tick         %.3f [us]\n", trace_.empty() ? 0.0 : cpu_s * 1e6 / trace_.size());
+        printf("replay wall time             %.3f [s]\n", wall_s);
+    }
+
+private:
+    void printStroke(const char* label, const StrokeStats& stats)
+    {
+        printf("%-28s n=%-8llu mean=%-10.3f p99=%-10.3f deadline=%u [ms]\n", label, static_cast<unsigned long long>(stats.count_),
+            stats.mean(), stats.percentile(99), stats.deadlineMs());
+    }
+
+    const std::vector<TraceSample>& trace_;
+    SimulatedIOData io_;
+    size_t tick_;
+    std::atomic<bool> done_;
+    uint64_t tick_start_ns_;
+
+    std::unique_ptr<ActionWait> wait_;
+    GripkitAction wait_action_;
+    double wait_start_s_;
+    bool completed_this_tick_;
+
+    int actions_;
+    int completed_;
+    int failed_;
+    int interrupted_;
+    int transitions_;
+    int spurious_;
+    SampleStats grip_latency_ms_;
+    SampleStats release_latency_ms_;
+    SampleStats tick_cost_us_;
+    ActionTracker action_tracker_;
+    StrokeModel stroke_model_;
+};
+
+static void printUsage(const char* name)
+{
+    std::cerr << "usage: " << name << " [--rec FILE | --csv FILE | --synthetic CYCLES] [options]" << std::endl
+              << "  --rec FILE          replay a flight recorder file" << std::endl
+              << "  --csv FILE          replay CSV produced by weiss_gripkit_flight_dump" << std::endl
+              << "  --synthetic CYCLES  replay CYCLES simulated grip/release cycles (default 100)" << std::endl
+              << "  --speed X           replay speed, 1 for real time, 0 for as fast as possible (default 0)" << std::endl
+              << "  --stroke-ms MS      synthetic stroke time (default 150)" << std::endl
+              << "  --dwell-ms MS       synthetic time between actions (default 400)" << std::endl
+              << "  --no-part P         synthetic no part probability (default 0.2)" << std::endl
+              << "  --noise V           synthetic voltage noise (default 0.2)" << std::endl
+              << "  --seed N            synthetic random seed (default 1)" << std::endl;
+}
+
+int main(int argc, char** argv)
+{
+    std::string rec_path;
+    std::string csv_path;
+    int cycles = 100;
+    double speed = 0.0;
+    double dwell_s = 0.4;
+    SimulatedGripper::Config config;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        if (i + 1 >= argc)
+        {
+            printUsage(argv[0]);
+            return 1;
+        }
+
+        if (strcmp(argv[i], "--rec") == 0)
+            rec_path = argv[++i];
+        else if (strcmp(argv[i], "--csv") == 0)
+            csv_path = argv[++i];
+        else if (strcmp(argv[i], "--synthetic") == 0)
+            cycles = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--speed") == 0)
+            speed = atof(argv[++i]);
+        else if (strcmp(argv[i], "--stroke-ms") == 0)
+            config.stroke_s = atof(argv[++i]) / 1000.0;
+        else if (strcmp(argv[i], "--dwell-ms") == 0)
+            dwell_s = atof(argv[++i]) / 1000.0;
+        else if (strcmp(argv[i], "--no-part") == 0)
+            config.no_part_probability = atof(argv[++i]);
+        else if (strcmp(argv[i], "--noise") == 0)
+            config.noise_v = atof(argv[++i]);
+        else if (strcmp(argv[i], "--seed") == 0)
+            config.seed = static_cast<unsigned int>(atoi(argv[++i]));
+        else
+        {
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+
+    std::vector<TraceSample> trace;
+    if (!rec_path.empty())
+    {
+        if (!loadRecording(rec_path, trace))
+        {
+            std::cerr << "Unable to read flight recorder file " << rec_path << std::endl;
+            return 1;
+        }
+    }
+    else if (!csv_path.empty())
+    {
+        if (!loadCsv(csv_path, trace))
+        {
+            std::cerr << "Unable to read CSV file " << csv_path << std::endl;
+            return 1;
+        }
+    }
+    else
+    {
+        generateSynthetic(cycles, dwell_s, config, trace);
+    }
+
+    if (trace.empty())
+    {
+        std::cerr << "Empty trace." << std::endl;
+        return 1;
+    }
+
+    // replay at the recorded tick period scaled by speed
+    double period_s = (trace.size() > 1) ? (trace.back().time_s - trace.front().time_s) / (trace.size() - 1) : REPLAY_PERIOD_S;
+    int sleep_ms = (speed > 0.0) ? static_cast<int>(period_s * 1000.0 / speed + 0.5) : 0;
+
+    Replay replay(trace);
+    ValueMonitor<GripkitCrEasyStatus> monitor(
+        [&replay]() { return replay.getStatus(); },
+        [&replay](GripkitCrEasyStatus status) { replay.onStatusChange(status); },
+        [&replay](GripkitCrEasyStatus status) { replay.onTick(status); }, sleep_ms);
+
+    uint64_t wall_start_ns = monotonicNs();
+    uint64_t cpu_start_ns = processCpuNs();
+
+    if (!monitor.start(500))
+    {
+        std::cerr << "Unable to start monitor thread." << std::endl;
+        return 1;
+    }
+
+    while (!replay.done())
+        usleep(1000);
+
+    double wall_s = (monotonicNs() - wall_start_ns) * 1e-9;
+    double cpu_s = (processCpuNs() - cpu_start_ns) * 1e-9;
+    monitor.stop(500);
+
+    replay.report(wall_s, cpu_s);
+    return 0;
+}